@@ -0,0 +1,80 @@
+#include "AccelerationCurve.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/strings/str_split.h>
+
+#include "ChiralScrollException.h"
+
+namespace chiralscroll
+{
+
+AccelerationCurve::AccelerationCurve() : AccelerationCurve(std::vector<Point>())
+{
+}
+
+AccelerationCurve::AccelerationCurve(std::vector<Point> points) : points_(std::move(points)), scale_(0.0f)
+{
+	const float maxSpeed = points_.empty() ? 0.0f : points_.back().speed;
+	if(maxSpeed > 0.0f)
+	{
+		scale_ = (kTableSize - 1)/maxSpeed;
+	}
+	for(size_t i = 0; i < kTableSize; ++i)
+	{
+		table_[i] = Evaluate(maxSpeed*i/(kTableSize - 1));
+	}
+}
+
+AccelerationCurve AccelerationCurve::FromString(const std::string& text)
+{
+	std::vector<Point> points;
+	for(absl::string_view pointText : absl::StrSplit(text, ' ', absl::SkipWhitespace()))
+	{
+		const std::vector<absl::string_view> fields = absl::StrSplit(pointText, ':');
+		Point point;
+		THROW_IF_FALSE(fields.size() == 2 &&
+			absl::SimpleAtof(fields[0], &point.speed) &&
+			absl::SimpleAtof(fields[1], &point.gain),
+			absl::StrCat("Error parsing acceleration curve point: ", pointText));
+		THROW_IF_FALSE(point.speed >= 0.0f && (points.empty() || point.speed > points.back().speed),
+			absl::StrCat("Acceleration curve speeds must increase: ", text));
+		points.push_back(point);
+	}
+	return AccelerationCurve(std::move(points));
+}
+
+std::string AccelerationCurve::ToString() const
+{
+	return absl::StrJoin(points_, " ", [](std::string* out, const Point& point) {
+		absl::StrAppendFormat(out, "%g:%g", point.speed, point.gain);
+	});
+}
+
+float AccelerationCurve::Evaluate(float speed) const
+{
+	if(points_.empty())
+	{
+		return 1.0f;
+	}
+	const auto next = std::upper_bound(points_.begin(), points_.end(), speed,
+		[](float speed, const Point& point) { return speed < point.speed; });
+	if(next == points_.begin())
+	{
+		return next->gain;
+	}
+	if(next == points_.end())
+	{
+		return points_.back().gain;
+	}
+	const Point& prev = *(next - 1);
+	const float t = (speed - prev.speed)/(next->speed - prev.speed);
+	return prev.gain + t*(next->gain - prev.gain);
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace chiralscroll
+{
+
+// Scales the scroll amount by how fast the finger moves, so that slow
+// movements can be precise and fast movements cover a long page.
+//
+// The curve is a list of points "speed:gain", where speed is in touchpad
+// heights per second. The gain is interpolated linearly between the points
+// and held constant beyond them. An empty curve has a gain of 1 everywhere.
+// The curve is baked into a table when it is parsed, so that looking up a
+// gain costs one interpolated table read.
+class AccelerationCurve
+{
+public:
+	struct Point
+	{
+		float speed;
+		float gain;
+	};
+
+	// A gain of 1 at every speed.
+	AccelerationCurve();
+
+	// Throws an exception if the text is not a list of points in increasing
+	// order of speed.
+	static AccelerationCurve FromString(const std::string& text);
+	std::string ToString() const;
+
+	float Gain(float speed) const
+	{
+		const float x = speed*scale_;
+		if(!(x < kTableSize - 1))
+		{
+			return table_[kTableSize - 1];
+		}
+		const size_t i = static_cast<size_t>(x);
+		const float frac = x - static_cast<float>(i);
+		return table_[i] + frac*(table_[i + 1] - table_[i]);
+	}
+
+	// Exact value of the piecewise linear curve, which Gain approximates.
+	// Slower, for checking the table.
+	float Evaluate(float speed) const;
+
+	const std::vector<Point>& points() const
+	{
+		return points_;
+	}
+
+private:
+	static constexpr size_t kTableSize = 256;
+
+	explicit AccelerationCurve(std::vector<Point> points);
+
+	std::vector<Point> points_;
+	// Converts a speed to a table index.
+	float scale_;
+	// Gains at evenly spaced speeds from 0 to the speed of the last point.
+	std::array<float, kTableSize> table_;
+};
+
+}  // namespace chiralscroll
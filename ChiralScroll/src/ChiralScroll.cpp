@@ -1,36 +1,72 @@
 #include "ChiralScroll.h"
 
+#include <algorithm>
+#include <array>
+#include <optional>
 #include <string_view>
 
-#include "HidUtils.h"
+#include "ContactBatch.h"
+#include "FlightRecorder.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "Touchpad.h"
 #include "Vector.h"
 
 namespace chiralscroll
 {
 
+namespace
+{
+
+// Adaptive deadzones make the start deadzone this many times the noise, but
+// stay within these factors of the configured deadzones.
+static constexpr float kNoiseMultiple = 4.0f;
+static constexpr float kMinDeadzoneScale = 0.5f;
+static constexpr float kMaxDeadzoneScale = 2.0f;
+
+}  // namespace
+
+
 void ChiralScroll::SetSettings(const Settings& settings)
 {
 	settings_ = settings;
 }
 
-void ChiralScroll::ProcessTouch(const TouchDevice& device, const std::vector<TouchDevice::Contact>& contacts)
+void ChiralScroll::ProcessTouch(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts, absl::Time time)
 {
+	PROFILE_SCOPE(kProcessTouch);
 	const Settings::DeviceSettings& deviceSettings = settings_.GetDeviceSettings(device.name());
+	ContactTracker& tracker = contactTrackers_[&device];
+	tracker.Update(contacts, time);
+	// A finger resting in a scroll session could be about to move, and the
+	// session already ignores its jitter.
+	const bool scrolling = touchSession_ && &touchSession_->device() == &device &&
+		dynamic_cast<const ScrollSession*>(touchSession_.get());
+	noiseEstimators_.try_emplace(&device, deviceSettings.noise).first->second.Update(device, tracker, scrolling, time);
 	if(!settings_.GetGlobalSettings().enabled || !deviceSettings.enabled)
 	{
 		// Settings could have changed during touch session, so we need to clear it.
 		if(touchSession_)
 		{
 			touchSession_.reset();
+			GetFlightRecorder().Record(FlightRecorder::EventType::kSessionEnd);
 		}
+		PublishSnapshot(device, contacts);
 		return;
 	}
 
 	if(touchSession_ && &touchSession_->device() == &device)
 	{
-		if(!touchSession_->Update(contacts))
+		// Neither the session nor the snapshot would change.
+		if(tracker.stationary())
+		{
+			++GetPipelineStats().stationaryFrames;
+			return;
+		}
+		if(!touchSession_->Update(tracker))
 		{
 			touchSession_.reset();
+			GetFlightRecorder().Record(FlightRecorder::EventType::kSessionEnd);
 		}
 	}
 	else if(ShouldStartScrollingSession(deviceSettings, contacts))
@@ -43,21 +79,24 @@ void ChiralScroll::ProcessTouch(const TouchDevice& device, const std::vector<Tou
 	   std::any_of(contacts.begin(), contacts.end(), [](const auto& contact) { return contact.isTouch; }))
 	{
 		touchSession_ = std::make_unique<NonScrollSession>(device);
+		GetFlightRecorder().Record(FlightRecorder::EventType::kSessionStart, 0, 0, 0);
 	}
+
+	PublishSnapshot(device, contacts);
 }
 
 // Only start scrolling if there is exactly one contact, it is the first
 // contact, it is a positive contact (not a lift), and we are not within the
 // lockout window.
-bool ChiralScroll::ShouldStartScrollingSession(const Settings::DeviceSettings& deviceSettings, const std::vector<TouchDevice::Contact>& contacts)
+bool ChiralScroll::ShouldStartScrollingSession(const Settings::DeviceSettings& deviceSettings, const std::vector<Touchpad::Contact>& contacts)
 {
 	return contacts.size() == 1 &&
 		contacts[0].id == 0 &&
 		contacts[0].isTouch &&
-		absl::ToInt64Milliseconds(absl::Now() - lastKeyboardTime_) > deviceSettings.typingLockoutMs;
+		absl::ToInt64Milliseconds(clock_->Now() - lastKeyboardTime_) > deviceSettings.typingLockoutMs;
 }
 
-void ChiralScroll::StartScrollingSession(const TouchDevice& device, const std::vector<TouchDevice::Contact>& contacts)
+void ChiralScroll::StartScrollingSession(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts)
 {
 	const Settings::DeviceSettings& deviceSettings = settings_.GetDeviceSettings(device.name());
 	const auto pointInScrollZone = [](ULONG point, LONG width, float frac)
@@ -66,7 +105,7 @@ void ChiralScroll::StartScrollingSession(const TouchDevice& device, const std::v
 	};
 
 	const auto& contact = contacts[0];
-	const TouchDevice::ContactInfo& contactInfo = device.GetContactInfo(contact.contactInfoLink);
+	const Touchpad::ContactInfo& contactInfo = device.GetContactInfo(contact.contactInfoLink);
 	if(pointInScrollZone(
 		contact.logicalX - contactInfo.logicalArea.left,
 		contactInfo.logicalArea.right - contactInfo.logicalArea.left,
@@ -77,8 +116,11 @@ void ChiralScroll::StartScrollingSession(const TouchDevice& device, const std::v
 			contact,
 			Vector<float>(0.0f, 1.0f),
 			-deviceSettings.vSens,
-			settings_.GetGlobalSettings(),
+			deviceSettings.accelerationCurve,
+			SessionSettings(device),
 			*vScroller_);
+		++GetPipelineStats().sessionsStarted;
+		GetFlightRecorder().Record(FlightRecorder::EventType::kSessionStart, 0, 0, 1);
 	}
 	else if(pointInScrollZone(
 		contact.logicalY - contactInfo.logicalArea.top,
@@ -90,18 +132,104 @@ void ChiralScroll::StartScrollingSession(const TouchDevice& device, const std::v
 			contact,
 			Vector<float>(1.0f, 0.0f),
 			deviceSettings.hSens,
-			settings_.GetGlobalSettings(),
+			deviceSettings.accelerationCurve,
+			SessionSettings(device),
 			*hScroller_);
+		++GetPipelineStats().sessionsStarted;
+		GetFlightRecorder().Record(FlightRecorder::EventType::kSessionStart, 0, 0, 2);
+	}
+}
+
+Settings::GlobalSettings ChiralScroll::SessionSettings(const Touchpad& device)
+{
+	Settings::GlobalSettings settings = settings_.GetGlobalSettings();
+	const auto it = noiseEstimators_.find(&device);
+	if(!settings.adaptiveDeadzones || it == noiseEstimators_.end() || settings.startDeadzone <= 0.0f)
+	{
+		return settings;
+	}
+	const std::optional<float> noise = it->second.noise();
+	if(!noise)
+	{
+		return settings;
+	}
+
+	// The deadzones are scaled together, since they were tuned relative to
+	// each other.
+	const float scale = std::clamp(kNoiseMultiple*(*noise)/settings.startDeadzone, kMinDeadzoneScale, kMaxDeadzoneScale);
+	settings.startDeadzone *= scale;
+	settings.moveDeadzone *= scale;
+	settings.reverseDeadzone *= scale;
+	return settings;
+}
+
+void ChiralScroll::PublishSnapshot(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts)
+{
+	const ScrollSession* scrollSession = dynamic_cast<const ScrollSession*>(touchSession_.get());
+
+	// Scale every contact to its own contact area in one pass.
+	ContactBatch batch = ContactBatch::FromContacts(contacts, true);
+	std::array<float, ContactBatch::kMaxContacts> left, top, xScale, yScale;
+	for(size_t i = 0; i < batch.size; ++i)
+	{
+		const Touchpad::ContactInfo::Area& area = device.GetContactInfo(batch.links[i]).logicalArea;
+		left[i] = static_cast<float>(area.left);
+		top[i] = static_cast<float>(area.top);
+		xScale[i] = 1.0f/static_cast<float>(area.right - area.left);
+		yScale[i] = 1.0f/static_cast<float>(area.bottom - area.top);
+	}
+	kernels::Normalize(batch.x.data(), left.data(), xScale.data(), batch.x.data(), batch.size);
+	kernels::Normalize(batch.y.data(), top.data(), yScale.data(), batch.y.data(), batch.size);
+
+	TouchSnapshot& snapshot = touchSnapshots_->back();
+	snapshot.device = device.name();
+	snapshot.contactCount = std::min(batch.size, TouchSnapshot::kMaxContacts);
+	for(size_t i = 0; i < snapshot.contactCount; ++i)
+	{
+		snapshot.contacts[i] = {
+			batch.x[i],
+			batch.y[i],
+			scrollSession && scrollSession->contactId() == batch.ids[i],
+		};
+	}
+
+	snapshot.session = TouchSnapshot::Session::kNone;
+	snapshot.directionX = 0.0f;
+	snapshot.directionY = 0.0f;
+	if(scrollSession)
+	{
+		snapshot.session = &scrollSession->scroller() == vScroller_.get()
+			? TouchSnapshot::Session::kVertical
+			: TouchSnapshot::Session::kHorizontal;
+		if(scrollSession->scrolling())
+		{
+			snapshot.directionX = scrollSession->direction().x();
+			snapshot.directionY = scrollSession->direction().y();
+		}
+	}
+	touchSnapshots_->Publish();
+}
+
+void ChiralScroll::StoreNoiseEstimates(Settings& settings) const
+{
+	for(const auto& pair : noiseEstimators_)
+	{
+		const std::optional<float> noise = pair.second.noise();
+		if(noise)
+		{
+			settings.GetDeviceSettings(pair.first->name()).noise = *noise;
+		}
 	}
 }
 
 void ChiralScroll::ProcessKeyboard()
 {
-	lastKeyboardTime_ = absl::Now();
+	lastKeyboardTime_ = clock_->Now();
 	// Cancel any ongoing touch session.
 	if(touchSession_)
 	{
 		touchSession_.reset();
+		GetFlightRecorder().Record(FlightRecorder::EventType::kSessionEnd);
 	}
 }
 
@@ -4,12 +4,18 @@
 #include <optional>
 #include <Windows.h>
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/time/time.h>
 
-#include "HidUtils.h"
+#include "Clock.h"
+#include "ContactTracker.h"
+#include "NoiseEstimator.h"
 #include "Scroller.h"
 #include "Settings.h"
 #include "TouchSession.h"
+#include "TouchSnapshot.h"
+#include "Touchpad.h"
+#include "TripleBuffer.h"
 #include "Vector.h"
 
 namespace chiralscroll
@@ -18,33 +24,58 @@ namespace chiralscroll
 class ChiralScroll
 {
 public:
+	// The clock must outlive ChiralScroll.
 	ChiralScroll(
 		const Settings& settings,
 		std::unique_ptr<Scroller> vScroller,
-		std::unique_ptr<Scroller> hScroller)
+		std::unique_ptr<Scroller> hScroller,
+		const Clock& clock)
 		: settings_(settings),
 		  vScroller_(std::move(vScroller)),
 		  hScroller_(std::move(hScroller)),
+		  touchSnapshots_(std::make_unique<TripleBuffer<TouchSnapshot>>()),
 		  touchSession_(nullptr),
 		  currentDevice_(nullptr),
+		  clock_(&clock),
 		  lastKeyboardTime_(absl::InfinitePast()) {}
 
 	void SetSettings(const Settings& settings);
-	void ProcessTouch(const TouchDevice& device, const std::vector<TouchDevice::Contact>& contacts);
+	// Handles a frame of the given device, scanned at the given time.
+	void ProcessTouch(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts, absl::Time time);
 	void ProcessKeyboard();
 
+	// Copies the noise measured on each device into the given settings, so
+	// that it is not measured from scratch on the next run.
+	void StoreNoiseEstimates(Settings& settings) const;
+
+	// The latest frame and session state, published after every frame for
+	// display. Only one reader may take them, on one thread.
+	TripleBuffer<TouchSnapshot>& touchSnapshots()
+	{
+		return *touchSnapshots_;
+	}
+
 private:
 	bool ShouldStartScrollingSession(
 		const Settings::DeviceSettings& deviceSettings,
-		const std::vector<TouchDevice::Contact>& contacts);
-	void StartScrollingSession(const TouchDevice& device, const std::vector<TouchDevice::Contact>& contacts);
+		const std::vector<Touchpad::Contact>& contacts);
+	void StartScrollingSession(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts);
+	// The global settings with the deadzones scaled to the device's noise.
+	Settings::GlobalSettings SessionSettings(const Touchpad& device);
+	void PublishSnapshot(const Touchpad& device, const std::vector<Touchpad::Contact>& contacts);
 
 	Settings settings_;
 	std::unique_ptr<Scroller> vScroller_;
 	std::unique_ptr<Scroller> hScroller_;
+	// Not held by value so that ChiralScroll stays movable.
+	std::unique_ptr<TripleBuffer<TouchSnapshot>> touchSnapshots_;
 	std::unique_ptr<TouchSession> touchSession_;
-	TouchDevice* currentDevice_;
+	const Touchpad* currentDevice_;
+	// Held by pointer so that ChiralScroll stays movable.
+	const Clock* clock_;
 	absl::Time lastKeyboardTime_;
+	absl::flat_hash_map<const Touchpad*, NoiseEstimator> noiseEstimators_;
+	absl::flat_hash_map<const Touchpad*, ContactTracker> contactTrackers_;
 };
 
 }  // namespace chiralscroll
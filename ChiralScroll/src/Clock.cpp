@@ -0,0 +1,15 @@
+#include "Clock.h"
+
+#include <chrono>
+
+namespace chiralscroll
+{
+
+absl::Time MonotonicClock::Now() const
+{
+	// steady_clock counts from an unspecified point, typically boot, which
+	// is as good an epoch as any since only differences are used.
+	return absl::UnixEpoch() + absl::FromChrono(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+namespace chiralscroll
+{
+
+// The source of time for everything that measures intervals: typing lockout,
+// frame deadlines and traces. Only differences between times from the same
+// clock are meaningful.
+class Clock
+{
+public:
+	virtual ~Clock() = default;
+
+	virtual absl::Time Now() const = 0;
+};
+
+// Follows the monotonic performance counter, so it does not jump when the
+// system time changes.
+class MonotonicClock : public Clock
+{
+public:
+	absl::Time Now() const override;
+};
+
+// Only moves when it is told to. Used to replay recorded input at whatever
+// speed the machine allows, with the same results every time.
+class VirtualClock : public Clock
+{
+public:
+	explicit VirtualClock(absl::Time now = absl::UnixEpoch()) : now_(now) {}
+
+	absl::Time Now() const override
+	{
+		return now_;
+	}
+
+	void Set(absl::Time now)
+	{
+		now_ = now;
+	}
+
+	void Advance(absl::Duration duration)
+	{
+		now_ += duration;
+	}
+
+private:
+	absl::Time now_;
+};
+
+}  // namespace chiralscroll
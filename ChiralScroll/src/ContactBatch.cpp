@@ -0,0 +1,93 @@
+#include "ContactBatch.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#define CHIRALSCROLL_SIMD
+#include <immintrin.h>
+#endif
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+#if defined(__AVX2__)
+static constexpr size_t kLanes = 8;
+using Packed = __m256;
+#define SIMD_OP(op) _mm256_##op##_ps
+#elif defined(CHIRALSCROLL_SIMD)
+static constexpr size_t kLanes = 4;
+using Packed = __m128;
+#define SIMD_OP(op) _mm_##op##_ps
+#endif
+
+#ifdef CHIRALSCROLL_SIMD
+Packed Load(const float* p)
+{
+	return SIMD_OP(loadu)(p);
+}
+
+void Store(float* p, Packed v)
+{
+	SIMD_OP(storeu)(p, v);
+}
+
+Packed Sub(Packed a, Packed b)
+{
+	return SIMD_OP(sub)(a, b);
+}
+
+Packed Mul(Packed a, Packed b)
+{
+	return SIMD_OP(mul)(a, b);
+}
+
+// Number of elements handled by the vector loop; the rest are done one by one.
+size_t VectorCount(size_t n)
+{
+	return n - n % kLanes;
+}
+#endif
+
+}  // namespace
+
+ContactBatch ContactBatch::FromContacts(const std::vector<Touchpad::Contact>& contacts, bool touchOnly)
+{
+	ContactBatch batch;
+	for(const auto& contact : contacts)
+	{
+		if((touchOnly && !contact.isTouch) || batch.size == kMaxContacts)
+		{
+			continue;
+		}
+		const size_t i = batch.size++;
+		batch.ids[i] = contact.id;
+		batch.links[i] = contact.contactInfoLink;
+		batch.flags[i] = static_cast<uint8_t>((contact.isTouch ? kTouch : 0) | (contact.confidence ? kConfidence : 0));
+		batch.x[i] = static_cast<float>(contact.logicalX);
+		batch.y[i] = static_cast<float>(contact.logicalY);
+	}
+	return batch;
+}
+
+namespace kernels
+{
+
+void Normalize(const float* in, const float* offset, const float* scale, float* out, size_t n)
+{
+	size_t i = 0;
+#ifdef CHIRALSCROLL_SIMD
+	for(; i < VectorCount(n); i += kLanes)
+	{
+		Store(out + i, Mul(Sub(Load(in + i), Load(offset + i)), Load(scale + i)));
+	}
+#endif
+	for(; i < n; ++i)
+	{
+		out[i] = (in[i] - offset[i])*scale[i];
+	}
+}
+
+}  // namespace kernels
+
+}  // namespace chiralscroll
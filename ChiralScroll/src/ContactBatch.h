@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <Windows.h>
+
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+// The contacts of one frame in structure-of-arrays layout, so that the
+// per-contact math below runs over contiguous arrays instead of striding
+// through Touchpad::Contact records.
+struct ContactBatch
+{
+	// Enough for any precision touchpad, and a multiple of the widest vector
+	// so the kernels never need a partial load.
+	static constexpr size_t kMaxContacts = 16;
+
+	enum Flags : uint8_t
+	{
+		kTouch = 1 << 0,
+		kConfidence = 1 << 1,
+	};
+
+	// Copies the given contacts, up to kMaxContacts. If touchOnly is set,
+	// lifted contacts are left out.
+	static ContactBatch FromContacts(const std::vector<Touchpad::Contact>& contacts, bool touchOnly = false);
+
+	size_t size = 0;
+	std::array<ULONG, kMaxContacts> ids{};
+	std::array<ULONG, kMaxContacts> links{};
+	std::array<uint8_t, kMaxContacts> flags{};
+	alignas(32) std::array<float, kMaxContacts> x{};
+	alignas(32) std::array<float, kMaxContacts> y{};
+};
+
+// Kernels over float arrays of length n. The arrays must not overlap, except
+// that the output may be the same array as the input. They use AVX2 or SSE2
+// when the build targets them, and plain loops otherwise.
+namespace kernels
+{
+
+// out[i] = (in[i] - offset[i])*scale[i]
+void Normalize(const float* in, const float* offset, const float* scale, float* out, size_t n);
+
+}  // namespace kernels
+
+}  // namespace chiralscroll
@@ -0,0 +1,69 @@
+#include "ContactTracker.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace chiralscroll
+{
+
+void ContactTracker::Update(const std::vector<Touchpad::Contact>& contacts, absl::Time time)
+{
+	std::swap(index_, lastIndex_);
+	std::swap(deltas_, lastDeltas_);
+	index_.clear();
+	deltas_.clear();
+
+	const float seconds = static_cast<float>(absl::ToDoubleSeconds(std::max(time - lastTime_, kMinInterval)));
+	size_t stillTouching = 0;
+	bool changed = false;
+	for(const auto& contact : contacts)
+	{
+		ContactDelta delta{ContactDelta::Type::kUp, contact, Vector<float>(0.0f, 0.0f), Vector<float>(0.0f, 0.0f)};
+		const auto last = lastIndex_.find(contact.id);
+		const bool wasTouching = last != lastIndex_.end() && lastDeltas_[last->second].contact.isTouch;
+		if(!contact.isTouch)
+		{
+			changed = true;
+		}
+		else if(!wasTouching)
+		{
+			delta.type = ContactDelta::Type::kDown;
+			changed = true;
+		}
+		else
+		{
+			const Touchpad::Contact& lastContact = lastDeltas_[last->second].contact;
+			delta.displacement = Vector<float>(
+				static_cast<float>(contact.logicalX) - static_cast<float>(lastContact.logicalX),
+				static_cast<float>(contact.logicalY) - static_cast<float>(lastContact.logicalY));
+			delta.velocity = delta.displacement/seconds;
+			if(contact.logicalX == lastContact.logicalX && contact.logicalY == lastContact.logicalY)
+			{
+				delta.type = ContactDelta::Type::kUnchanged;
+				++stillTouching;
+			}
+			else
+			{
+				delta.type = ContactDelta::Type::kMove;
+				changed = true;
+			}
+		}
+		index_[contact.id] = deltas_.size();
+		deltas_.push_back(delta);
+	}
+
+	// A contact that was touching and is missing from this frame also counts
+	// as a change.
+	const size_t lastTouching = static_cast<size_t>(std::count_if(lastDeltas_.begin(), lastDeltas_.end(),
+		[](const ContactDelta& delta) { return delta.contact.isTouch; }));
+	stationary_ = !changed && stillTouching == lastTouching;
+	lastTime_ = time;
+}
+
+const ContactDelta* ContactTracker::Find(ULONG id) const
+{
+	const auto it = index_.find(id);
+	return it == index_.end() ? nullptr : &deltas_[it->second];
+}
+
+}  // namespace chiralscroll
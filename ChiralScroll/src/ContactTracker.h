@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
+
+#include "Touchpad.h"
+#include "Vector.h"
+
+namespace chiralscroll
+{
+
+// What happened to one contact since the previous frame.
+struct ContactDelta
+{
+	enum class Type { kDown, kMove, kUnchanged, kUp };
+
+	Type type;
+	Touchpad::Contact contact;
+	// Movement since the previous frame in logical units, and the same per
+	// second. Zero unless the contact was already touching.
+	Vector<float> displacement;
+	Vector<float> velocity;
+};
+
+// Turns the frames of one touchpad into per-contact deltas against the
+// previous frame, keeping the previous contacts in a table by ID. Consumers
+// look up the contacts they follow instead of scanning every frame, and can
+// tell a frame in which nothing moved from one that needs evaluating.
+class ContactTracker
+{
+public:
+	ContactTracker() : lastTime_(absl::InfinitePast()), stationary_(false) {}
+
+	// Moves on to the given frame, scanned at the given time. Velocities are
+	// measured between scan times, so they do not depend on when the frames
+	// are handled.
+	void Update(const std::vector<Touchpad::Contact>& contacts, absl::Time time);
+
+	// One per contact in the frame, in the same order.
+	const std::vector<ContactDelta>& deltas() const
+	{
+		return deltas_;
+	}
+
+	// The delta of the contact with the given ID, or nullptr if the frame
+	// does not have it.
+	const ContactDelta* Find(ULONG id) const;
+
+	// True if the same contacts are touching at the same positions as in the
+	// previous frame.
+	bool stationary() const
+	{
+		return stationary_;
+	}
+
+private:
+	// Shortest time over which to measure velocity, for frames that share a
+	// timestamp.
+	static constexpr absl::Duration kMinInterval = absl::Milliseconds(1);
+
+	// Index into deltas_ by contact ID, for this frame and the previous one.
+	absl::flat_hash_map<ULONG, size_t> index_;
+	absl::flat_hash_map<ULONG, size_t> lastIndex_;
+	std::vector<ContactDelta> deltas_;
+	std::vector<ContactDelta> lastDeltas_;
+	absl::Time lastTime_;
+	bool stationary_;
+};
+
+}  // namespace chiralscroll
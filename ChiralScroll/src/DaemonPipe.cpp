@@ -0,0 +1,175 @@
+#include "DaemonPipe.h"
+
+#include <exception>
+#include <utility>
+
+#include <absl/strings/str_cat.h>
+#include <spdlog/spdlog.h>
+
+#include "ChiralScrollException.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr DWORD kSendTimeoutMs = 1000;
+// How long a connected client may take to send its request or read the
+// response. The daemon's input waits meanwhile, so this is short.
+static constexpr DWORD kClientTimeoutMs = 100;
+
+}  // namespace
+
+
+std::optional<std::string> DaemonPipe::Send(std::string_view request)
+{
+	std::string response(kBufferSize, '\0');
+	DWORD bytesRead = 0;
+	if(!CallNamedPipe(
+		kName,
+		const_cast<char*>(request.data()),
+		static_cast<DWORD>(request.size()),
+		response.data(),
+		kBufferSize,
+		&bytesRead,
+		kSendTimeoutMs))
+	{
+		return std::nullopt;
+	}
+	response.resize(bytesRead);
+	return response;
+}
+
+DaemonPipe::DaemonPipe(Handler handler)
+	: handler_(std::move(handler)),
+	  connect_{},
+	  connectPending_(false)
+{
+	// A single instance, so that a second daemon fails here rather than
+	// answering half of the requests.
+	pipe_ = CreateNamedPipe(
+		kName,
+		PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+		PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		1,
+		kBufferSize,
+		kBufferSize,
+		0,
+		nullptr);
+	THROW_IF_FALSE(pipe_ != INVALID_HANDLE_VALUE,
+		absl::StrCat("CreateNamedPipe failed: ", GetErrorMessage(GetLastError())));
+	connectEvent_ = CreateEvent(nullptr, true, false, nullptr);
+	ioEvent_ = CreateEvent(nullptr, true, false, nullptr);
+	if(!connectEvent_ || !ioEvent_)
+	{
+		const DWORD error = GetLastError();
+		CloseHandle(connectEvent_);
+		CloseHandle(ioEvent_);
+		CloseHandle(pipe_);
+		throw ChiralScrollException(absl::StrCat("CreateEvent failed: ", GetErrorMessage(error)));
+	}
+	Listen();
+}
+
+DaemonPipe::~DaemonPipe()
+{
+	if(connectPending_)
+	{
+		CancelIo(pipe_);
+		DWORD bytes;
+		GetOverlappedResult(pipe_, &connect_, &bytes, true);
+	}
+	CloseHandle(pipe_);
+	CloseHandle(connectEvent_);
+	CloseHandle(ioEvent_);
+}
+
+void DaemonPipe::Serve()
+{
+	DWORD bytes;
+	if(!connectPending_ || GetOverlappedResult(pipe_, &connect_, &bytes, false))
+	{
+		ServeClient();
+	}
+	DisconnectNamedPipe(pipe_);
+	Listen();
+}
+
+void DaemonPipe::Listen()
+{
+	connect_ = {};
+	connect_.hEvent = connectEvent_;
+	connectPending_ = false;
+	if(ConnectNamedPipe(pipe_, &connect_))
+	{
+		return;
+	}
+	const DWORD error = GetLastError();
+	if(error == ERROR_IO_PENDING)
+	{
+		connectPending_ = true;
+	}
+	else if(error == ERROR_PIPE_CONNECTED)
+	{
+		// A client got in before the call, so nothing will signal the event.
+		SetEvent(connectEvent_);
+	}
+	else
+	{
+		SPDLOG_ERROR("ConnectNamedPipe failed, no longer serving requests: {}", GetErrorMessage(error));
+	}
+}
+
+void DaemonPipe::ServeClient()
+{
+	std::string request(kBufferSize, '\0');
+	OVERLAPPED overlapped{};
+	overlapped.hEvent = ioEvent_;
+	DWORD bytes = 0;
+	if(!ReadFile(pipe_, request.data(), kBufferSize, nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+	{
+		return;
+	}
+	if(!Wait(overlapped, &bytes))
+	{
+		return;
+	}
+	request.resize(bytes);
+
+	std::string response;
+	try
+	{
+		response = handler_(request);
+	}
+	catch(const std::exception& e)
+	{
+		SPDLOG_ERROR("Request \"{}\" failed: {}", request, e.what());
+		response = absl::StrCat("error: ", e.what());
+	}
+
+	overlapped = {};
+	overlapped.hEvent = ioEvent_;
+	if(!WriteFile(pipe_, response.data(), static_cast<DWORD>(response.size()), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+	{
+		return;
+	}
+	if(Wait(overlapped, &bytes))
+	{
+		FlushFileBuffers(pipe_);
+	}
+}
+
+bool DaemonPipe::Wait(OVERLAPPED& overlapped, DWORD* bytes)
+{
+	if(WaitForSingleObject(overlapped.hEvent, kClientTimeoutMs) != WAIT_OBJECT_0)
+	{
+		SPDLOG_WARN("Pipe client timed out.");
+		CancelIo(pipe_);
+		GetOverlappedResult(pipe_, &overlapped, bytes, true);
+		return false;
+	}
+	return GetOverlappedResult(pipe_, &overlapped, bytes, false);
+}
+
+}  // namespace chiralscroll
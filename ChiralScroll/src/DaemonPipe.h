@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <Windows.h>
+
+namespace chiralscroll
+{
+
+// The local pipe between the headless daemon and the settings UI. Each
+// request is one message answered by one message.
+//
+// The server has no thread of its own. The daemon waits on event() alongside
+// its window messages and calls Serve when it is signalled, so requests are
+// handled on the same thread as the input and need no locking.
+class DaemonPipe
+{
+public:
+	using Handler = std::function<std::string(std::string_view request)>;
+
+	static constexpr wchar_t kName[] = L"\\\\.\\pipe\\ChiralScroll";
+
+	// Requests understood by the daemon.
+	static constexpr char kReload[] = "reload";
+	static constexpr char kEnable[] = "enable";
+	static constexpr char kDisable[] = "disable";
+	static constexpr char kStatus[] = "status";
+	static constexpr char kDump[] = "dump";
+	static constexpr char kExit[] = "exit";
+
+	// Sends a request to the daemon and returns its response, or nullopt if
+	// no daemon is running or it did not answer.
+	static std::optional<std::string> Send(std::string_view request);
+
+	// Starts listening for a client. Throws if the pipe could not be created,
+	// which includes another daemon already serving it.
+	explicit DaemonPipe(Handler handler);
+	~DaemonPipe();
+
+	DaemonPipe(const DaemonPipe&) = delete;
+	DaemonPipe& operator=(const DaemonPipe&) = delete;
+
+	// Signalled when a client is waiting to be served.
+	HANDLE event() const
+	{
+		return connectEvent_;
+	}
+
+	// Answers the waiting client and listens for the next one.
+	void Serve();
+
+private:
+	static constexpr DWORD kBufferSize = 4096;
+
+	void Listen();
+	void ServeClient();
+
+	// Waits for an overlapped read or write by the client, cancelling it if
+	// the client takes too long. Returns false if it failed.
+	bool Wait(OVERLAPPED& overlapped, DWORD* bytes);
+
+	Handler handler_;
+	HANDLE pipe_;
+	HANDLE connectEvent_;
+	HANDLE ioEvent_;
+	OVERLAPPED connect_;
+	bool connectPending_;
+};
+
+}  // namespace chiralscroll
@@ -0,0 +1,181 @@
+#include "DiagnosticsDialog.h"
+
+#include <iterator>
+#include <string>
+
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <wx/sizer.h>
+
+#include "PipelineStats.h"
+#include "Profiler.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+enum DeviceColumn
+{
+	kDeviceName,
+	kReportRate,
+	kFrameRate,
+	kComplete,
+	kPartial,
+	kDropped,
+	kMerged,
+	kStray,
+	kErrors,
+	kQuarantines,
+};
+
+enum LatencyColumn
+{
+	kStep,
+	kCount,
+	kP50,
+	kP99,
+	kMax,
+};
+
+double Rate(uint64_t current, uint64_t previous, absl::Duration elapsed)
+{
+	const double seconds = absl::ToDoubleSeconds(elapsed);
+	return seconds > 0 ? static_cast<double>(current - previous)/seconds : 0.0;
+}
+
+std::string Microseconds(uint64_t cycles)
+{
+	return absl::StrFormat("%.1f", CyclesToNanoseconds(cycles)/1000.0);
+}
+
+}  // namespace
+
+DiagnosticsDialog::DiagnosticsDialog(wxWindow* parent, const absl::flat_hash_map<HANDLE, TouchDevice>& touchDevices, const Clock& clock)
+	: wxDialog(parent, wxID_ANY, "ChiralScroll Diagnostics", wxDefaultPosition, wxDefaultSize, wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+	  touchDevices_(touchDevices),
+	  clock_(clock),
+	  timer_(this),
+	  lastSample_(clock.Now())
+{
+	deviceList_ = new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxSize(860, 120), wxLC_REPORT | wxLC_SINGLE_SEL);
+	deviceList_->InsertColumn(kDeviceName, "Device", wxLIST_FORMAT_LEFT, 240);
+	deviceList_->InsertColumn(kReportRate, "Reports/s", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kFrameRate, "Frames/s", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kComplete, "Complete", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kPartial, "Partial", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kDropped, "Dropped", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kMerged, "Merged", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kStray, "Stray", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kErrors, "Errors", wxLIST_FORMAT_RIGHT);
+	deviceList_->InsertColumn(kQuarantines, "Quarantines", wxLIST_FORMAT_RIGHT);
+
+	latencyList_ = new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxSize(860, 120), wxLC_REPORT | wxLC_SINGLE_SEL);
+	latencyList_->InsertColumn(kStep, "Step (us)", wxLIST_FORMAT_LEFT, 240);
+	latencyList_->InsertColumn(kCount, "Count", wxLIST_FORMAT_RIGHT);
+	latencyList_->InsertColumn(kP50, "p50", wxLIST_FORMAT_RIGHT);
+	latencyList_->InsertColumn(kP99, "p99", wxLIST_FORMAT_RIGHT);
+	latencyList_->InsertColumn(kMax, "Max", wxLIST_FORMAT_RIGHT);
+	latencyList_->InsertItem(0, "Decode and frame assembly");
+	latencyList_->InsertItem(1, "Gesture handling");
+	latencyList_->InsertItem(2, "Scroll injection");
+	latencyList_->InsertItem(3, "Stalled injection");
+
+	scrollSummary_ = new wxStaticText(this, wxID_ANY, "");
+
+	for(const auto& pair : touchDevices_)
+	{
+		const long row = deviceList_->InsertItem(deviceList_->GetItemCount(), std::string(pair.second.name()));
+		deviceList_->SetItemPtrData(row, reinterpret_cast<wxUIntPtr>(pair.first));
+		lastStats_[pair.first] = pair.second.frameStats();
+	}
+
+	wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(deviceList_, 1, wxEXPAND | wxALL, 5);
+	sizer->Add(latencyList_, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+	sizer->Add(scrollSummary_, 0, wxEXPAND | wxALL, 5);
+	SetSizerAndFit(sizer);
+
+	Bind(wxEVT_TIMER, &DiagnosticsDialog::OnTimer, this);
+	Bind(wxEVT_CLOSE_WINDOW, &DiagnosticsDialog::OnClose, this);
+	Sample();
+	timer_.Start(kSampleIntervalMs);
+}
+
+void DiagnosticsDialog::OnTimer(wxTimerEvent& event)
+{
+	Sample();
+}
+
+void DiagnosticsDialog::OnClose(wxCloseEvent& event)
+{
+	timer_.Stop();
+	Destroy();
+}
+
+void DiagnosticsDialog::Sample()
+{
+	const absl::Time now = clock_.Now();
+	ShowDevices(now - lastSample_);
+	ShowLatencies();
+	lastSample_ = now;
+}
+
+void DiagnosticsDialog::ShowDevices(absl::Duration elapsed)
+{
+	for(long row = 0; row < deviceList_->GetItemCount(); ++row)
+	{
+		const HANDLE handle = reinterpret_cast<HANDLE>(deviceList_->GetItemData(row));
+		const auto it = touchDevices_.find(handle);
+		if(it == touchDevices_.end())
+		{
+			continue;
+		}
+		const TouchDevice::FrameBuilder::Stats stats = it->second.frameStats();
+		TouchDevice::FrameBuilder::Stats& last = lastStats_[handle];
+
+		const uint64_t frames = stats.frames.value();
+		const uint64_t partial = stats.partialFrames.value();
+		const uint64_t dropped = stats.droppedFrames.value();
+		const uint64_t attempted = frames + dropped;
+		const std::string complete = attempted > 0
+			? absl::StrFormat("%.1f%%", 100.0*static_cast<double>(frames - partial)/static_cast<double>(attempted))
+			: "-";
+
+		deviceList_->SetItem(row, kReportRate, absl::StrFormat("%.0f", Rate(stats.reports.value(), last.reports.value(), elapsed)));
+		deviceList_->SetItem(row, kFrameRate, absl::StrFormat("%.0f", Rate(frames, last.frames.value(), elapsed)));
+		deviceList_->SetItem(row, kComplete, complete);
+		deviceList_->SetItem(row, kPartial, absl::StrCat(partial));
+		deviceList_->SetItem(row, kDropped, absl::StrCat(dropped));
+		deviceList_->SetItem(row, kMerged, absl::StrCat(stats.mergedFrames.value()));
+		deviceList_->SetItem(row, kStray, absl::StrCat(stats.strayReports.value()));
+		deviceList_->SetItem(row, kErrors, absl::StrCat(stats.decodeErrors.value()));
+		deviceList_->SetItem(row, kQuarantines, absl::StrCat(stats.quarantines.value()));
+		last = stats;
+	}
+}
+
+void DiagnosticsDialog::ShowLatencies()
+{
+	const PipelineStats& pipeline = GetPipelineStats();
+	const Histogram* histograms[] = {&pipeline.decode, &pipeline.gesture, &pipeline.injection, &pipeline.injectionStalls};
+	for(long row = 0; row < static_cast<long>(std::size(histograms)); ++row)
+	{
+		const Histogram& histogram = *histograms[row];
+		latencyList_->SetItem(row, kCount, absl::StrCat(histogram.count()));
+		latencyList_->SetItem(row, kP50, Microseconds(histogram.Percentile(50.0)));
+		latencyList_->SetItem(row, kP99, Microseconds(histogram.Percentile(99.0)));
+		latencyList_->SetItem(row, kMax, Microseconds(histogram.max()));
+	}
+	scrollSummary_->SetLabel(absl::StrFormat(
+		"Scroll events injected: %d    Rounded to zero: %d    Sent by fallback: %d    Dropped: %d    Frames shed: %d    Stationary: %d",
+		pipeline.scrollEvents.value(),
+		pipeline.emptyScrolls.value(),
+		pipeline.fallbackScrolls.value(),
+		pipeline.droppedScrolls.value(),
+		pipeline.shedFrames.value(),
+		pipeline.stationaryFrames.value()));
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
+#include <wx/dialog.h>
+#include <wx/listctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "Clock.h"
+#include "HidUtils.h"
+
+namespace chiralscroll
+{
+
+// Shows live statistics for the input pipeline. The counters are sampled at a
+// low fixed rate and are only ever read, so an open window does not slow down
+// input processing.
+class DiagnosticsDialog : public wxDialog
+{
+public:
+	DiagnosticsDialog(wxWindow* parent, const absl::flat_hash_map<HANDLE, TouchDevice>& touchDevices, const Clock& clock);
+
+private:
+	void OnTimer(wxTimerEvent& event);
+	void OnClose(wxCloseEvent& event);
+
+	void Sample();
+	void ShowDevices(absl::Duration elapsed);
+	void ShowLatencies();
+
+	static constexpr int kSampleIntervalMs = 500;
+
+	const absl::flat_hash_map<HANDLE, TouchDevice>& touchDevices_;
+	const Clock& clock_;
+	wxListCtrl* deviceList_;
+	wxListCtrl* latencyList_;
+	wxStaticText* scrollSummary_;
+	wxTimer timer_;
+
+	// Counters from the previous sample, used to compute rates.
+	absl::flat_hash_map<HANDLE, TouchDevice::FrameBuilder::Stats> lastStats_;
+	absl::Time lastSample_;
+};
+
+}  // namespace chiralscroll
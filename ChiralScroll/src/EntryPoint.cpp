@@ -0,0 +1,100 @@
+#include "EntryPoint.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+
+#include <absl/time/time.h>
+#include <spdlog/spdlog.h>
+
+#include "PipelineStats.h"
+#include "Profiler.h"
+
+namespace chiralscroll
+{
+
+std::filesystem::path GetCurrentDirectory()
+{
+	const DWORD size = ::GetCurrentDirectory(0, nullptr);
+	std::wstring str(size, '\0');
+	::GetCurrentDirectory(size, str.data());
+	str.resize(size - 1);
+	return std::filesystem::path(str);
+}
+
+std::vector<std::string> GetDeviceNames(const absl::flat_hash_map<HANDLE, TouchDevice>& devices)
+{
+	std::vector<std::string> names;
+	names.reserve(devices.size());
+	for(const auto& pair : devices)
+	{
+		names.push_back(std::string(pair.second.name()));
+	}
+	return names;
+}
+
+std::optional<spdlog::level::level_enum> ParseLogLevel(std::string_view name)
+{
+	static const absl::flat_hash_map<std::string_view, spdlog::level::level_enum> levelMap = {
+		{"trace", spdlog::level::trace},
+		{"debug", spdlog::level::debug},
+		{"info", spdlog::level::info},
+		{"warn", spdlog::level::warn},
+		{"err", spdlog::level::err},
+		{"critical", spdlog::level::critical},
+		{"off", spdlog::level::off},
+	};
+	const auto level = levelMap.find(name);
+	if(level == levelMap.end())
+	{
+		return std::nullopt;
+	}
+	return level->second;
+}
+
+std::unique_ptr<Scroller> WatchScroller(InjectionWatchdog& watchdog, WinScroller::Direction dir)
+{
+	return watchdog.Watch(std::make_unique<WinScroller>(dir), std::make_unique<MessageScroller>(dir));
+}
+
+std::optional<StatsSegment> PublishStats(absl::flat_hash_map<HANDLE, TouchDevice>& devices)
+{
+	std::optional<StatsSegment> statsSegment = StatsSegment::Create();
+	if(!statsSegment)
+	{
+		return std::nullopt;
+	}
+	MovePipelineStats(statsSegment->stats().pipeline);
+	for(auto& pair : devices)
+	{
+		FrameStats* frameStats = statsSegment->AddDevice(pair.second.name());
+		if(frameStats)
+		{
+			pair.second.ShareFrameStats(*frameStats);
+		}
+	}
+	return statsSegment;
+}
+
+std::optional<int> FrameTimerDelayMs(const InputPipeline& pipeline, const Clock& clock)
+{
+	const absl::Time deadline = pipeline.frameDeadline();
+	if(deadline == absl::InfiniteFuture())
+	{
+		return std::nullopt;
+	}
+	const int64_t delayMs = absl::ToInt64Milliseconds(absl::Ceil(deadline - clock.Now(), absl::Milliseconds(1)));
+	return static_cast<int>(std::max<int64_t>(delayMs, 1));
+}
+
+#ifdef CHIRALSCROLL_PROFILE
+void WriteProfile()
+{
+	const std::filesystem::path path = GetCurrentDirectory() / "profile.txt";
+	std::ofstream file(path, std::ios::trunc);
+	file << DumpProfile();
+	SPDLOG_INFO("Wrote profile to {}.", path.string());
+}
+#endif
+
+}  // namespace chiralscroll
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <spdlog/common.h>
+
+#include "Clock.h"
+#include "HidUtils.h"
+#include "InjectionWatchdog.h"
+#include "InputPipeline.h"
+#include "Scroller.h"
+#include "StatsSegment.h"
+#include "WinScroller.h"
+
+namespace chiralscroll
+{
+
+// Startup and shutdown shared by ChiralScroll.exe and ChiralScrollDaemon.exe,
+// so that the two entry points read the touchpads and scroll the same way.
+
+std::filesystem::path GetCurrentDirectory();
+
+std::vector<std::string> GetDeviceNames(const absl::flat_hash_map<HANDLE, TouchDevice>& devices);
+
+// Parses a log level as given on the command line: trace, debug, info, warn,
+// err, critical or off. Returns nullopt for anything else.
+std::optional<spdlog::level::level_enum> ParseLogLevel(std::string_view name);
+
+// SendInput behind the watchdog, with posted messages while it is stalled.
+std::unique_ptr<Scroller> WatchScroller(InjectionWatchdog& watchdog, WinScroller::Direction dir);
+
+// Moves the statistics into shared memory, where StatsReader can see them.
+// The segment must outlive everything that records statistics. Returns
+// nullopt, leaving the statistics in process memory, if it cannot be created.
+std::optional<StatsSegment> PublishStats(absl::flat_hash_map<HANDLE, TouchDevice>& devices);
+
+// Returns how many milliseconds, at least 1, until the earliest incomplete
+// frame of the pipeline expires, or nullopt if there is none. The entry points
+// wake up then, so that a frame whose last report was lost still gets
+// delivered.
+std::optional<int> FrameTimerDelayMs(const InputPipeline& pipeline, const Clock& clock);
+
+#ifdef CHIRALSCROLL_PROFILE
+// Writes the hot path timings next to the log.
+void WriteProfile();
+#endif
+
+}  // namespace chiralscroll
@@ -0,0 +1,199 @@
+#include "FlightRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <utility>
+
+#include <intrin.h>
+
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <spdlog/spdlog.h>
+
+#include "Profiler.h"
+#include "StringUtils.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr absl::Duration kMinAnomalyInterval = absl::Minutes(1);
+
+static constexpr const char* kEventNames[] = {
+	"report",
+	"frame",
+	"expired frame",
+	"key press",
+	"session start",
+	"session end",
+	"scroll",
+	"fallback scroll",
+	"dropped scroll",
+	"injection stall",
+	"long frame",
+};
+
+}  // namespace
+
+
+FlightRecorder::~FlightRecorder()
+{
+	FinishDumps();
+}
+
+void FlightRecorder::Record(EventType type, uint8_t device, uint16_t count, int32_t value, int32_t x, int32_t y)
+{
+	const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots_[index % kCapacity];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	const EventWords words = std::bit_cast<EventWords>(Event{__rdtsc(), type, device, count, value, x, y});
+	for(size_t i = 0; i < words.size(); ++i)
+	{
+		slot.words[i].store(words[i], std::memory_order_relaxed);
+	}
+	slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::SetDeviceNames(std::vector<std::string> names)
+{
+	deviceNames_ = std::move(names);
+}
+
+std::optional<std::filesystem::path> FlightRecorder::Dump(std::string_view reason)
+{
+	const uint64_t now = __rdtsc();
+	const uint64_t end = next_.load(std::memory_order_acquire);
+	const uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+
+	std::vector<Event> events;
+	events.reserve(static_cast<size_t>(end - begin));
+	for(uint64_t index = begin; index < end; ++index)
+	{
+		const Slot& slot = slots_[index % kCapacity];
+		const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		EventWords words;
+		for(size_t i = 0; i < words.size(); ++i)
+		{
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(sequence == index + 1 && slot.sequence.load(std::memory_order_relaxed) == sequence)
+		{
+			events.push_back(std::bit_cast<Event>(words));
+		}
+	}
+
+	const absl::Time time = absl::Now();
+	// The counter keeps dumps within the same millisecond apart.
+	const std::filesystem::path path = std::filesystem::current_path() / absl::StrCat(
+		"flightrecord-",
+		absl::FormatTime("%Y%m%d-%H%M%E3S", time, absl::LocalTimeZone()),
+		"-", dumps_.fetch_add(1, std::memory_order_relaxed),
+		".txt");
+	std::ofstream file(path, std::ios::trunc);
+	if(!file)
+	{
+		SPDLOG_ERROR("Could not write flight record {}.", path.string());
+		return std::nullopt;
+	}
+	file << absl::StrFormat("Flight record at %s: %s\n", absl::FormatTime(time), ToAbslView(reason));
+	for(size_t i = 0; i < deviceNames_.size(); ++i)
+	{
+		file << absl::StrFormat("Device %d: %s\n", i, deviceNames_[i]);
+	}
+	file << absl::StrFormat("%d events, %d lost to overwriting\n\n", events.size(), end - begin - events.size());
+	file << absl::StrFormat("%12s %-16s %6s %6s %8s %8s %8s\n", "ms before", "event", "device", "count", "value", "x", "y");
+	for(const Event& event : events)
+	{
+		const double msBefore = now > event.cycles ? CyclesToNanoseconds(now - event.cycles) / 1e6 : 0.0;
+		file << absl::StrFormat("%12.3f %-16s %6d %6d %8d %8d %8d\n",
+			msBefore,
+			kEventNames[static_cast<size_t>(event.type)],
+			event.device,
+			event.count,
+			event.value,
+			event.x,
+			event.y);
+	}
+	SPDLOG_WARN("Wrote flight record to {}: {}", path.string(), reason);
+	return path;
+}
+
+void FlightRecorder::RequestDump(std::string_view reason)
+{
+	{
+		std::lock_guard<std::mutex> lock(dumpMutex_);
+		if(dumpsFinished_ || dumpReason_)
+		{
+			return;
+		}
+		dumpReason_ = std::string(reason);
+		if(!dumpThread_.joinable())
+		{
+			dumpThread_ = std::thread(&FlightRecorder::RunDumps, this);
+		}
+	}
+	dumpRequested_.notify_one();
+}
+
+void FlightRecorder::FinishDumps()
+{
+	{
+		std::lock_guard<std::mutex> lock(dumpMutex_);
+		dumpsFinished_ = true;
+	}
+	dumpRequested_.notify_one();
+	if(dumpThread_.joinable())
+	{
+		dumpThread_.join();
+	}
+}
+
+void FlightRecorder::RunDumps()
+{
+	std::unique_lock<std::mutex> lock(dumpMutex_);
+	while(true)
+	{
+		dumpRequested_.wait(lock, [this] { return dumpsFinished_ || dumpReason_; });
+		if(!dumpReason_)
+		{
+			return;
+		}
+		// Cleared only once written, so that requests made meanwhile are
+		// dropped rather than dumping the same events again.
+		const std::string reason = *dumpReason_;
+		lock.unlock();
+		Dump(reason);
+		lock.lock();
+		dumpReason_.reset();
+	}
+}
+
+void FlightRecorder::DumpOnAnomaly(std::string_view reason)
+{
+	const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	int64_t next = nextAnomalyDumpNs_.load(std::memory_order_relaxed);
+	if(!anomalyDumps_.load(std::memory_order_relaxed) ||
+	   now < next ||
+	   !nextAnomalyDumpNs_.compare_exchange_strong(next, now + absl::ToInt64Nanoseconds(kMinAnomalyInterval), std::memory_order_relaxed))
+	{
+		return;
+	}
+	RequestDump(reason);
+}
+
+FlightRecorder& GetFlightRecorder()
+{
+	static FlightRecorder recorder;
+	return recorder;
+}
+
+}  // namespace chiralscroll
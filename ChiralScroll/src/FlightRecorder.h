@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace chiralscroll
+{
+
+// Always records the most recent input and output events in a fixed ring in
+// memory, so that there is something to look at when scrolling misbehaves
+// with logging at warn level. The ring holds kCapacity events, which is about
+// the last minute at a typical report rate. Events are formatted only when the
+// ring is dumped to a text file.
+//
+// Recording takes a slot with a single atomic increment and never blocks, so
+// any thread may record. A dump can run while events are being recorded; a
+// slot that is overwritten while it is being read is left out.
+class FlightRecorder
+{
+public:
+	FlightRecorder() = default;
+	~FlightRecorder();
+
+	FlightRecorder(const FlightRecorder&) = delete;
+	FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+	enum class EventType : uint8_t
+	{
+		// A decoded report. count is the contact count field, value the scan
+		// time or -1, and x the number of contacts in the report.
+		kReport,
+		// A finished frame. count is the number of contacts, value how many of
+		// them touch, and x and y the position of the first one.
+		kFrame,
+		// A partial frame delivered after its deadline or cut off by the next
+		// report, with the same fields as kFrame.
+		kExpiredFrame,
+		kKeyPress,
+		// value is 0 for a non-scrolling session, 1 for vertical and 2 for
+		// horizontal scrolling.
+		kSessionStart,
+		kSessionEnd,
+		// A scroll amount queued for injection, sent through the fallback, or
+		// dropped. value is the amount, device 0 for vertical and 1 for
+		// horizontal.
+		kScroll,
+		kFallbackScroll,
+		kDroppedScroll,
+		// An injection call that stalled, value in milliseconds.
+		kInjectionStall,
+		// A frame that took long to handle, value in microseconds.
+		kLongFrame,
+	};
+
+	struct Event
+	{
+		uint64_t cycles;
+		EventType type;
+		uint8_t device;
+		uint16_t count;
+		int32_t value;
+		int32_t x;
+		int32_t y;
+	};
+
+	static constexpr size_t kCapacity = 1 << 15;
+
+	void Record(EventType type, uint8_t device = 0, uint16_t count = 0, int32_t value = 0, int32_t x = 0, int32_t y = 0);
+
+	// Names the device indices in dumps. Must be called before any recording.
+	void SetDeviceNames(std::vector<std::string> names);
+
+	// Writes the ring to a new file in the current directory and returns its
+	// path, or nullopt if it could not be written. Every dump gets its own
+	// file, even several in the same second.
+	std::optional<std::filesystem::path> Dump(std::string_view reason);
+
+	// Dumps on the dump thread, so that the caller is not held up by the disk.
+	// A request made while another is waiting or being written is dropped,
+	// since that dump holds the same events.
+	void RequestDump(std::string_view reason);
+
+	// Waits for a requested dump to be written and stops the dump thread, so
+	// that no dump is cut off when the process exits. Called before logging
+	// shuts down. Later requests are dropped.
+	void FinishDumps();
+
+	// Like RequestDump, but at most once per kMinAnomalyInterval on the steady
+	// clock, so that a run of anomalies does not fill the disk.
+	void DumpOnAnomaly(std::string_view reason);
+
+	// Turns DumpOnAnomaly on or off. Tools that cause anomalies on purpose
+	// turn it off.
+	void SetAnomalyDumps(bool enabled)
+	{
+		anomalyDumps_.store(enabled, std::memory_order_relaxed);
+	}
+
+private:
+	using EventWords = std::array<uint64_t, sizeof(Event)/sizeof(uint64_t)>;
+	static_assert(sizeof(Event) % sizeof(uint64_t) == 0);
+
+	struct Slot
+	{
+		// Index of the event plus one, or 0 while it is being written.
+		std::atomic<uint64_t> sequence{0};
+		// The event, stored word by word so that a dump can read it while it
+		// is being overwritten.
+		std::array<std::atomic<uint64_t>, std::tuple_size_v<EventWords>> words{};
+	};
+
+	void RunDumps();
+
+	std::array<Slot, kCapacity> slots_;
+	std::atomic<uint64_t> next_{0};
+	std::atomic<int64_t> nextAnomalyDumpNs_{0};
+	std::atomic<bool> anomalyDumps_{true};
+	// Numbers the dump files.
+	std::atomic<uint64_t> dumps_{0};
+	std::vector<std::string> deviceNames_;
+
+	// Guards the dump thread and its request.
+	std::mutex dumpMutex_;
+	std::condition_variable dumpRequested_;
+	std::optional<std::string> dumpReason_;
+	bool dumpsFinished_ = false;
+	// Started by the first request.
+	std::thread dumpThread_;
+};
+
+FlightRecorder& GetFlightRecorder();
+
+}  // namespace chiralscroll
@@ -0,0 +1,66 @@
+#include "FrameMailbox.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "PipelineStats.h"
+
+namespace chiralscroll
+{
+
+void FrameMailbox::Post(const Touchpad& device, std::vector<Touchpad::Contact> contacts, absl::Time time, absl::Time now)
+{
+	if(policy_ == Policy::kInOrder)
+	{
+		frames_.push_back({&device, now, time, std::move(contacts)});
+		return;
+	}
+
+	// A frame is motion if the same contacts were touching in the frame
+	// before it, and none of them lifted.
+	const bool allTouching = GetTouchingIds(contacts, &ids_);
+	std::vector<ULONG>& lastIds = lastIds_[&device];
+	const bool motion = allTouching && ids_ == lastIds;
+	std::swap(lastIds, ids_);
+
+	if(!motion)
+	{
+		waitingMotion_.erase(&device);
+		frames_.push_back({&device, now, time, std::move(contacts)});
+		return;
+	}
+
+	const auto it = waitingMotion_.find(&device);
+	if(it != waitingMotion_.end())
+	{
+		// Keep the time the replaced frame was posted, so how long the slot
+		// has been waiting stays bounded.
+		frames_[it->second].time = time;
+		frames_[it->second].contacts = std::move(contacts);
+		++GetPipelineStats().shedFrames;
+		return;
+	}
+	waitingMotion_[&device] = frames_.size();
+	frames_.push_back({&device, now, time, std::move(contacts)});
+}
+
+bool FrameMailbox::GetTouchingIds(const std::vector<Touchpad::Contact>& contacts, std::vector<ULONG>* ids)
+{
+	ids->clear();
+	bool allTouching = true;
+	for(const auto& contact : contacts)
+	{
+		if(contact.isTouch)
+		{
+			ids->push_back(contact.id);
+		}
+		else
+		{
+			allTouching = false;
+		}
+	}
+	std::sort(ids->begin(), ids->end());
+	return allTouching;
+}
+
+}  // namespace chiralscroll
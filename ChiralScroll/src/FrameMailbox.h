@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
+
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+// Hands complete frames from frame assembly to the gesture code.
+//
+// With the latest-wins policy, a frame that only moves the same contacts as
+// the frame before it replaces the previous such frame of the same device
+// while both are waiting. When input backs up, the gesture code then skips to
+// the newest position instead of working through every frame in the backlog.
+// Frames in which a contact touches down or lifts are never replaced, so the
+// gesture code sees every transition in order.
+class FrameMailbox
+{
+public:
+	enum class Policy { kInOrder, kLatestWins };
+
+	struct Frame
+	{
+		const Touchpad* device;
+		// When the oldest frame merged into this one was posted.
+		absl::Time posted;
+		// When the newest frame merged into this one was scanned, which the
+		// gesture code measures velocity with.
+		absl::Time time;
+		std::vector<Touchpad::Contact> contacts;
+	};
+
+	explicit FrameMailbox(Policy policy) : policy_(policy) {}
+
+	Policy policy() const
+	{
+		return policy_;
+	}
+
+	bool empty() const
+	{
+		return frames_.empty();
+	}
+
+	// When the oldest waiting frame was posted, or InfiniteFuture if none is
+	// waiting.
+	absl::Time oldest() const
+	{
+		return frames_.empty() ? absl::InfiniteFuture() : frames_.front().posted;
+	}
+
+	// Adds a frame of the given device, which must outlive the mailbox,
+	// scanned at the given time.
+	void Post(const Touchpad& device, std::vector<Touchpad::Contact> contacts, absl::Time time, absl::Time now);
+
+	// Calls deliver with each waiting frame in order, and empties the
+	// mailbox.
+	template<typename F>
+	void Drain(F&& deliver)
+	{
+		for(const Frame& frame : frames_)
+		{
+			deliver(frame);
+		}
+		frames_.clear();
+		waitingMotion_.clear();
+	}
+
+private:
+	// Sets the sorted IDs of the touching contacts, and returns whether every
+	// contact is touching.
+	static bool GetTouchingIds(const std::vector<Touchpad::Contact>& contacts, std::vector<ULONG>* ids);
+
+	Policy policy_;
+	std::vector<Frame> frames_;
+	// Index of the newest waiting frame of each device, if that frame only
+	// moved contacts and may be replaced.
+	absl::flat_hash_map<const Touchpad*, size_t> waitingMotion_;
+	// The touching contacts in the newest frame of each device.
+	absl::flat_hash_map<const Touchpad*, std::vector<ULONG>> lastIds_;
+	std::vector<ULONG> ids_;
+};
+
+}  // namespace chiralscroll
@@ -0,0 +1,171 @@
+#include "FrameSegment.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "ChiralScrollException.h"
+
+namespace chiralscroll
+{
+
+FrameSegment::Reader::Reader(const FrameSegment& segment)
+	: frames_(segment.frames()),
+	  next_(frames_.next.load(std::memory_order_acquire)),
+	  lost_(0)
+{
+}
+
+bool FrameSegment::Reader::Next(SharedFrames::Frame* frame)
+{
+	while(true)
+	{
+		const uint64_t end = frames_.next.load(std::memory_order_acquire);
+		if(next_ >= end)
+		{
+			return false;
+		}
+		if(end - next_ > SharedFrames::kCapacity)
+		{
+			lost_ += end - next_ - SharedFrames::kCapacity;
+			next_ = end - SharedFrames::kCapacity;
+		}
+
+		const SharedFrames::Slot& slot = frames_.slots[next_ % SharedFrames::kCapacity];
+		const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		*frame = slot.frame;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const bool whole = sequence == next_ + 1 && slot.sequence.load(std::memory_order_relaxed) == sequence;
+		++next_;
+		if(whole)
+		{
+			return true;
+		}
+		++lost_;
+	}
+}
+
+std::optional<FrameSegment> FrameSegment::Create(const std::vector<std::string>& deviceNames, const wchar_t* name)
+{
+	const HANDLE mapping = CreateFileMapping(
+		INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedFrames), name);
+	if(!mapping)
+	{
+		SPDLOG_WARN("Could not create the frame segment: {}", GetErrorMessage(GetLastError()));
+		return std::nullopt;
+	}
+	if(GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		SPDLOG_WARN("The frame segment is owned by another process, not publishing frames.");
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedFrames));
+	if(!view)
+	{
+		SPDLOG_WARN("Could not map the frame segment: {}", GetErrorMessage(GetLastError()));
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	// The pages of a new mapping are zeroed, but the atomics still need to be
+	// constructed.
+	SharedFrames* frames = new(view) SharedFrames();
+	frames->version = SharedFrames::kVersion;
+	frames->processId = GetCurrentProcessId();
+	frames->deviceCount = static_cast<uint32_t>(std::min(deviceNames.size(), SharedFrames::kMaxDevices));
+	if(deviceNames.size() > SharedFrames::kMaxDevices)
+	{
+		SPDLOG_WARN("Only publishing frames of the first {} devices.", SharedFrames::kMaxDevices);
+	}
+	for(uint32_t i = 0; i < frames->deviceCount; ++i)
+	{
+		const size_t length = std::min(deviceNames[i].size(), SharedFrames::kMaxNameLength - 1);
+		std::copy_n(deviceNames[i].begin(), length, frames->devices[i].begin());
+		frames->devices[i][length] = '\0';
+	}
+	frames->magic.store(SharedFrames::kMagic, std::memory_order_release);
+	return FrameSegment(mapping, frames);
+}
+
+std::optional<FrameSegment> FrameSegment::Open(const wchar_t* name)
+{
+	const HANDLE mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name);
+	if(!mapping)
+	{
+		return std::nullopt;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(SharedFrames));
+	if(!view)
+	{
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	SharedFrames* frames = static_cast<SharedFrames*>(view);
+	if(frames->magic.load(std::memory_order_acquire) != SharedFrames::kMagic
+	   || frames->version != SharedFrames::kVersion)
+	{
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+	return FrameSegment(mapping, frames);
+}
+
+FrameSegment::FrameSegment(FrameSegment&& other) noexcept
+	: mapping_(std::exchange(other.mapping_, nullptr)),
+	  frames_(std::exchange(other.frames_, nullptr))
+{
+}
+
+FrameSegment::~FrameSegment()
+{
+	if(frames_)
+	{
+		UnmapViewOfFile(frames_);
+	}
+	if(mapping_)
+	{
+		CloseHandle(mapping_);
+	}
+}
+
+void FrameSegment::Publish(uint32_t device, const Touchpad& touchpad, const std::vector<Touchpad::Contact>& contacts, absl::Time now)
+{
+	if(device >= frames_->deviceCount)
+	{
+		return;
+	}
+
+	const uint64_t index = frames_->next.load(std::memory_order_relaxed);
+	SharedFrames::Slot& slot = frames_->slots[index % SharedFrames::kCapacity];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	SharedFrames::Frame& frame = slot.frame;
+	frame.timeUs = absl::ToUnixMicros(now);
+	frame.device = device;
+	frame.contactCount = static_cast<uint32_t>(std::min(contacts.size(), SharedFrames::kMaxContacts));
+	for(uint32_t i = 0; i < frame.contactCount; ++i)
+	{
+		const Touchpad::Contact& contact = contacts[i];
+		const Touchpad::ContactInfo::Area& area = touchpad.GetContactInfo(contact.contactInfoLink).logicalArea;
+		frame.contacts[i] = {
+			contact.id,
+			contact.isTouch,
+			contact.confidence,
+			static_cast<float>(static_cast<LONG>(contact.logicalX) - area.left)/static_cast<float>(area.right - area.left),
+			static_cast<float>(static_cast<LONG>(contact.logicalY) - area.top)/static_cast<float>(area.bottom - area.top),
+		};
+	}
+
+	slot.sequence.store(index + 1, std::memory_order_release);
+	frames_->next.store(index + 1, std::memory_order_release);
+}
+
+}  // namespace chiralscroll
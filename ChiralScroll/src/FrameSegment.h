@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/time/time.h>
+
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+static constexpr wchar_t kFrameSegmentName[] = L"Local\\ChiralScrollFrames";
+
+// Layout of the contact frame ring shared with other local tools. Both sides
+// must be built from the same version of this header; bump kVersion when
+// changing it.
+//
+// There is a single writer. Frame i goes into slots[i % kCapacity], and next
+// is the number of frames written so far. A slot's sequence is 0 while it is
+// being written and i + 1 once frame i is in it, so a reader that copies a
+// slot and then sees the same sequence as before knows the copy is whole.
+struct SharedFrames
+{
+	static constexpr uint64_t kMagic = 0x53454D4152465343;  // "CSFRAMES"
+	static constexpr uint32_t kVersion = 1;
+	// About a second of frames from one touchpad.
+	static constexpr size_t kCapacity = 1024;
+	static constexpr size_t kMaxContacts = 16;
+	static constexpr size_t kMaxDevices = 8;
+	static constexpr size_t kMaxNameLength = 256;
+
+	struct Contact
+	{
+		uint32_t id;
+		bool isTouch;
+		bool confidence;
+		// Position as a fraction of the contact's logical area, from the top
+		// left.
+		float x;
+		float y;
+	};
+
+	struct Frame
+	{
+		// When the frame was finished, in microseconds of the pipeline clock.
+		// Only differences are meaningful.
+		int64_t timeUs;
+		// Index into devices.
+		uint32_t device;
+		// Frames with more than kMaxContacts contacts are cut short.
+		uint32_t contactCount;
+		std::array<Contact, kMaxContacts> contacts;
+	};
+
+	// Padded to a cache line so that a reader copying one slot does not share
+	// a line with the writer filling the next.
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> sequence;
+		Frame frame;
+	};
+
+	// Set last, once the rest of the header is valid.
+	std::atomic<uint64_t> magic;
+	uint32_t version;
+	uint32_t processId;
+	uint32_t deviceCount;
+	std::array<std::array<char, kMaxNameLength>, kMaxDevices> devices;
+	alignas(64) std::atomic<uint64_t> next;
+	std::array<Slot, kCapacity> slots;
+};
+
+// A named shared memory segment holding SharedFrames, through which other
+// processes can follow the decoded contact frames without registering for raw
+// input themselves. Publishing writes each frame straight into its slot and
+// never waits for readers, and readers map the segment read-only, so a slow
+// or stuck reader only loses frames and cannot slow down the input path.
+class FrameSegment
+{
+public:
+	// Reads the frames of a segment in order. Each reader keeps its own
+	// position, so any number of them can follow the same segment.
+	class Reader
+	{
+	public:
+		// Starts at the next frame to be written.
+		explicit Reader(const FrameSegment& segment);
+
+		// Copies the next frame and returns true, or returns false if no new
+		// frame has been written. Frames that were overwritten before they
+		// could be read are skipped.
+		bool Next(SharedFrames::Frame* frame);
+
+		// Frames skipped so far.
+		uint64_t lost() const
+		{
+			return lost_;
+		}
+
+	private:
+		const SharedFrames& frames_;
+		uint64_t next_;
+		uint64_t lost_;
+	};
+
+	// Creates the segment with the given devices, in the order of their
+	// indices in frames. Returns nullopt if it cannot be created, for example
+	// because another instance is already running.
+	static std::optional<FrameSegment> Create(
+		const std::vector<std::string>& deviceNames, const wchar_t* name = kFrameSegmentName);
+
+	// Opens an existing segment for reading. Returns nullopt if there is none
+	// or it has a different layout.
+	static std::optional<FrameSegment> Open(const wchar_t* name = kFrameSegmentName);
+
+	FrameSegment(FrameSegment&& other) noexcept;
+	FrameSegment& operator=(FrameSegment&&) = delete;
+	FrameSegment(const FrameSegment&) = delete;
+	FrameSegment& operator=(const FrameSegment&) = delete;
+	~FrameSegment();
+
+	const SharedFrames& frames() const
+	{
+		return *frames_;
+	}
+
+	// Writes a frame of the device with the given index. Only the creating
+	// process may call this, and only from one thread.
+	void Publish(uint32_t device, const Touchpad& touchpad, const std::vector<Touchpad::Contact>& contacts, absl::Time now);
+
+private:
+	FrameSegment(HANDLE mapping, SharedFrames* frames) : mapping_(mapping), frames_(frames) {}
+
+	HANDLE mapping_;
+	SharedFrames* frames_;
+};
+
+}  // namespace chiralscroll
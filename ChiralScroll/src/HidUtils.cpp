@@ -1,11 +1,15 @@
 #include "HidUtils.h"
 
+#include <algorithm>
 #include <functional>
 
 #include <absl/strings/string_view.h>
 #include <absl/strings/substitute.h>
 #include <spdlog/spdlog.h>
 
+#include "Logging.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
 #include "StringUtils.h"
 
 namespace chiralscroll
@@ -155,6 +159,17 @@ std::vector<HIDP_BUTTON_CAPS> GetButtonCaps(const HIDP_CAPS& caps, const RawInpu
 	return buttonCaps;
 }
 
+// The most buttons that can be pressed at once on any one usage page.
+ULONG GetMaxUsageListLength(const std::vector<HIDP_BUTTON_CAPS>& buttonCaps, const RawInputDevice& device)
+{
+	ULONG maxLength = 0;
+	for(const HIDP_BUTTON_CAPS& cap : buttonCaps)
+	{
+		maxLength = std::max(maxLength, HidP_MaxUsageListLength(HidP_Input, cap.UsagePage, device.preparsedData()));
+	}
+	return maxLength;
+}
+
 template<typename T>
 std::vector<std::reference_wrapper<const T>> FindCaps(const std::vector<T>& caps, Usage usage)
 {
@@ -182,6 +197,72 @@ std::optional<USHORT> FindFirstLink(Usage usage, const std::vector<T>& caps)
 	return matchingCaps[0].get().LinkCollection;
 }
 
+// Reads the fields of each contact collection from an HID report, for
+// DecodeContacts.
+class HidContactFields
+{
+public:
+	HidContactFields(const HidDevice& device, const HidData& hidData, const std::vector<TouchDevice::ContactInfo>& contactInfo)
+		: device_(device),
+		  hidData_(hidData),
+		  contactInfo_(contactInfo) {}
+
+	size_t slotCount() const
+	{
+		return contactInfo_.size();
+	}
+
+	ULONG Link(size_t slot) const
+	{
+		return contactInfo_[slot].link;
+	}
+
+	NTSTATUS Id(size_t slot, ULONG* id) const
+	{
+		return device_.GetLogicalValue(
+			hidData_, {HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONTACT_ID}, contactInfo_[slot].link, id);
+	}
+
+	NTSTATUS TipSwitch(size_t slot, bool* isTouch) const
+	{
+		return device_.GetButton(
+			hidData_, {HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TIP_SWITCH}, contactInfo_[slot].link, isTouch);
+	}
+
+	NTSTATUS Confidence(size_t slot, bool* confidence) const
+	{
+		return device_.GetButton(
+			hidData_, {HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONFIDENCE}, contactInfo_[slot].link, confidence);
+	}
+
+	NTSTATUS Position(size_t slot, ULONG* x, ULONG* y) const
+	{
+		const USHORT link = contactInfo_[slot].link;
+		const NTSTATUS status = device_.GetLogicalValue(hidData_, {HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_X}, link, x);
+		if(status != HIDP_STATUS_SUCCESS)
+		{
+			return status;
+		}
+		return device_.GetLogicalValue(hidData_, {HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_Y}, link, y);
+	}
+
+	NTSTATUS PhysicalPosition(size_t slot, LONG* x, LONG* y) const
+	{
+		const USHORT link = contactInfo_[slot].link;
+		const NTSTATUS status = device_.GetPhysicalValue(hidData_, {HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_X}, link, x);
+		if(status != HIDP_STATUS_SUCCESS)
+		{
+			return status;
+		}
+		return device_.GetPhysicalValue(hidData_, {HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_Y}, link, y);
+	}
+
+private:
+	const HidDevice& device_;
+	const HidData& hidData_;
+	const std::vector<TouchDevice::ContactInfo>& contactInfo_;
+};
+
 }  // namespace
 
 
@@ -205,7 +286,8 @@ HidDevice::HidDevice(RawInputDevice rawDevice) :
 	RawInputDevice(std::move(rawDevice)),
 	caps_(GetCaps(*this)),
 	valueCaps_(GetValueCaps(caps_, *this)),
-	buttonCaps_(GetButtonCaps(caps_, *this)) {}
+	buttonCaps_(GetButtonCaps(caps_, *this)),
+	usages_(GetMaxUsageListLength(buttonCaps_, *this)) {}
 
 
 std::vector<std::reference_wrapper<const HIDP_VALUE_CAPS>> HidDevice::FindValueCaps(Usage usage) const
@@ -227,7 +309,7 @@ NTSTATUS HidDevice::GetLogicalValue(const HidData& hidData, Usage usage, USHORT
 		usage.id,
 		value,
 		preparsedData(),
-		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData.data())),
+		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData)),
 		hidData.hid.dwSizeHid);
 }
 
@@ -282,7 +364,7 @@ NTSTATUS HidDevice::GetPhysicalValue(const HidData& hidData, Usage usage, USHORT
 		usage.id,
 		value,
 		preparsedData(),
-		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData.data())),
+		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData)),
 		hidData.hid.dwSizeHid);
 }
 
@@ -328,23 +410,30 @@ std::optional<LONG> HidDevice::GetPhysicalValueOrNullopt(const HidData& hidData,
 	}
 }
 
-NTSTATUS HidDevice::GetUsages(const HidData& hidData, Usage usage, USHORT link, std::vector<USAGE>* usages) const
+NTSTATUS HidDevice::GetUsages(const HidData& hidData, Usage usage, USHORT link, ULONG* count) const
 {
-	ULONG numUsages = HidP_MaxUsageListLength(
-		HidP_Input,
-		usage.page,
-		preparsedData());
-	usages->resize(numUsages);
-	NTSTATUS status = HidP_GetUsages(
+	*count = static_cast<ULONG>(usages_.size());
+	const NTSTATUS status = HidP_GetUsages(
 		HidP_Input,
 		usage.page,
 		link,
-		usages->data(),
-		&numUsages,
+		usages_.data(),
+		count,
 		preparsedData(),
-		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData.data())),
+		reinterpret_cast<PCHAR>(const_cast<uint8_t*>(hidData.rawData)),
 		hidData.hid.dwSizeHid);
-	usages->resize(numUsages);
+	if(status != HIDP_STATUS_SUCCESS)
+	{
+		*count = 0;
+	}
+	return status;
+}
+
+NTSTATUS HidDevice::GetButton(const HidData& hidData, Usage usage, USHORT link, bool* value) const
+{
+	ULONG count;
+	const NTSTATUS status = GetUsages(hidData, usage, link, &count);
+	*value = std::find(usages_.begin(), usages_.begin() + count, usage.id) != usages_.begin() + count;
 	return status;
 }
 
@@ -359,13 +448,89 @@ bool HidDevice::GetButton(const HidData& hidData, Usage usage, std::optional<USH
 			return false;
 		}
 	}
-	std::vector<USAGE> usages;
-	THROW_IF_NTERROR(GetUsages(hidData, usage, *link, &usages),
+	ULONG count;
+	THROW_IF_NTERROR(GetUsages(hidData, usage, *link, &count),
 		absl::StrCat("In HidP_GetUsages for device ", ToAbslView(name())));
-	return std::find(usages.begin(), usages.end(), usage.id) != usages.end();
+	return std::find(usages_.begin(), usages_.begin() + count, usage.id) != usages_.begin() + count;
 }
 
 
+uint32_t ContactFieldCache::FieldsFor(ULONG id) const
+{
+	if(decodeAll_ || !contacts_.contains(id))
+	{
+		return kAllFields;
+	}
+	return kPosition;
+}
+
+void ContactFieldCache::CheckLostFrames(const FrameStats& stats)
+{
+	const uint64_t lostFrames = stats.partialFrames.value() + stats.droppedFrames.value() + stats.strayReports.value();
+	if(lostFrames != lostFrames_)
+	{
+		lostFrames_ = lostFrames;
+		contacts_.clear();
+	}
+}
+
+void ContactFieldCache::Complete(uint32_t decoded, Touchpad::Contact* contact)
+{
+	if(!contact->isTouch)
+	{
+		const auto it = contacts_.find(contact->id);
+		if(it != contacts_.end())
+		{
+			if(!(decoded & kConfidence))
+			{
+				contact->confidence = it->second.confidence;
+			}
+			if(!(decoded & kPosition))
+			{
+				contact->logicalX = it->second.logicalX;
+				contact->logicalY = it->second.logicalY;
+			}
+			if(!(decoded & kPhysicalPosition))
+			{
+				contact->physicalX = it->second.physicalX;
+				contact->physicalY = it->second.physicalY;
+			}
+			contacts_.erase(it);
+		}
+		return;
+	}
+
+	Touchpad::Contact& cached = contacts_[contact->id];
+	if(decoded & kConfidence)
+	{
+		cached.confidence = contact->confidence;
+	}
+	else
+	{
+		contact->confidence = cached.confidence;
+	}
+	if(decoded & kPosition)
+	{
+		cached.logicalX = contact->logicalX;
+		cached.logicalY = contact->logicalY;
+	}
+	else
+	{
+		contact->logicalX = cached.logicalX;
+		contact->logicalY = cached.logicalY;
+	}
+	if(decoded & kPhysicalPosition)
+	{
+		cached.physicalX = contact->physicalX;
+		cached.physicalY = contact->physicalY;
+	}
+	else
+	{
+		contact->physicalX = cached.physicalX;
+		contact->physicalY = cached.physicalY;
+	}
+}
+
 std::optional<TouchDevice> TouchDevice::FromHandle(const HANDLE hDevice, bool panicOnUnexpectedInput)
 {
 	std::optional<HidDevice> hidDevice = HidDevice::FromHandle(hDevice);
@@ -386,94 +551,176 @@ std::optional<TouchDevice> TouchDevice::FromHandle(const HANDLE hDevice, bool pa
 	{
 		return std::nullopt;
 	}
-	return TouchDevice(std::move(*hidDevice), std::move(contacts), contactCountCaps[0].get().LinkCollection, panicOnUnexpectedInput);
+	const auto scanTimeCaps =
+		hidDevice->FindValueCaps({HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_SCAN_TIME});
+	const std::optional<USHORT> linkScanTime = scanTimeCaps.empty()
+		? std::nullopt
+		: std::optional<USHORT>(scanTimeCaps[0].get().LinkCollection);
+	return TouchDevice(
+		std::move(*hidDevice),
+		std::move(contacts),
+		contactCountCaps[0].get().LinkCollection,
+		linkScanTime,
+		panicOnUnexpectedInput);
 }
 
-const TouchDevice::ContactInfo& TouchDevice::GetContactInfo(ULONG link) const
+TouchDevice::FrameBuilder::Frames TouchDevice::GetContacts(const HidData& hidData, absl::Time now)
 {
-	return *std::find_if(contactInfo_.begin(), contactInfo_.end(),
-		[link](const TouchDevice::ContactInfo& info) {
-			return info.link == link;
-		});
+	const std::optional<FrameBuilder::Report> report = DecodeReport(hidData, now);
+	if(!report)
+	{
+		return {};
+	}
+	return AddReport(*report, now);
 }
 
-std::optional<std::vector<TouchDevice::Contact>> TouchDevice::GetContacts(const HidData& hidData)
+std::optional<TouchDevice::FrameBuilder::Report> TouchDevice::DecodeReport(const HidData& hidData, absl::Time now)
 {
-	const ULONG contactCount = GetLogicalValue(
-		hidData,
-		{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONTACT_COUNT},
-		linkContactCount_);
+	FrameBuilder::Stats& stats = frameBuilder_.stats();
+	if(now < quarantinedUntil_)
+	{
+		++stats.quarantinedReports;
+		return std::nullopt;
+	}
 
-	if(!frameBuilder_.InProgress())
+	std::optional<FrameBuilder::Report> report;
+	const NTSTATUS status = TryDecodeReport(hidData, &report);
+	if(status == HIDP_STATUS_SUCCESS)
 	{
-		if(contactCount == 0)
+		consecutiveErrors_ = 0;
+		// Forget past quarantines once the device has behaved for as long as
+		// the next one would last.
+		if(now - quarantinedUntil_ > quarantineBackoff_)
 		{
-			// This can be caused by touchpad buttons clicking or releasing
-			// without a touch. We don't want to bother tracking all of this,
-			// so we just ignore these reports.
-			return std::nullopt;
+			quarantineBackoff_ = kMinQuarantine;
 		}
-		frameBuilder_.Start(contactCount);
-		SPDLOG_DEBUG("Expecting {} contacts.", contactCount);
+		return report;
 	}
-	const auto contacts = GetContactsInReport(hidData);
-	return frameBuilder_.AddReport(contacts);
+
+	++stats.decodeErrors;
+	if(panicOnUnexpectedInput_)
+	{
+		throw ChiralScrollException::FromNtstatus(
+			status, absl::StrCat("Decoding report from device ", ToAbslView(name())));
+	}
+	SPDLOG_WARN_EVERY(kDefaultLogInterval, "Could not decode report from device {}: {}",
+		name(), NtstatusToString(status));
+	if(++consecutiveErrors_ >= kQuarantineThreshold)
+	{
+		Quarantine(now);
+	}
+	return std::nullopt;
 }
 
-std::vector<TouchDevice::Contact> TouchDevice::GetContactsInReport(const HidData& hidData)
+void TouchDevice::CountReadError(DWORD error, absl::Time now)
 {
-	std::vector<Contact> contacts;
-	contacts.reserve(contactInfo_.size());
-	for(const auto& contactInfo : contactInfo_)
+	++frameBuilder_.stats().decodeErrors;
+	if(panicOnUnexpectedInput_)
 	{
-		const std::optional<ULONG> contactId = GetLogicalValueOrNullopt(
+		throw ChiralScrollException(
+			absl::StrCat("Reading input from device ", ToAbslView(name()), ": ", GetErrorMessage(error)));
+	}
+	SPDLOG_WARN_EVERY(kDefaultLogInterval, "Could not read input from device {}: {}",
+		name(), GetErrorMessage(error));
+	if(++consecutiveErrors_ >= kQuarantineThreshold)
+	{
+		Quarantine(now);
+	}
+}
+
+NTSTATUS TouchDevice::TryDecodeReport(const HidData& hidData, std::optional<FrameBuilder::Report>* report)
+{
+	PROFILE_SCOPE(kDecodeReport);
+	report->reset();
+	ULONG contactCount;
+	NTSTATUS status = GetLogicalValue(
+		hidData,
+		{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONTACT_COUNT},
+		linkContactCount_,
+		&contactCount);
+	if(status != HIDP_STATUS_SUCCESS)
+	{
+		return status;
+	}
+
+	if(!frameBuilder_.InProgress() && contactCount == 0)
+	{
+		// This can be caused by touchpad buttons clicking or releasing
+		// without a touch. We don't want to bother tracking all of this,
+		// so we just ignore these reports.
+		return HIDP_STATUS_SUCCESS;
+	}
+
+	std::optional<ULONG> scanTime;
+	if(linkScanTime_)
+	{
+		ULONG value;
+		status = GetLogicalValue(
 			hidData,
-			{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONTACT_ID},
-			contactInfo.link);
-		if(contactId)
+			{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_SCAN_TIME},
+			*linkScanTime_,
+			&value);
+		if(status == HIDP_STATUS_SUCCESS)
 		{
-			const bool isTouch = GetButton(
-				hidData,
-				{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TIP_SWITCH},
-				contactInfo.link);
-			const bool confidence = GetButton(
-				hidData,
-				{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_CONFIDENCE},
-				contactInfo.link);
-			const ULONG logicalX = GetLogicalValue(
-				hidData,
-				{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_X},
-				contactInfo.link);
-			const ULONG logicalY = GetLogicalValue(
-				hidData,
-				{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_Y},
-				contactInfo.link);
-			const LONG physicalX = GetPhysicalValue(
-				hidData,
-				{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_X},
-				contactInfo.link);
-			const LONG physicalY = GetPhysicalValue(
-				hidData,
-				{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_Y},
-				contactInfo.link);
-			contacts.push_back({*contactId, contactInfo.link, isTouch, confidence, logicalX, logicalY, physicalX, physicalY});
+			scanTime = value;
+		}
+		else if(status != HIDP_STATUS_USAGE_NOT_FOUND)
+		{
+			return status;
 		}
 	}
-	SPDLOG_DEBUG("Report:");
-	SPDLOG_TRACE("  button1={}, button2={}, button3={}",
-		GetButton(hidData, {0x09, 0x01}), GetButton(hidData, {0x09, 0x02}), GetButton(hidData, {0x09, 0x03}));
-	for(const auto& contact : contacts)
+
+	std::vector<Contact> contacts;
+	status = GetContactsInReport(hidData, &contacts);
+	if(status != HIDP_STATUS_SUCCESS)
 	{
-		SPDLOG_DEBUG("  id={}, link={}, isTouch={}, confidence={}, x={}, y={}",
-			contact.id, contact.contactInfoLink, contact.isTouch, contact.confidence, contact.logicalX, contact.logicalY);
+		return status;
 	}
-	return contacts;
+	report->emplace(FrameBuilder::Report{contactCount, scanTime, std::move(contacts)});
+	return HIDP_STATUS_SUCCESS;
 }
 
-void TouchDevice::FrameBuilder::Start(ULONG expectedContactCount)
+void TouchDevice::Quarantine(absl::Time now)
 {
-	expectedContactCount_ = expectedContactCount;
-	contacts_.reserve(expectedContactCount_);
+	SPDLOG_WARN("Device {} failed {} reports in a row, ignoring it for {}.",
+		name(), consecutiveErrors_, absl::FormatDuration(quarantineBackoff_));
+	++frameBuilder_.stats().quarantines;
+	quarantinedUntil_ = now + quarantineBackoff_;
+	quarantineBackoff_ = std::min(quarantineBackoff_*2, kMaxQuarantine);
+	consecutiveErrors_ = 0;
+}
+
+TouchDevice::FrameBuilder::Frames TouchDevice::AddReport(const FrameBuilder::Report& report, absl::Time now)
+{
+	FrameBuilder::Frames frames = frameBuilder_.AddReport(report, now);
+	fieldCache_.CheckLostFrames(frameBuilder_.stats());
+	return frames;
+}
+
+std::optional<TouchDevice::FrameBuilder::Frame> TouchDevice::ExpireFrame(absl::Time now)
+{
+	std::optional<FrameBuilder::Frame> frame = frameBuilder_.Expire(now);
+	fieldCache_.CheckLostFrames(frameBuilder_.stats());
+	return frame;
+}
+
+NTSTATUS TouchDevice::GetContactsInReport(const HidData& hidData, std::vector<Contact>* contacts)
+{
+	const NTSTATUS status = DecodeContacts(HidContactFields(*this, hidData, contactInfo_), fieldCache_, contacts);
+	if(status != HIDP_STATUS_SUCCESS)
+	{
+		return status;
+	}
+	if(spdlog::should_log(spdlog::level::debug))
+	{
+		SPDLOG_DEBUG("Report:");
+		for(const auto& contact : *contacts)
+		{
+			SPDLOG_DEBUG("  id={}, link={}, isTouch={}, confidence={}, x={}, y={}",
+				contact.id, contact.contactInfoLink, contact.isTouch, contact.confidence, contact.logicalX, contact.logicalY);
+		}
+	}
+	return HIDP_STATUS_SUCCESS;
 }
 
 bool TouchDevice::FrameBuilder::InProgress() const
@@ -481,70 +728,280 @@ bool TouchDevice::FrameBuilder::InProgress() const
 	return expectedContactCount_ != 0;
 }
 
-std::optional<std::vector<TouchDevice::Contact>>
-TouchDevice::FrameBuilder::AddReport(const std::vector<Contact>& newContacts)
+TouchDevice::FrameBuilder::Mode TouchDevice::FrameBuilder::mode() const
+{
+	return expectedReportCount_ > 1 ? Mode::kHybrid : Mode::kParallel;
+}
+
+TouchDevice::FrameBuilder::Frames
+TouchDevice::FrameBuilder::AddReport(const Report& report, absl::Time now)
 {
-	contacts_.insert(contacts_.end(), newContacts.begin(), newContacts.end());
-	if(contacts_.size() >= expectedContactCount_)
+	PROFILE_SCOPE(kAddReport);
+	++stats_->reports;
+	Frames frames;
+	if(InProgress())
 	{
-		return FinishFrame();
+		if(report.contactCount != 0)
+		{
+			// A new frame started before the current one was complete, so the
+			// rest of the current frame was lost.
+			frames.flushed = EndPartialFrame("superseded by a new frame");
+		}
+		else if(now > deadline_)
+		{
+			frames.flushed = EndPartialFrame("timed out");
+		}
+		else if(report.scanTime && scanTime_ && *report.scanTime != *scanTime_)
+		{
+			frames.flushed = EndPartialFrame("continuation report has a different scan time");
+		}
 	}
-	return std::nullopt;
+
+	if(!InProgress())
+	{
+		if(report.contactCount == 0)
+		{
+			// A continuation report whose first report was lost or dropped.
+			++stats_->strayReports;
+			SPDLOG_DEBUG("Ignoring stray continuation report.");
+			return frames;
+		}
+		Start(report, now);
+	}
+
+	AddContacts(report.contacts);
+	++reportCount_;
+	if(reportCount_ >= expectedReportCount_ || contacts_.size() >= expectedContactCount_)
+	{
+		frames.finished = FinishFrame();
+	}
+	return frames;
+}
+
+std::optional<TouchDevice::FrameBuilder::Frame> TouchDevice::FrameBuilder::Expire(absl::Time now)
+{
+	if(!InProgress() || now <= deadline_)
+	{
+		return std::nullopt;
+	}
+	return EndPartialFrame("timed out");
 }
 
-// Returns the contacts from the current frame and clears the state in
-// preparation for the next frame.
-std::vector<TouchDevice::Contact> TouchDevice::FrameBuilder::FinishFrame()
+void TouchDevice::FrameBuilder::Start(const Report& report, absl::Time now)
 {
+	expectedContactCount_ = report.contactCount;
+	// In parallel mode the whole frame fits in a single report. Otherwise the
+	// device is in hybrid mode and sends as many reports as it takes.
+	expectedReportCount_ = contactsPerReport_ == 0
+		? 1
+		: (expectedContactCount_ + contactsPerReport_ - 1)/contactsPerReport_;
+	reportCount_ = 0;
+	scanTime_ = report.scanTime;
+	merged_ = false;
+	deadline_ = now + timeout_;
+	frameTime_ = FrameTime(report, now);
+	contacts_.reserve(expectedContactCount_);
+	SPDLOG_DEBUG("Expecting {} contacts in {} reports.", expectedContactCount_, expectedReportCount_);
+}
+
+absl::Time TouchDevice::FrameBuilder::FrameTime(const Report& report, absl::Time now)
+{
+	if(!report.scanTime)
+	{
+		return now;
+	}
+	absl::Time time = now;
+	if(lastScanTime_)
+	{
+		// Scan time is in 100us units and wraps at 16 bits.
+		const ULONG ticks = (*report.scanTime - *lastScanTime_) & 0xFFFF;
+		const absl::Time reckoned = lastFrameTime_ + absl::Microseconds(100)*static_cast<int64_t>(ticks);
+		if(absl::AbsDuration(reckoned - now) <= kMaxScanTimeLag)
+		{
+			time = reckoned;
+		}
+	}
+	lastScanTime_ = report.scanTime;
+	lastFrameTime_ = time;
+	return time;
+}
+
+void TouchDevice::FrameBuilder::AddContacts(const std::vector<Contact>& newContacts)
+{
+	for(const auto& contact : newContacts)
+	{
+		auto it = std::find_if(contacts_.begin(), contacts_.end(), [&contact](const auto& oldContact) {
+			return oldContact.id == contact.id && oldContact.isTouch && contact.isTouch;
+		});
+		if(it != contacts_.end())
+		{
+			// Keep the newest position. The frame contains reports from more
+			// than one scan.
+			*it = contact;
+			merged_ = true;
+		}
+		else
+		{
+			contacts_.push_back(contact);
+		}
+	}
+}
+
+TouchDevice::FrameBuilder::Frame TouchDevice::FrameBuilder::FinishFrame()
+{
+	PROFILE_SCOPE(kFinishFrame);
 	// For each non-touch contact, check for a matching last contact. If none
 	// exists, remove this contact as it is bogus (it is not a touch or a lift).
 	contacts_.erase(
 		std::remove_if(contacts_.begin(), contacts_.end(), [this](const auto& contact) {
-			return !contact.isTouch &&
-				std::none_of(lastContacts_.begin(), lastContacts_.end(), [&contact](const auto& oldContact) {
-					return oldContact.id == contact.id &&
-					       oldContact.logicalX == contact.logicalX &&
-					       oldContact.logicalY == contact.logicalY;
-				});
+			if(contact.isTouch)
+			{
+				return false;
+			}
+			const auto oldContact = lastContacts_.find(contact.id);
+			return oldContact == lastContacts_.end() ||
+			       oldContact->second.logicalX != contact.logicalX ||
+			       oldContact->second.logicalY != contact.logicalY;
 		}),
 		contacts_.end());
+	++stats_->frames;
+	if(merged_)
+	{
+		++stats_->mergedFrames;
+	}
 	if(contacts_.size() != expectedContactCount_)
 	{
-		const std::string msg =
-			absl::Substitute("Wrong number of contacts in frame. Expected $0, got $1.",
-			                 expectedContactCount_, contacts_.size());
+		++stats_->partialFrames;
 		if(panicOnUnexpectedInput_)
 		{
-			throw ChiralScrollException(msg);
-		}
-		else
-		{
-			SPDLOG_WARN(msg);
+			throw ChiralScrollException(
+				absl::Substitute("Wrong number of contacts in frame. Expected $0, got $1.",
+				                 expectedContactCount_, contacts_.size()));
 		}
+		SPDLOG_WARN_EVERY(kDefaultLogInterval, "Wrong number of contacts in frame. Expected {}, got {}.",
+			expectedContactCount_, contacts_.size());
 	}
+	lastContacts_.clear();
+	for(const auto& contact : contacts_)
+	{
+		lastContacts_[contact.id] = contact;
+	}
+	Frame frame{frameTime_, std::move(contacts_)};
+	Reset();
+	return frame;
+}
+
+void TouchDevice::FrameBuilder::DropFrame(std::string_view reason)
+{
+	++stats_->droppedFrames;
+	if(panicOnUnexpectedInput_)
+	{
+		throw ChiralScrollException(
+			absl::Substitute("Dropped incomplete frame with $0 of $1 contacts: $2.",
+			                 contacts_.size(), expectedContactCount_, ToAbslView(reason)));
+	}
+	SPDLOG_WARN_EVERY(kDefaultLogInterval, "Dropped incomplete frame with {} of {} contacts: {}.",
+		contacts_.size(), expectedContactCount_, reason);
+	contacts_.clear();
+	Reset();
+}
+
+std::optional<TouchDevice::FrameBuilder::Frame> TouchDevice::FrameBuilder::EndPartialFrame(std::string_view reason)
+{
+	if(partialFramePolicy_ == PartialFramePolicy::kDiscard)
+	{
+		DropFrame(reason);
+		return std::nullopt;
+	}
+	SPDLOG_DEBUG("Flushing incomplete frame with {} of {} contacts: {}.", contacts_.size(), expectedContactCount_, reason);
+	return FinishFrame();
+}
+
+void TouchDevice::FrameBuilder::ShareStats(Stats& stats)
+{
+	stats = *stats_;
+	stats_ = &stats;
+}
+
+void TouchDevice::FrameBuilder::Reset()
+{
 	expectedContactCount_ = 0;
-	lastContacts_ = std::move(contacts_);
-	return lastContacts_;
+	expectedReportCount_ = 0;
+	reportCount_ = 0;
+	scanTime_.reset();
+	merged_ = false;
+	deadline_ = absl::InfiniteFuture();
+	contacts_.clear();
 }
 
 
-std::optional<HidData> HidData::FromRawInput(const HRAWINPUT handle)
+std::optional<RAWINPUTHEADER> GetRawInputHeader(const HRAWINPUT handle)
 {
-	UINT size = 0;
-	if(GetRawInputData(handle, RID_INPUT, nullptr, &size, sizeof(RAWINPUTHEADER)) < 0) {
-		throw ChiralScrollException("Error in GetRawInputData");
+	RAWINPUTHEADER header;
+	UINT size = sizeof(header);
+	if(GetRawInputData(handle, RID_HEADER, &header, &size, sizeof(RAWINPUTHEADER)) != sizeof(header))
+	{
+		return std::nullopt;
 	}
+	return header;
+}
 
-	std::vector<uint8_t> raw_input_bytes(size);
-	if(GetRawInputData(handle, RID_INPUT, raw_input_bytes.data(), &size, sizeof(RAWINPUTHEADER)) < 0) {
-		throw ChiralScrollException("Error in GetRawInputData");
+std::optional<RAWKEYBOARD> GetRawKeyboard(const HRAWINPUT handle)
+{
+	// Keyboard input has a fixed size, so it fits in a RAWINPUT.
+	RAWINPUT rawInput;
+	UINT size = sizeof(rawInput);
+	if(GetRawInputData(handle, RID_INPUT, &rawInput, &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1) ||
+	   rawInput.header.dwType != RIM_TYPEKEYBOARD)
+	{
+		return std::nullopt;
 	}
+	return rawInput.data.keyboard;
+}
 
-	const auto& rawInput = *reinterpret_cast<RAWINPUT*>(raw_input_bytes.data());
+bool KeyPressFilter::IsNewPress(const RAWKEYBOARD& keyboard)
+{
+	if(keyboard.Flags & RI_KEY_BREAK)
+	{
+		if(keyboard.VKey == heldKey_)
+		{
+			heldKey_ = 0;
+		}
+		return false;
+	}
+	// Auto-repeat only repeats the last key pressed.
+	if(keyboard.VKey == heldKey_)
+	{
+		return false;
+	}
+	heldKey_ = keyboard.VKey;
+	return true;
+}
+
+std::optional<HidData> HidData::FromRawInput(const HRAWINPUT handle, const RAWINPUTHEADER& header, std::vector<uint8_t>& buffer)
+{
+	PROFILE_SCOPE(kFromRawInput);
+	if(header.dwType != RIM_TYPEHID)
+	{
+		return std::nullopt;
+	}
+
+	// The header already has the size, so one call reads the whole event.
+	if(buffer.size() < header.dwSize)
+	{
+		buffer.resize(header.dwSize);
+	}
+	UINT size = static_cast<UINT>(buffer.size());
+	if(GetRawInputData(handle, RID_INPUT, buffer.data(), &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1))
+	{
+		return std::nullopt;
+	}
+
+	const auto& rawInput = *reinterpret_cast<const RAWINPUT*>(buffer.data());
 	if(rawInput.header.dwType != RIM_TYPEHID)
 	{
 		return std::nullopt;
-	}	
+	}
 	return HidData(rawInput);
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -14,8 +15,11 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/time/time.h>
 
 #include "ChiralScrollException.h"
+#include "PipelineStats.h"
+#include "Touchpad.h"
 
 namespace chiralscroll
 {
@@ -70,126 +74,460 @@ public:
 	std::optional<LONG> GetPhysicalValueOrNullopt(const HidData& hidData, Usage usage, std::optional<USHORT> link = std::nullopt) const;
 	bool GetButton(const HidData& hidData, Usage usage, std::optional<USHORT> link = std::nullopt) const;
 
+	// Versions of the above that return the status instead of throwing, for
+	// the per-report path.
+	NTSTATUS GetLogicalValue(const HidData& hidData, Usage usage, USHORT link, ULONG* value) const;
+	NTSTATUS GetPhysicalValue(const HidData& hidData, Usage usage, USHORT link, LONG* value) const;
+	NTSTATUS GetButton(const HidData& hidData, Usage usage, USHORT link, bool* value) const;
+
+	// Size in bytes of the device's input reports.
+	USHORT inputReportLength() const
+	{
+		return caps_.InputReportByteLength;
+	}
+
 private:
 	explicit HidDevice(RawInputDevice rawDevice);
 
-	NTSTATUS GetLogicalValue(const HidData& hidData, Usage usage, USHORT link, ULONG* value) const;
-	NTSTATUS GetPhysicalValue(const HidData& hidData, Usage usage, USHORT link, LONG* value) const;
-	NTSTATUS GetUsages(const HidData& hidData, Usage usage, USHORT link, std::vector<USAGE>* usages) const;
+	// Reads the pressed buttons on the usage's page into usages_, and sets
+	// count to how many there are.
+	NTSTATUS GetUsages(const HidData& hidData, Usage usage, USHORT link, ULONG* count) const;
 
 	HIDP_CAPS caps_;
 	std::vector<HIDP_VALUE_CAPS> valueCaps_;
 	std::vector<HIDP_BUTTON_CAPS> buttonCaps_;
+	// Room for the pressed buttons on any page, allocated once so that reading
+	// a button does not allocate. Reports are only decoded on the input
+	// thread.
+	mutable std::vector<USAGE> usages_;
 };
 
-class TouchDevice : public HidDevice
+// Picks which fields of each contact the decoder reads from a report, and
+// fills in the rest from the last report that had them.
+//
+// The gesture code looks at the ID, tip switch and position of the contacts,
+// and the frame builder compares the position of every lift with the frame
+// before it to tell a genuine lift from a bogus one, so those are decoded
+// from every report. Confidence and physical positions are only kept for
+// traces and diagnostics. They are decoded when a contact first appears and
+// held after that, unless everything is decoded because something records
+// the frames.
+class ContactFieldCache
 {
 public:
-	struct ContactInfo
-	{
-		struct Area
-		{
-			LONG top;
-			LONG bottom;
-			LONG left;
-			LONG right;
-		};
+	// The fields beyond the ID and tip switch, which are always decoded.
+	static constexpr uint32_t kConfidence = 1 << 0;
+	static constexpr uint32_t kPosition = 1 << 1;
+	static constexpr uint32_t kPhysicalPosition = 1 << 2;
+	static constexpr uint32_t kAllFields = kConfidence | kPosition | kPhysicalPosition;
 
-		USHORT link;
-		Area logicalArea;
-		Area physicalArea;
-	};
+	ContactFieldCache() : decodeAll_(false), lostFrames_(0) {}
 
-	struct Contact
+	bool decodeAll() const
 	{
-		ULONG id;
-		ULONG contactInfoLink;
-		bool isTouch;
-		bool confidence;
-		ULONG logicalX;
-		ULONG logicalY;
-		LONG physicalX;
-		LONG physicalY;
-	};
-
-	static std::optional<TouchDevice> FromHandle(const HANDLE hDevice, bool panicOnUnexpectedInput);
-
-	TouchDevice(TouchDevice&&) = default;
-	TouchDevice& operator=(TouchDevice&&) = default;
-	TouchDevice(const TouchDevice&) = delete;
-	TouchDevice& operator=(const TouchDevice&) = delete;
+		return decodeAll_;
+	}
 
-	const std::vector<ContactInfo>& contactInfo() const
+	void SetDecodeAll(bool decodeAll)
 	{
-		return contactInfo_;
+		decodeAll_ = decodeAll;
 	}
 
-	const ContactInfo& GetContactInfo(ULONG link) const;
+	// The fields to decode for the contact with the given ID.
+	uint32_t FieldsFor(ULONG id) const;
+
+	// Remembers the decoded fields of the contact and fills in the others.
+	void Complete(uint32_t decoded, Touchpad::Contact* contact);
 
-	// Returns nullopt if the frame is not complete. Otherwise returns a list of
-	// all contacts in the given frame. Throws an exception if anything goes
-	// wrong.
-	std::optional<std::vector<Contact>> GetContacts(const HidData& hidData);
+	// Forgets every contact if the frame builder with the given stats cut a
+	// frame short, threw one away or ignored a report since the last call.
+	// The lift of a contact may have gone with it, and its ID would then
+	// come back with the fields of the old contact.
+	void CheckLostFrames(const FrameStats& stats);
 
 private:
-	struct FrameBuilder
+	bool decodeAll_;
+	// The last known fields of each contact that is down.
+	absl::flat_hash_map<ULONG, Touchpad::Contact> contacts_;
+	// Partial and dropped frames and stray reports at the last check.
+	uint64_t lostFrames_;
+};
+
+// Decodes the contacts of one report, reading only the fields the cache asks
+// for and filling in the rest from it. The report has fields.slotCount()
+// contact slots, and fields reads the fields of a slot:
+//
+//   ULONG Link(size_t slot);
+//   NTSTATUS Id(size_t slot, ULONG* id);
+//   NTSTATUS TipSwitch(size_t slot, bool* isTouch);
+//   NTSTATUS Confidence(size_t slot, bool* confidence);
+//   NTSTATUS Position(size_t slot, ULONG* x, ULONG* y);
+//   NTSTATUS PhysicalPosition(size_t slot, LONG* x, LONG* y);
+//
+// A slot without an ID is skipped. Returns the first other status that is
+// not a success.
+template<typename Fields>
+NTSTATUS DecodeContacts(const Fields& fields, ContactFieldCache& cache, std::vector<Touchpad::Contact>* contacts)
+{
+	contacts->reserve(fields.slotCount());
+	for(size_t slot = 0; slot < fields.slotCount(); ++slot)
+	{
+		ULONG contactId;
+		NTSTATUS status = fields.Id(slot, &contactId);
+		if(status == HIDP_STATUS_USAGE_NOT_FOUND)
+		{
+			continue;
+		}
+		if(status != HIDP_STATUS_SUCCESS)
+		{
+			return status;
+		}
+
+		Touchpad::Contact contact{contactId, fields.Link(slot)};
+		status = fields.TipSwitch(slot, &contact.isTouch);
+		if(status != HIDP_STATUS_SUCCESS)
+		{
+			return status;
+		}
+
+		const uint32_t decoded = cache.FieldsFor(contactId);
+		if(decoded & ContactFieldCache::kConfidence)
+		{
+			status = fields.Confidence(slot, &contact.confidence);
+			if(status != HIDP_STATUS_SUCCESS)
+			{
+				return status;
+			}
+		}
+		if(decoded & ContactFieldCache::kPosition)
+		{
+			status = fields.Position(slot, &contact.logicalX, &contact.logicalY);
+			if(status != HIDP_STATUS_SUCCESS)
+			{
+				return status;
+			}
+		}
+		if(decoded & ContactFieldCache::kPhysicalPosition)
+		{
+			status = fields.PhysicalPosition(slot, &contact.physicalX, &contact.physicalY);
+			if(status != HIDP_STATUS_SUCCESS)
+			{
+				return status;
+			}
+		}
+		cache.Complete(decoded, &contact);
+		contacts->push_back(contact);
+	}
+	return HIDP_STATUS_SUCCESS;
+}
+
+class TouchDevice : public HidDevice, public Touchpad
+{
+public:
+	// Assembles the contacts from one or more HID reports into a frame.
+	//
+	// Precision touchpads send a frame either in parallel mode, where a single
+	// report holds every contact, or in hybrid mode, where the contacts are
+	// split over several reports. The first report of a frame carries the
+	// total contact count, later reports of the same frame carry a count of
+	// zero. All reports of a frame share the same scan time.
+	class FrameBuilder
 	{
 	public:
-		FrameBuilder(bool panicOnUnexpectedInput) : 
-			expectedContactCount_(0),
-			panicOnUnexpectedInput_(panicOnUnexpectedInput) {}
+		enum class Mode { kParallel, kHybrid };
+
+		// What to do with a frame that is still incomplete when its deadline
+		// passes.
+		enum class PartialFramePolicy { kFlush, kDiscard };
 
-		void Start(ULONG expectedContactCount);
+		struct Report
+		{
+			// Number of contacts in the frame, or 0 for a continuation report.
+			ULONG contactCount;
+			// Scan time in 100us units, if the device reports it.
+			std::optional<ULONG> scanTime;
+			std::vector<Contact> contacts;
+		};
+
+		struct Frame
+		{
+			// When the frame was scanned. Follows the device's scan time if it
+			// reports one, so that frames handled back to back keep the spacing
+			// they were scanned at, otherwise when its first report arrived.
+			absl::Time time;
+			std::vector<Contact> contacts;
+		};
+
+		// The frames that a report ends. A report that cuts off an
+		// incomplete frame flushes it ahead of its own frame, unless partial
+		// frames are discarded.
+		struct Frames
+		{
+			std::optional<Frame> flushed;
+			std::optional<Frame> finished;
+		};
+
+		using Stats = FrameStats;
+
+		static constexpr absl::Duration kDefaultTimeout = absl::Milliseconds(25);
+
+		FrameBuilder(
+			size_t contactsPerReport,
+			bool panicOnUnexpectedInput,
+			absl::Duration timeout = kDefaultTimeout,
+			PartialFramePolicy partialFramePolicy = PartialFramePolicy::kFlush) :
+				contactsPerReport_(contactsPerReport),
+				panicOnUnexpectedInput_(panicOnUnexpectedInput),
+				timeout_(timeout),
+				partialFramePolicy_(partialFramePolicy),
+				expectedContactCount_(0),
+				expectedReportCount_(0),
+				reportCount_(0),
+				merged_(false),
+				deadline_(absl::InfiniteFuture()),
+				frameTime_(absl::InfinitePast()),
+				lastFrameTime_(absl::InfinitePast()),
+				ownStats_(std::make_unique<Stats>()),
+				stats_(ownStats_.get()) {}
 
 		bool InProgress() const;
 
-		// Adds the given contacts to this frame. If the frame is finished,
-		// returns all contacts.
-		std::optional<std::vector<Contact>> AddReport(const std::vector<Contact>& newContacts);
+		// Mode of the frame in progress.
+		Mode mode() const;
+
+		// Time at which the frame in progress expires, or InfiniteFuture if
+		// there is none.
+		absl::Time deadline() const
+		{
+			return deadline_;
+		}
 
-		// Returns the contacts from the current frame and clears the state in
-		// preparation for the next frame.
-		std::vector<Contact> FinishFrame();
+		const Stats& stats() const
+		{
+			return *stats_;
+		}
+
+		Stats& stats()
+		{
+			return *stats_;
+		}
+
+		// Counts into the given stats from now on, carrying over the counts so
+		// far. Used to place them in shared memory. The stats must outlive the
+		// builder.
+		void ShareStats(Stats& stats);
+
+		// Adds the given report to the frame it belongs to. Returns all
+		// contacts of the frame if it is finished, and the partial frame the
+		// report cut off if the policy is to flush it.
+		Frames AddReport(const Report& report, absl::Time now);
+
+		// Ends the frame in progress if its deadline has passed. Returns the
+		// partial frame if the policy is to flush it.
+		std::optional<Frame> Expire(absl::Time now);
 
 	private:
+		// How far the time of a frame reckoned from scan times may be from
+		// when its report arrived. The scan time wraps every 6.5 seconds and
+		// the device's clock drifts from ours, so further than this the frame
+		// is timed by its arrival instead, and later frames follow on from
+		// it.
+		static constexpr absl::Duration kMaxScanTimeLag = absl::Milliseconds(100);
+
+		void Start(const Report& report, absl::Time now);
+
+		// The time of a frame starting with the given report, see Frame.
+		absl::Time FrameTime(const Report& report, absl::Time now);
+
+		// Adds contacts to the current frame, replacing older contacts with
+		// the same ID.
+		void AddContacts(const std::vector<Contact>& newContacts);
+
+		// Returns the current frame and clears the state in preparation for
+		// the next frame.
+		Frame FinishFrame();
+
+		// Throws away the current frame.
+		void DropFrame(std::string_view reason);
+
+		// Ends the incomplete frame in progress according to the policy, and
+		// returns it if it is flushed.
+		std::optional<Frame> EndPartialFrame(std::string_view reason);
+
+		void Reset();
+
+		size_t contactsPerReport_;
+		bool panicOnUnexpectedInput_;
+		absl::Duration timeout_;
+		PartialFramePolicy partialFramePolicy_;
+
 		ULONG expectedContactCount_;
+		size_t expectedReportCount_;
+		size_t reportCount_;
+		std::optional<ULONG> scanTime_;
+		bool merged_;
+		absl::Time deadline_;
+		absl::Time frameTime_;
+		// The scan time and time of the last frame started, to reckon the
+		// time of the next one from.
+		std::optional<ULONG> lastScanTime_;
+		absl::Time lastFrameTime_;
 		std::vector<Contact> contacts_;
-		std::vector<Contact> lastContacts_;
-		bool panicOnUnexpectedInput_;
+		// The contacts of the last finished frame by ID.
+		absl::flat_hash_map<ULONG, Contact> lastContacts_;
+		// Heap allocated so that stats_ survives a move.
+		std::unique_ptr<Stats> ownStats_;
+		Stats* stats_;
 	};
 
+	static std::optional<TouchDevice> FromHandle(const HANDLE hDevice, bool panicOnUnexpectedInput);
+
+	TouchDevice(TouchDevice&&) = default;
+	TouchDevice& operator=(TouchDevice&&) = default;
+	TouchDevice(const TouchDevice&) = delete;
+	TouchDevice& operator=(const TouchDevice&) = delete;
+
+	std::string_view name() const override
+	{
+		return HidDevice::name();
+	}
+
+	const std::vector<ContactInfo>& contactInfo() const override
+	{
+		return contactInfo_;
+	}
+
+	// Returns the frames the report ended, see FrameBuilder::AddReport.
+	// Throws an exception if anything goes wrong.
+	FrameBuilder::Frames GetContacts(const HidData& hidData, absl::Time now);
+
+	// The two halves of GetContacts, for callers that need to see the decoded
+	// report. DecodeReport returns nullopt if the report does not belong to a
+	// frame, could not be decoded, or the device is quarantined. It only
+	// throws if panicOnUnexpectedInput is set.
+	//
+	// A device whose reports keep failing to decode is quarantined: its
+	// reports are ignored for a while, and for twice as long each time it
+	// happens again.
+	std::optional<FrameBuilder::Report> DecodeReport(const HidData& hidData, absl::Time now);
+	FrameBuilder::Frames AddReport(const FrameBuilder::Report& report, absl::Time now);
+
+	// Counts an input event from the device that could not be read, with the
+	// error from GetLastError, towards the same quarantine as reports that
+	// could not be decoded. Only throws if panicOnUnexpectedInput is set.
+	void CountReadError(DWORD error, absl::Time now);
+
+	// Returns the partial frame in progress if it has passed its deadline
+	// without being completed, otherwise nullopt.
+	std::optional<FrameBuilder::Frame> ExpireFrame(absl::Time now);
+
+	// Time at which the frame in progress expires, or InfiniteFuture if there
+	// is none.
+	absl::Time frameDeadline() const
+	{
+		return frameBuilder_.deadline();
+	}
+
+	const FrameBuilder::Stats& frameStats() const
+	{
+		return frameBuilder_.stats();
+	}
+
+	// Whether to decode every field of every contact, rather than only those
+	// the gesture code reads. See ContactFieldCache.
+	void SetDecodeAllFields(bool decodeAll)
+	{
+		fieldCache_.SetDecodeAll(decodeAll);
+	}
+
+	void ShareFrameStats(FrameBuilder::Stats& stats)
+	{
+		frameBuilder_.ShareStats(stats);
+	}
+
+private:
 	explicit TouchDevice(
 		HidDevice hidDevice,
 		std::vector<ContactInfo> contactInfo, 
 		USHORT linkContactCount, 
+		std::optional<USHORT> linkScanTime,
 		bool panicOnUnexpectedInput) :
 			HidDevice(std::move(hidDevice)),
 			contactInfo_(std::move(contactInfo)),
 			linkContactCount_(linkContactCount),
-			frameBuilder_(panicOnUnexpectedInput){}
+			linkScanTime_(linkScanTime),
+			panicOnUnexpectedInput_(panicOnUnexpectedInput),
+			frameBuilder_(contactInfo_.size(), panicOnUnexpectedInput),
+			consecutiveErrors_(0),
+			quarantineBackoff_(kMinQuarantine),
+			quarantinedUntil_(absl::InfinitePast()) {}
+
+	// Consecutive decode failures that put a device in quarantine.
+	static constexpr int kQuarantineThreshold = 16;
+	static constexpr absl::Duration kMinQuarantine = absl::Seconds(1);
+	static constexpr absl::Duration kMaxQuarantine = absl::Minutes(5);
 
+	// Decodes the report without throwing or logging. Sets report to nullopt
+	// if the report does not belong to a frame.
+	NTSTATUS TryDecodeReport(const HidData& hidData, std::optional<FrameBuilder::Report>* report);
+	NTSTATUS GetContactsInReport(const HidData& hidData, std::vector<Contact>* contacts);
 
-	std::vector<Contact> GetContactsInReport(const HidData& hidData);
+	void Quarantine(absl::Time now);
 
 	std::vector<ContactInfo> contactInfo_;
 	USHORT linkContactCount_;
+	std::optional<USHORT> linkScanTime_;
+	bool panicOnUnexpectedInput_;
 	FrameBuilder frameBuilder_;
+	ContactFieldCache fieldCache_;
+	int consecutiveErrors_;
+	absl::Duration quarantineBackoff_;
+	absl::Time quarantinedUntil_;
+};
+
+// Reads just the header of a raw input event, which is enough to tell
+// keyboard input from HID input and which device it came from. Returns
+// nullopt if the event could not be read.
+std::optional<RAWINPUTHEADER> GetRawInputHeader(const HRAWINPUT handle);
+
+// Reads a keyboard event into a buffer on the stack. Returns nullopt if the
+// event is not keyboard input.
+std::optional<RAWKEYBOARD> GetRawKeyboard(const HRAWINPUT handle);
+
+// Picks out the key presses from keyboard input, ignoring key releases and
+// the repeats sent while a key is held down.
+class KeyPressFilter
+{
+public:
+	KeyPressFilter() : heldKey_(0) {}
+
+	bool IsNewPress(const RAWKEYBOARD& keyboard);
+
+private:
+	// The key that auto-repeat would repeat, or 0.
+	USHORT heldKey_;
 };
 
+// An HID input event, read into a buffer owned by the caller. Only valid
+// until the buffer is changed.
 struct HidData
 {
-	// Returns nullopt if the handle is not an HID. Otherwise returns the HidData.
-	static std::optional<HidData> FromRawInput(const HRAWINPUT handle);
+	// Reads the event with the given header into the buffer. The buffer only
+	// grows, so once it fits the largest event, reading one does not
+	// allocate. Returns nullopt without throwing if the event is not HID input
+	// or could not be read, in which case GetLastError tells why.
+	static std::optional<HidData> FromRawInput(const HRAWINPUT handle, const RAWINPUTHEADER& header, std::vector<uint8_t>& buffer);
 
 	const RAWINPUTHEADER header;
 	const RAWHID hid;
-	const std::vector<uint8_t> rawData;
+	// The hid.dwCount reports of hid.dwSizeHid bytes each, in the buffer.
+	const uint8_t* const rawData;
 
 private:
 	HidData(const RAWINPUT& raw_input) :
 		header(raw_input.header),
 		hid(raw_input.data.hid),
-		rawData(raw_input.data.hid.bRawData, raw_input.data.hid.bRawData + static_cast<ptrdiff_t>(hid.dwSizeHid) * hid.dwCount) {}
+		rawData(raw_input.data.hid.bRawData) {}
 };
 
 absl::flat_hash_map<HANDLE, TouchDevice> GetTouchDevices(bool panicOnUnexpectedInput);
@@ -0,0 +1,174 @@
+#include "InjectionWatchdog.h"
+
+#include <exception>
+#include <utility>
+
+#include <absl/strings/str_cat.h>
+#include <spdlog/spdlog.h>
+
+#include "FlightRecorder.h"
+#include "Logging.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
+
+namespace chiralscroll
+{
+
+class InjectionWatchdog::WatchedScroller : public Scroller
+{
+public:
+	WatchedScroller(InjectionWatchdog& watchdog, Sink& sink) : watchdog_(watchdog), sink_(sink) {}
+
+	// Starting and stopping install and remove hooks, which belong on the
+	// calling thread, so they go straight to the sinks.
+	void StartScrolling() override
+	{
+		sink_.primary->StartScrolling();
+		if(sink_.fallback)
+		{
+			sink_.fallback->StartScrolling();
+		}
+	}
+
+	void Scroll(int amt) override
+	{
+		watchdog_.Scroll(sink_, amt);
+	}
+
+	void StopScrolling() override
+	{
+		sink_.primary->StopScrolling();
+		if(sink_.fallback)
+		{
+			sink_.fallback->StopScrolling();
+		}
+	}
+
+private:
+	InjectionWatchdog& watchdog_;
+	Sink& sink_;
+};
+
+InjectionWatchdog::InjectionWatchdog(const Clock& clock, absl::Duration stallThreshold)
+	: clock_(clock),
+	  stallThreshold_(stallThreshold),
+	  stopping_(false)
+{
+	worker_ = std::thread(&InjectionWatchdog::Inject, this);
+}
+
+InjectionWatchdog::~InjectionWatchdog()
+{
+	{
+		std::lock_guard lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_one();
+	worker_.join();
+}
+
+std::unique_ptr<Scroller> InjectionWatchdog::Watch(std::unique_ptr<Scroller> primary, std::unique_ptr<Scroller> fallback)
+{
+	std::lock_guard lock(mutex_);
+	const uint8_t index = static_cast<uint8_t>(sinks_.size());
+	sinks_.push_back(std::make_unique<Sink>(Sink{index, std::move(primary), std::move(fallback)}));
+	return std::make_unique<WatchedScroller>(*this, *sinks_.back());
+}
+
+bool InjectionWatchdog::stalled()
+{
+	std::lock_guard lock(mutex_);
+	return StalledLocked();
+}
+
+void InjectionWatchdog::Scroll(Sink& sink, int amt)
+{
+	FlightRecorder& recorder = GetFlightRecorder();
+	{
+		std::lock_guard lock(mutex_);
+		if(!StalledLocked())
+		{
+			sink.pending += amt;
+			wake_.notify_one();
+			recorder.Record(FlightRecorder::EventType::kScroll, sink.index, 0, amt);
+			return;
+		}
+	}
+	PipelineStats& stats = GetPipelineStats();
+	if(sink.fallback)
+	{
+		++stats.fallbackScrolls;
+		recorder.Record(FlightRecorder::EventType::kFallbackScroll, sink.index, 0, amt);
+		sink.fallback->Scroll(amt);
+	}
+	else
+	{
+		++stats.droppedScrolls;
+		recorder.Record(FlightRecorder::EventType::kDroppedScroll, sink.index, 0, amt);
+	}
+}
+
+bool InjectionWatchdog::StalledLocked() const
+{
+	return injectingSince_ && clock_.Now() - *injectingSince_ > stallThreshold_;
+}
+
+InjectionWatchdog::Sink* InjectionWatchdog::FindPendingLocked() const
+{
+	for(const auto& sink : sinks_)
+	{
+		if(sink->pending != 0)
+		{
+			return sink.get();
+		}
+	}
+	return nullptr;
+}
+
+void InjectionWatchdog::Inject()
+{
+	PipelineStats& stats = GetPipelineStats();
+	std::unique_lock lock(mutex_);
+	while(true)
+	{
+		Sink* sink = nullptr;
+		wake_.wait(lock, [this, &sink]()
+		{
+			sink = FindPendingLocked();
+			return stopping_ || sink;
+		});
+		if(stopping_)
+		{
+			return;
+		}
+		const int amt = std::exchange(sink->pending, 0);
+		const absl::Time start = clock_.Now();
+		injectingSince_ = start;
+		lock.unlock();
+
+		try
+		{
+			sink->primary->Scroll(amt);
+		}
+		catch(const std::exception& e)
+		{
+			SPDLOG_WARN_EVERY(kDefaultLogInterval, "Scroll injection failed: {}", e.what());
+		}
+		// Timed by the clock rather than the TSC, so that a virtual clock can
+		// stage stalls.
+		const absl::Duration duration = clock_.Now() - start;
+		if(duration > stallThreshold_)
+		{
+			const int64_t ms = absl::ToInt64Milliseconds(duration);
+			stats.injectionStalls.Record(NanosecondsToCycles(absl::ToDoubleNanoseconds(duration)));
+			SPDLOG_WARN_EVERY(kDefaultLogInterval, "Scroll injection stalled for {}ms.", ms);
+			GetFlightRecorder().Record(FlightRecorder::EventType::kInjectionStall, sink->index, 0, static_cast<int32_t>(ms));
+			GetFlightRecorder().DumpOnAnomaly(absl::StrCat("scroll injection stalled for ", ms, "ms"));
+		}
+
+		lock.lock();
+		injectingSince_.reset();
+	}
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <absl/time/time.h>
+
+#include "Clock.h"
+#include "Scroller.h"
+
+namespace chiralscroll
+{
+
+// Keeps a slow scroll sink from holding up the input.
+//
+// The scrollers returned by Watch only queue the amount, and a single worker
+// thread passes it to the primary sink. Amounts that arrive while a call is in
+// progress are added together and sent in one call when it returns. If a call
+// has been in progress for longer than the stall threshold, every watched
+// scroller sends to its fallback sink instead, which must never block, or
+// drops the amount if there is none. Once the stalled call returns, scrolling
+// goes back to the primary sinks.
+//
+// Calls that stall are recorded in PipelineStats::injectionStalls and dump
+// the flight recorder. Stalls are measured with the given clock, so a fake
+// sink and clock can drive the policy, see LoadGen --checkInjection.
+class InjectionWatchdog
+{
+public:
+	static constexpr absl::Duration kDefaultStallThreshold = absl::Milliseconds(50);
+
+	// The clock must be safe to read from any thread and outlive the
+	// watchdog.
+	explicit InjectionWatchdog(const Clock& clock, absl::Duration stallThreshold = kDefaultStallThreshold);
+	// Waits for the call in progress, if any. Amounts not yet sent are lost.
+	~InjectionWatchdog();
+
+	InjectionWatchdog(const InjectionWatchdog&) = delete;
+	InjectionWatchdog& operator=(const InjectionWatchdog&) = delete;
+
+	// Returns a scroller that sends to primary through the worker, or to
+	// fallback during a stall. The fallback may be null. The sinks are owned
+	// by the watchdog, which must outlive the returned scroller. Scroll must
+	// only be called from one thread.
+	std::unique_ptr<Scroller> Watch(std::unique_ptr<Scroller> primary, std::unique_ptr<Scroller> fallback);
+
+	// Whether a call to a primary sink is currently stalled.
+	bool stalled();
+
+	// The worker thread, for setting its priority.
+	std::thread::native_handle_type worker()
+	{
+		return worker_.native_handle();
+	}
+
+private:
+	class WatchedScroller;
+
+	struct Sink
+	{
+		// Order of the Watch call, which numbers the sink in the flight
+		// recorder.
+		uint8_t index;
+		std::unique_ptr<Scroller> primary;
+		std::unique_ptr<Scroller> fallback;
+		// Amount waiting for the worker.
+		int pending = 0;
+	};
+
+	void Scroll(Sink& sink, int amt);
+	bool StalledLocked() const;
+	Sink* FindPendingLocked() const;
+	void Inject();
+
+	const Clock& clock_;
+	const absl::Duration stallThreshold_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::vector<std::unique_ptr<Sink>> sinks_;
+	// Start of the call in progress.
+	std::optional<absl::Time> injectingSince_;
+	bool stopping_;
+	std::thread worker_;
+};
+
+}  // namespace chiralscroll
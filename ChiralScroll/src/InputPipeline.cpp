@@ -0,0 +1,300 @@
+#include "InputPipeline.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <Windows.h>
+
+// Must come after Windows.h
+#include <hidusage.h>
+
+#include <intrin.h>
+
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <spdlog/spdlog.h>
+
+#include "ChiralScrollException.h"
+#include "FlightRecorder.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "StartupTrace.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Whether WM_INPUT messages are waiting in this thread's queue.
+bool RawInputPending()
+{
+	return (HIWORD(GetQueueStatus(QS_RAWINPUT)) & QS_RAWINPUT) != 0;
+}
+
+}  // namespace
+
+
+InputPipeline::InputPipeline(
+	absl::flat_hash_map<HANDLE, TouchDevice> touchDevices,
+	ChiralScroll chiralScroll,
+	const Clock& clock,
+	FrameMailbox::Policy framePolicy,
+	const std::optional<std::filesystem::path>& tracePath)
+	: touchDevices_(std::move(touchDevices)),
+	  chiralScroll_(std::move(chiralScroll)),
+	  clock_(clock),
+	  mailbox_(framePolicy),
+	  decodeAllFields_(false),
+	  firstScrollLogged_(false)
+{
+	std::vector<std::string> deviceNames;
+	size_t maxReportLength = 0;
+	for(const auto& pair : touchDevices_)
+	{
+		deviceIndex_[pair.first] = static_cast<uint8_t>(deviceNames.size());
+		deviceNames.push_back(std::string(pair.second.name()));
+		maxReportLength = std::max<size_t>(maxReportLength, pair.second.inputReportLength());
+	}
+	GetFlightRecorder().SetDeviceNames(std::move(deviceNames));
+	rawInputBuffer_.resize(sizeof(RAWINPUTHEADER) + sizeof(RAWHID) + maxReportLength);
+
+	if(tracePath)
+	{
+		std::vector<const Touchpad*> devices;
+		for(const auto& pair : touchDevices_)
+		{
+			devices.push_back(&pair.second);
+		}
+		traceWriter_ = std::make_unique<TraceWriter>(*tracePath, devices, clock_);
+	}
+	UpdateFieldDecoding();
+}
+
+void InputPipeline::RegisterRawInput(HWND hWnd)
+{
+	RAWINPUTDEVICE rid[]{
+		{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_KEYBOARD, RIDEV_INPUTSINK, hWnd},
+		{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TOUCH_PAD, RIDEV_INPUTSINK, hWnd},
+	};
+	THROW_IF_FALSE(RegisterRawInputDevices(rid, sizeof(rid)/sizeof(RAWINPUTDEVICE), sizeof(RAWINPUTDEVICE)),
+		absl::StrCat("RegisterRawInputDevices failed: ", GetErrorMessage(GetLastError())));
+}
+
+bool InputPipeline::PublishFrames()
+{
+	std::vector<std::string> deviceNames(deviceIndex_.size());
+	for(const auto& pair : deviceIndex_)
+	{
+		deviceNames[pair.second] = std::string(touchDevices_.at(pair.first).name());
+	}
+	std::optional<FrameSegment> segment = FrameSegment::Create(deviceNames);
+	if(!segment)
+	{
+		return false;
+	}
+	frameSegment_.emplace(std::move(*segment));
+	UpdateFieldDecoding();
+	return true;
+}
+
+void InputPipeline::SetDecodeAllFields(bool decodeAll)
+{
+	decodeAllFields_ = decodeAll;
+	UpdateFieldDecoding();
+}
+
+bool InputPipeline::HandleRawInput(HRAWINPUT handle)
+{
+	// Every keystroke on the system comes through here, so the header alone
+	// decides what to do with an event.
+	const std::optional<RAWINPUTHEADER> header = GetRawInputHeader(handle);
+	if(!header)
+	{
+		return false;
+	}
+	if(header->dwType == RIM_TYPEKEYBOARD)
+	{
+		HandleKeyboard(handle);
+		return false;
+	}
+	const auto touchDevice = touchDevices_.find(header->hDevice);
+	if(touchDevice == touchDevices_.end())
+	{
+		return false;
+	}
+	const std::optional<HidData> hidData = HidData::FromRawInput(handle, *header, rawInputBuffer_);
+	if(!hidData)
+	{
+		// The header says this is a touchpad report, so it could not be read.
+		const DWORD error = GetLastError();
+		touchDevice->second.CountReadError(error, clock_.Now());
+		return false;
+	}
+	HandleTouch(*hidData);
+	return true;
+}
+
+absl::Time InputPipeline::frameDeadline() const
+{
+	absl::Time deadline = absl::InfiniteFuture();
+	for(const auto& pair : touchDevices_)
+	{
+		deadline = std::min(deadline, pair.second.frameDeadline());
+	}
+	if(!mailbox_.empty())
+	{
+		deadline = std::min(deadline, mailbox_.oldest() + kMaxFrameDelay);
+	}
+	return deadline;
+}
+
+void InputPipeline::ExpireFrames()
+{
+	const absl::Time now = clock_.Now();
+	for(auto& pair : touchDevices_)
+	{
+		std::optional<TouchDevice::FrameBuilder::Frame> frame = pair.second.ExpireFrame(now);
+		if(frame)
+		{
+			RecordFrame(pair.first, frame->contacts, true, now);
+			mailbox_.Post(pair.second, std::move(frame->contacts), frame->time, now);
+		}
+	}
+	DeliverFrames(now, true);
+}
+
+void InputPipeline::HandleKeyboard(HRAWINPUT handle)
+{
+	PROFILE_SCOPE(kKeyboard);
+	const std::optional<RAWKEYBOARD> keyboard = GetRawKeyboard(handle);
+	if(keyboard && keyPressFilter_.IsNewPress(*keyboard))
+	{
+		// Frames from before the key press must not see the lockout.
+		DeliverFrames(clock_.Now(), true);
+		GetFlightRecorder().Record(FlightRecorder::EventType::kKeyPress);
+		chiralScroll_.ProcessKeyboard();
+	}
+}
+
+void InputPipeline::RecordFrame(HANDLE device, const std::vector<TouchDevice::Contact>& contacts, bool expired, absl::Time now)
+{
+	const auto touching = std::count_if(contacts.begin(), contacts.end(), [](const auto& contact) { return contact.isTouch; });
+	GetFlightRecorder().Record(
+		expired ? FlightRecorder::EventType::kExpiredFrame : FlightRecorder::EventType::kFrame,
+		deviceIndex_.at(device),
+		static_cast<uint16_t>(contacts.size()),
+		static_cast<int32_t>(touching),
+		contacts.empty() ? 0 : static_cast<int32_t>(contacts[0].logicalX),
+		contacts.empty() ? 0 : static_cast<int32_t>(contacts[0].logicalY));
+	if(frameSegment_)
+	{
+		frameSegment_->Publish(deviceIndex_.at(device), touchDevices_.at(device), contacts, now);
+	}
+}
+
+void InputPipeline::HandleTouch(const HidData& hidData)
+{
+	PipelineStats& stats = GetPipelineStats();
+	FlightRecorder& recorder = GetFlightRecorder();
+	const HANDLE device = hidData.header.hDevice;
+	auto& touchDevice = touchDevices_.at(device);
+	const uint64_t startCycles = __rdtsc();
+	TouchDevice::FrameBuilder::Frames frames;
+	const absl::Time now = clock_.Now();
+	{
+		ScopedTimer timer(stats.decode);
+		const std::optional<TouchDevice::FrameBuilder::Report> report = touchDevice.DecodeReport(hidData, now);
+		if(!report)
+		{
+			return;
+		}
+		if(!firstReport_)
+		{
+			firstReport_ = GetStartupTrace().elapsed();
+		}
+		recorder.Record(
+			FlightRecorder::EventType::kReport,
+			deviceIndex_.at(device),
+			static_cast<uint16_t>(report->contactCount),
+			report->scanTime ? static_cast<int32_t>(*report->scanTime) : -1,
+			static_cast<int32_t>(report->contacts.size()));
+		if(traceWriter_)
+		{
+			traceWriter_->Write(touchDevice, *report, now);
+		}
+		frames = touchDevice.AddReport(*report, now);
+	}
+	if(!frames.flushed && !frames.finished)
+	{
+		return;
+	}
+	if(frames.flushed)
+	{
+		RecordFrame(device, frames.flushed->contacts, true, now);
+		mailbox_.Post(touchDevice, std::move(frames.flushed->contacts), frames.flushed->time, now);
+	}
+	if(frames.finished)
+	{
+		RecordFrame(device, frames.finished->contacts, false, now);
+		mailbox_.Post(touchDevice, std::move(frames.finished->contacts), frames.finished->time, now);
+	}
+	DeliverFrames(now, false);
+	if(!firstScrollLogged_)
+	{
+		CheckFirstScroll();
+	}
+
+	const double ns = CyclesToNanoseconds(__rdtsc() - startCycles);
+	if(ns > kLongFrameNs)
+	{
+		recorder.Record(FlightRecorder::EventType::kLongFrame, deviceIndex_.at(device), 0, static_cast<int32_t>(ns / 1000));
+		recorder.DumpOnAnomaly(absl::StrFormat("frame took %.1fms", ns / 1e6));
+	}
+}
+
+void InputPipeline::DeliverFrames(absl::Time now, bool force)
+{
+	if(mailbox_.empty())
+	{
+		return;
+	}
+	if(!force &&
+	   mailbox_.policy() == FrameMailbox::Policy::kLatestWins &&
+	   now - mailbox_.oldest() < kMaxFrameDelay &&
+	   RawInputPending())
+	{
+		return;
+	}
+
+	PipelineStats& stats = GetPipelineStats();
+	mailbox_.Drain([&](const FrameMailbox::Frame& frame) {
+		ScopedTimer timer(stats.gesture);
+		chiralScroll_.ProcessTouch(*frame.device, frame.contacts, frame.time);
+	});
+}
+
+void InputPipeline::CheckFirstScroll()
+{
+	const PipelineStats& stats = GetPipelineStats();
+	if(stats.scrollEvents.value() + stats.fallbackScrolls.value() == 0)
+	{
+		return;
+	}
+	firstScrollLogged_ = true;
+	SPDLOG_INFO("First scroll {:.1f}ms after process start, first report at {:.1f}ms.",
+		absl::ToDoubleMilliseconds(GetStartupTrace().elapsed()),
+		absl::ToDoubleMilliseconds(*firstReport_));
+}
+
+void InputPipeline::UpdateFieldDecoding()
+{
+	// Traces and published frames record every field.
+	const bool decodeAll = decodeAllFields_ || traceWriter_ || frameSegment_;
+	for(auto& pair : touchDevices_)
+	{
+		pair.second.SetDecodeAllFields(decodeAll);
+	}
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
+
+#include "ChiralScroll.h"
+#include "Clock.h"
+#include "FrameMailbox.h"
+#include "FrameSegment.h"
+#include "HidUtils.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+// The input path from WM_INPUT to scrolling, with no UI: decoding, frame
+// assembly, keyboard lockout and the gesture code. Shared by the tray
+// application and the headless daemon. Must only be used on the thread that
+// receives the raw input.
+class InputPipeline
+{
+public:
+	// The clock must outlive the pipeline. Complete frames are handed to the
+	// gesture code according to framePolicy. Records a trace to tracePath if
+	// given.
+	InputPipeline(
+		absl::flat_hash_map<HANDLE, TouchDevice> touchDevices,
+		ChiralScroll chiralScroll,
+		const Clock& clock,
+		FrameMailbox::Policy framePolicy,
+		const std::optional<std::filesystem::path>& tracePath);
+
+	// Sends keyboard and touchpad input to the given window.
+	static void RegisterRawInput(HWND hWnd);
+
+	// Publishes every finished frame in a FrameSegment from now on, for other
+	// processes to read. Returns false if the segment could not be created.
+	bool PublishFrames();
+
+	// Whether the devices decode every field of every contact, rather than
+	// only those the gesture code reads. They always do while a trace is
+	// recorded or frames are published.
+	void SetDecodeAllFields(bool decodeAll);
+
+	// Handles the input of a WM_INPUT message. Returns true if it was a
+	// touchpad report, after which the frame deadline may have changed.
+	bool HandleRawInput(HRAWINPUT handle);
+
+	// Time at which the earliest incomplete frame expires or a waiting frame
+	// is due, or InfiniteFuture if there is none. The owner should call
+	// ExpireFrames then, so that a frame whose last report was lost still
+	// gets delivered.
+	absl::Time frameDeadline() const;
+	void ExpireFrames();
+
+	ChiralScroll& chiralScroll()
+	{
+		return chiralScroll_;
+	}
+
+	const absl::flat_hash_map<HANDLE, TouchDevice>& touchDevices() const
+	{
+		return touchDevices_;
+	}
+
+private:
+	// Handling a frame for longer than this dumps the flight recorder.
+	static constexpr double kLongFrameNs = 20e6;
+	// While more raw input is queued, complete frames wait up to this long
+	// for newer frames to replace them. Roughly one display refresh.
+	static constexpr absl::Duration kMaxFrameDelay = absl::Milliseconds(8);
+
+	// Records a finished or expired frame in the flight recorder, and
+	// publishes it if frames are published.
+	void RecordFrame(HANDLE device, const std::vector<TouchDevice::Contact>& contacts, bool expired, absl::Time now);
+
+	// Locks out scrolling on a key press. Releases and auto-repeat are
+	// ignored, so holding a key does not keep extending the lockout.
+	void HandleKeyboard(HRAWINPUT handle);
+	void HandleTouch(const HidData& hidData);
+
+	// Hands the waiting frames to the gesture code, unless the policy is
+	// latest-wins, more raw input is queued, and they have not waited for
+	// kMaxFrameDelay yet. Always delivers them if force is set.
+	void DeliverFrames(absl::Time now, bool force);
+
+	// Logs how long after process start the first report arrived and the
+	// first scroll went out, once both have happened.
+	void CheckFirstScroll();
+
+	// Tells the devices which fields to decode.
+	void UpdateFieldDecoding();
+
+	absl::flat_hash_map<HANDLE, TouchDevice> touchDevices_;
+	// Device numbers in the flight recorder.
+	absl::flat_hash_map<HANDLE, uint8_t> deviceIndex_;
+	ChiralScroll chiralScroll_;
+	const Clock& clock_;
+	KeyPressFilter keyPressFilter_;
+	FrameMailbox mailbox_;
+	// Touchpad input is read into this buffer, sized for a report of any of
+	// the devices so that reading one does not allocate. It only grows if an
+	// event holds several reports.
+	std::vector<uint8_t> rawInputBuffer_;
+	std::unique_ptr<TraceWriter> traceWriter_;
+	std::optional<FrameSegment> frameSegment_;
+	bool decodeAllFields_;
+	std::optional<absl::Duration> firstReport_;
+	bool firstScrollLogged_;
+};
+
+}  // namespace chiralscroll
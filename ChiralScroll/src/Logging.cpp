@@ -0,0 +1,47 @@
+#include "Logging.h"
+
+#include <memory>
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/rotating_file_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr size_t kQueueSize = 8192;
+static constexpr size_t kMaxFileSize = 4 * 1024 * 1024;
+static constexpr size_t kMaxFiles = 2;
+
+}  // namespace
+
+void InitLogging(const std::filesystem::path& logPath, bool logToConsole)
+{
+	spdlog::init_thread_pool(kQueueSize, 1);
+	spdlog::sink_ptr sink;
+	if(logToConsole)
+	{
+		sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+	}
+	else
+	{
+		sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(logPath.string(), kMaxFileSize, kMaxFiles, true);
+	}
+	auto logger = std::make_shared<spdlog::async_logger>(
+		"chiralscroll", sink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+	// Picks up the level set on the command line.
+	spdlog::initialize_logger(logger);
+	spdlog::set_default_logger(std::move(logger));
+	// Errors usually come right before the process goes away.
+	spdlog::flush_on(spdlog::level::err);
+}
+
+void ShutdownLogging()
+{
+	spdlog::shutdown();
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+#include <absl/time/time.h>
+#include <spdlog/spdlog.h>
+
+namespace chiralscroll
+{
+
+// Sends the default logger to a bounded, rotating log file, or to the console,
+// through a background thread so that logging never waits on the disk. When
+// the queue is full the oldest messages are dropped rather than blocking the
+// caller.
+void InitLogging(const std::filesystem::path& logPath, bool logToConsole);
+
+// Flushes and stops the background logging thread.
+void ShutdownLogging();
+
+// Lets through at most one message per interval. Used per call site by
+// SPDLOG_WARN_EVERY. Measured on the steady clock, so that a step in the
+// system time neither silences warnings nor lets a burst through.
+class LogRateLimiter
+{
+public:
+	explicit LogRateLimiter(absl::Duration interval) : interval_(absl::ToInt64Nanoseconds(interval)) {}
+
+	// Returns true if a message may be logged now, and sets suppressed to the
+	// number of messages held back since the last one.
+	bool Allow(uint64_t* suppressed)
+	{
+		const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		int64_t next = next_.load(std::memory_order_relaxed);
+		if(now < next || !next_.compare_exchange_strong(next, now + interval_, std::memory_order_relaxed))
+		{
+			suppressed_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		*suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+		return true;
+	}
+
+private:
+	const int64_t interval_;
+	std::atomic<int64_t> next_{0};
+	std::atomic<uint64_t> suppressed_{0};
+};
+
+static constexpr absl::Duration kDefaultLogInterval = absl::Seconds(1);
+
+}  // namespace chiralscroll
+
+// Logs a warning at most once per interval from this call site. Suppressed
+// messages are not formatted at all; their number is reported before the next
+// message that gets through.
+#define SPDLOG_WARN_EVERY(interval, ...) \
+	do \
+	{ \
+		static ::chiralscroll::LogRateLimiter rateLimiter(interval); \
+		uint64_t suppressed = 0; \
+		if(rateLimiter.Allow(&suppressed)) \
+		{ \
+			if(suppressed > 0) \
+			{ \
+				SPDLOG_WARN("Suppressed {} similar messages.", suppressed); \
+			} \
+			SPDLOG_WARN(__VA_ARGS__); \
+		} \
+	} while(false)
@@ -1,5 +1,7 @@
 #include <exception>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -8,8 +10,6 @@
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/basic_file_sink.h>
-#include <spdlog/sinks/stdout_color_sinks.h>
 #include <wx/taskbar.h>
 #include <wx/app.h>
 #include <wx/cmdline.h>
@@ -17,26 +17,38 @@
 #include <wx/frame.h>
 #include <wx/icon.h>
 #include <wx/menu.h>
+#include <wx/timer.h>
+#include <wx/weakref.h>
 #include <wx/msw/private.h>
 #include <wx/msw/wrapwin.h>
 #include <wx/taskbar.h>
 #include <wx/valnum.h>
 
-// Must come after wrapwin.h
-#include <hidusage.h>
-
 #include "ChiralScroll.h"
 #include "ChiralScrollException.h"
+#include "Clock.h"
+#include "DaemonPipe.h"
+#include "DiagnosticsDialog.h"
+#include "EntryPoint.h"
+#include "FlightRecorder.h"
+#include "FrameMailbox.h"
 #include "HidUtils.h"
+#include "InjectionWatchdog.h"
+#include "InputPipeline.h"
+#include "Logging.h"
+#include "PipelineStats.h"
+#include "ProcessInfo.h"
+#include "Profiler.h"
 #include "resource.h"
 #include "Settings.h"
 #include "SettingsDialog.h"
+#include "StartupTrace.h"
+#include "StatsSegment.h"
 #include "StringUtils.h"
 #include "WinScroller.h"
 
 #define MAX_LOADSTRING 100
 
-using chiralscroll::HidData;
 using chiralscroll::TouchDevice;
 using chiralscroll::WinScroller;
 
@@ -45,14 +57,167 @@ static constexpr char kTitle[] = "ChiralScroll";
 namespace chiralscroll
 {
 
-std::filesystem::path GetCurrentDirectory()
+class SettingsDialogImpl : public SettingsDialog
 {
-	const DWORD size = ::GetCurrentDirectory(0, nullptr);
-	std::wstring str(size, '\0');
-	::GetCurrentDirectory(size, str.data());
-	str.resize(size - 1);
-	return std::filesystem::path(str);
-}
+public:
+	// Calls onSave with the edited settings when the user saves them. Shows
+	// live touches from snapshots if given, which is only possible in the
+	// process that reads the touchpads.
+	SettingsDialogImpl(
+		wxWindow* parent,
+		const Settings& settings,
+		std::function<void(Settings&)> onSave,
+		TripleBuffer<TouchSnapshot>* snapshots)
+		: SettingsDialog(parent),
+		  settings_(settings),
+		  deviceSettings_(nullptr),
+		  onSave_(std::move(onSave)),
+		  snapshots_(snapshots),
+		  overlayTimer_(this)
+	{
+		touchpadCtrl_->Bind(EVT_TOUCHPAD_VERTICAL, &SettingsDialogImpl::OnVerticalZone, this);
+		touchpadCtrl_->Bind(EVT_TOUCHPAD_HORIZONTAL, &SettingsDialogImpl::OnHorizontalZone, this);
+		Bind(wxEVT_TIMER, &SettingsDialogImpl::OnOverlayTimer, this);
+		Bind(wxEVT_SHOW, &SettingsDialogImpl::OnShow, this);
+		for(const auto& pair : settings_.GetDeviceSettings())
+		{
+			deviceSelector_->Append(pair.first);
+		}
+		deviceSelector_->SetSelection(0);
+		SelectDevice(0);
+	}
+
+	void OnSave(wxCommandEvent& event) override
+	{
+		TransferDataFromWindow();
+		onSave_(settings_);
+		Close(true);
+	}
+
+	void OnSelectDevice(wxCommandEvent& event) override
+	{
+		TransferDataFromWindow();
+		SelectDevice(event.GetSelection());
+	}
+
+	void OnEnable(wxCommandEvent& event) override
+	{
+		if(deviceSettings_)
+		{
+			deviceSettings_->enabled = static_cast<bool>(event.GetInt());
+			EnableControls(deviceSettings_->enabled);
+		}
+	}
+
+	void OnVerticalZone(TouchpadEvent& event)
+	{
+		if(deviceSettings_)
+		{
+			deviceSettings_->vScrollZone = event.GetValue();
+		}
+	}
+
+	void OnHorizontalZone(TouchpadEvent& event)
+	{
+		if(deviceSettings_)
+		{
+			deviceSettings_->hScrollZone = event.GetValue();
+		}
+	}
+
+	// Only reads snapshots while shown, since a hidden dialog would take
+	// them from the one that is.
+	void OnShow(wxShowEvent& event)
+	{
+		if(snapshots_ && event.IsShown())
+		{
+			overlayTimer_.Start(kOverlayIntervalMs);
+		}
+		else
+		{
+			overlayTimer_.Stop();
+		}
+		event.Skip();
+	}
+
+	// Shows the latest frame from the selected device on the touchpad
+	// control. Polled rather than pushed so that input processing never
+	// waits on the UI, and so that repaints happen at most once per tick
+	// however fast reports arrive.
+	void OnOverlayTimer(wxTimerEvent& event)
+	{
+		if(!snapshots_->Update())
+		{
+			return;
+		}
+		const TouchSnapshot& snapshot = snapshots_->front();
+		if(deviceSettings_ && snapshot.contactCount > 0 && snapshot.device == selectedDevice_)
+		{
+			touchpadCtrl_->SetOverlay(snapshot);
+		}
+		else
+		{
+			touchpadCtrl_->ClearOverlay();
+		}
+	}
+
+private:
+	// About one repaint per display refresh.
+	static constexpr int kOverlayIntervalMs = 16;
+
+	void SelectDevice(int selection)
+	{
+		touchpadCtrl_->ClearOverlay();
+		if(selection >= 0 && static_cast<unsigned int>(selection) < deviceSelector_->GetCount())
+		{
+			selectedDevice_ = std::string(deviceSelector_->GetStringSelection());
+			deviceSettings_ = &settings_.GetDeviceSettings(selectedDevice_);
+
+			ShowDeviceSettings();
+
+			enableDevice_->Enable();
+			EnableControls(deviceSettings_->enabled);
+
+			keyboardLockoutMs_->SetValidator(wxIntegerValidator<int>(&deviceSettings_->typingLockoutMs));
+			verticalSens_->SetValidator(wxFloatingPointValidator<float>(2, &deviceSettings_->vSens));
+			horizontalSens_->SetValidator(wxFloatingPointValidator<float>(2, &deviceSettings_->hSens));
+		}
+		else
+		{
+			// Should only occur if there are no touch devices.
+			enableDevice_->SetValue(false);
+			verticalSens_->SetValue("");
+			horizontalSens_->SetValue("");
+			touchpadCtrl_->SetValue(0.5f, 0.5f);
+
+			enableDevice_->Enable(false);
+			EnableControls(false);
+		}
+	}
+
+	void ShowDeviceSettings()
+	{
+		enableDevice_->SetValue(deviceSettings_->enabled);
+		verticalSens_->SetValue(absl::StrFormat("%.2f", deviceSettings_->vSens));
+		horizontalSens_->SetValue(absl::StrFormat("%.2f", deviceSettings_->hSens));
+		touchpadCtrl_->SetValue(deviceSettings_->vScrollZone, deviceSettings_->hScrollZone);
+	}
+
+	void EnableControls(bool enable)
+	{
+		keyboardLockoutMs_->Enable(enable);
+		verticalSens_->Enable(enable);
+		horizontalSens_->Enable(enable);
+		touchpadCtrl_->Enable(enable);
+	}
+
+	Settings settings_;
+	Settings::DeviceSettings* deviceSettings_;
+	std::string selectedDevice_;
+	std::function<void(Settings&)> onSave_;
+	TripleBuffer<TouchSnapshot>* snapshots_;
+	wxTimer overlayTimer_;
+};
 
 class ChiralScrollFrame : public wxFrame
 {
@@ -73,6 +238,11 @@ private:
 			wxMenu* menu = new wxMenu();
 			menu->AppendCheckItem(PU_ENABLE, "Enable");
 			menu->Append(PU_SETTINGS, "Settings");
+			menu->Append(PU_DIAGNOSTICS, "Diagnostics");
+#ifdef CHIRALSCROLL_PROFILE
+			menu->Append(PU_DUMP_PROFILE, "Dump profile");
+#endif
+			menu->Append(PU_DUMP_FLIGHT_RECORD, "Dump flight record");
 			menu->AppendSeparator();
 			menu->Append(PU_CLOSE, "Close");
 
@@ -96,129 +266,41 @@ private:
 			frame_.ShowSettings();
 		}
 
-		void OnClose(wxCommandEvent& event)
-		{
-			frame_.Close();
-		}
-
-		wxDECLARE_EVENT_TABLE();
-
-	private:
-		enum
-		{
-			PU_ENABLE,
-			PU_SETTINGS,
-			PU_CLOSE,
-		};
-
-		ChiralScrollFrame& frame_;
-	};
-
-	class SettingsDialogImpl : public SettingsDialog
-	{
-	public:
-		SettingsDialogImpl(ChiralScrollFrame& frame)
-			: SettingsDialog(&frame),
-			  settings_(frame.settings_),
-			  deviceSettings_(nullptr),
-			  frame_(frame)
-		{
-			touchpadCtrl_->Bind(EVT_TOUCHPAD_VERTICAL, &SettingsDialogImpl::OnVerticalZone, this);
-			touchpadCtrl_->Bind(EVT_TOUCHPAD_HORIZONTAL, &SettingsDialogImpl::OnHorizontalZone, this);
-			for(const auto& pair : settings_.GetDeviceSettings())
-			{
-				deviceSelector_->Append(pair.first);
-			}
-			deviceSelector_->SetSelection(0);
-			SelectDevice(0);
-		}
-
-		void OnSave(wxCommandEvent& event) override
+		void OnDiagnostics(wxCommandEvent& event)
 		{
-			TransferDataFromWindow();
-			frame_.SaveSettings(settings_);
-			Close(true);
+			frame_.ShowDiagnostics();
 		}
 
-		void OnSelectDevice(wxCommandEvent& event) override
+#ifdef CHIRALSCROLL_PROFILE
+		void OnDumpProfile(wxCommandEvent& event)
 		{
-			TransferDataFromWindow();
-			SelectDevice(event.GetSelection());
+			WriteProfile();
 		}
+#endif
 
-		void OnEnable(wxCommandEvent& event) override
+		void OnDumpFlightRecord(wxCommandEvent& event)
 		{
-			if(deviceSettings_)
-			{
-				deviceSettings_->enabled = static_cast<bool>(event.GetInt());
-				EnableControls(deviceSettings_->enabled);
-			}
+			GetFlightRecorder().RequestDump("requested from the tray menu");
 		}
 
-		void OnVerticalZone(TouchpadEvent& event)
+		void OnClose(wxCommandEvent& event)
 		{
-			if(deviceSettings_)
-			{
-				deviceSettings_->vScrollZone = event.GetValue();
-			}
+			frame_.Close();
 		}
 
-		void OnHorizontalZone(TouchpadEvent& event)
-		{
-			if(deviceSettings_)
-			{
-				deviceSettings_->hScrollZone = event.GetValue();
-			}
-		}
+		wxDECLARE_EVENT_TABLE();
 
 	private:
-		void SelectDevice(int selection)
-		{
-			if(selection >= 0 && static_cast<unsigned int>(selection) < deviceSelector_->GetCount())
-			{
-				deviceSettings_ = &settings_.GetDeviceSettings(
-					std::string(deviceSelector_->GetStringSelection()));
-
-				ShowDeviceSettings();
-
-				enableDevice_->Enable();
-				EnableControls(deviceSettings_->enabled);
-
-				keyboardLockoutMs_->SetValidator(wxIntegerValidator<int>(&deviceSettings_->typingLockoutMs));
-				verticalSens_->SetValidator(wxFloatingPointValidator<float>(2, &deviceSettings_->vSens));
-				horizontalSens_->SetValidator(wxFloatingPointValidator<float>(2, &deviceSettings_->hSens));
-			}
-			else
-			{
-				// Should only occur if there are no touch devices.
-				enableDevice_->SetValue(false);
-				verticalSens_->SetValue("");
-				horizontalSens_->SetValue("");
-				touchpadCtrl_->SetValue(0.5f, 0.5f);
-
-				enableDevice_->Enable(false);
-				EnableControls(false);
-			}
-		}
-
-		void ShowDeviceSettings()
-		{
-			enableDevice_->SetValue(deviceSettings_->enabled);
-			verticalSens_->SetValue(absl::StrFormat("%.2f", deviceSettings_->vSens));
-			horizontalSens_->SetValue(absl::StrFormat("%.2f", deviceSettings_->hSens));
-			touchpadCtrl_->SetValue(deviceSettings_->vScrollZone, deviceSettings_->hScrollZone);
-		}
-
-		void EnableControls(bool enable)
+		enum
 		{
-			keyboardLockoutMs_->Enable(enable);
-			verticalSens_->Enable(enable);
-			horizontalSens_->Enable(enable);
-			touchpadCtrl_->Enable(enable);
-		}
+			PU_ENABLE,
+			PU_SETTINGS,
+			PU_DIAGNOSTICS,
+			PU_DUMP_PROFILE,
+			PU_DUMP_FLIGHT_RECORD,
+			PU_CLOSE,
+		};
 
-		Settings settings_;
-		Settings::DeviceSettings* deviceSettings_;
 		ChiralScrollFrame& frame_;
 	};
 
@@ -228,45 +310,99 @@ public:
 		Settings& settings,
 		std::filesystem::path settingsPath,
 		absl::flat_hash_map<HANDLE, TouchDevice> touchDevices,
-		ChiralScroll chiralScroll)
+		ChiralScroll chiralScroll,
+		const Clock& clock,
+		FrameMailbox::Policy framePolicy,
+		const std::optional<std::filesystem::path>& tracePath)
 		: wxFrame(nullptr, wxID_ANY, title),
 		  hWnd_(static_cast<HWND>(GetHWND())),
-		  icon_(new NotificationIcon(*this)),  // wx takes ownership
+		  icon_(nullptr),
 		  settings_(settings),
 		  settingsPath_(settingsPath),
-		  touchDevices_(std::move(touchDevices)),
-		  chiralScroll_(std::move(chiralScroll)),
+		  pipeline_(std::move(touchDevices), std::move(chiralScroll), clock, framePolicy, tracePath),
+		  clock_(clock),
+		  frameTimer_(this),
+		  visibleSettings_(0),
 		  stopped_(false)
 	{
-		RAWINPUTDEVICE rid[]{
-			{HID_USAGE_PAGE_GENERIC, HID_USAGE_GENERIC_KEYBOARD, RIDEV_INPUTSINK, hWnd_},
-			{HID_USAGE_PAGE_DIGITIZER, HID_USAGE_DIGITIZER_TOUCH_PAD, RIDEV_INPUTSINK, hWnd_},
-		};
-		THROW_IF_FALSE(RegisterRawInputDevices(rid, sizeof(rid)/sizeof(RAWINPUTDEVICE), sizeof(RAWINPUTDEVICE)),
-			absl::StrCat("RegisterRawInputDevices failed: ", GetErrorMessage(GetLastError())));
+		Bind(wxEVT_TIMER, &ChiralScrollFrame::OnFrameTimer, this);
+		Bind(wxEVT_CLOSE_WINDOW, &ChiralScrollFrame::OnCloseWindow, this);
+		InputPipeline::RegisterRawInput(hWnd_);
+		GetStartupTrace().EndPhase("input");
+
+		// Input is already queued for us, so the icon can wait for the event
+		// loop. The menu and the dialogs are only built when first opened.
+		CallAfter([this]
+		{
+			icon_ = new NotificationIcon(*this);  // wx takes ownership
+			GetStartupTrace().EndPhase("tray icon");
+			SPDLOG_INFO("Startup: {}.", GetStartupTrace().Summary());
+		});
 	}
 
 	~ChiralScrollFrame()
 	{
-		icon_->Destroy();
+		if(icon_)
+		{
+			icon_->Destroy();
+		}
+	}
+
+	void PublishFrames()
+	{
+		pipeline_.PublishFrames();
 	}
 
 	void ToggleEnabled()
 	{
 		settings_.GetGlobalSettings().enabled = !settings_.GetGlobalSettings().enabled;
-		chiralScroll_.SetSettings(settings_);
+		pipeline_.chiralScroll().SetSettings(settings_);
 	}
 
+	// There is only ever one settings dialog, since only one reader can take
+	// the touch snapshots. A hidden one was cancelled or saved, so it is
+	// replaced to start again from the current settings.
 	void ShowSettings()
 	{
-		SettingsDialog* settingsDialog = new SettingsDialogImpl(*this);
-		settingsDialog->Show(true);
+		if(settingsDialog_ && settingsDialog_->IsShown())
+		{
+			settingsDialog_->Raise();
+			return;
+		}
+		if(settingsDialog_)
+		{
+			settingsDialog_->Destroy();
+		}
+		settingsDialog_ = new SettingsDialogImpl(
+			this,
+			settings_,
+			[this](Settings& settings) { SaveSettings(settings); },
+			&pipeline_.chiralScroll().touchSnapshots());
+		// The live overlay draws every contact, so decode all of them while
+		// the settings dialog is open.
+		settingsDialog_->Bind(wxEVT_SHOW, [this](wxShowEvent& event) {
+			visibleSettings_ += event.IsShown() ? 1 : -1;
+			pipeline_.SetDecodeAllFields(visibleSettings_ > 0);
+			event.Skip();
+		});
+		settingsDialog_->Show(true);
+	}
+
+	void ShowDiagnostics()
+	{
+		if(!diagnosticsDialog_)
+		{
+			diagnosticsDialog_ = new DiagnosticsDialog(this, pipeline_.touchDevices(), clock_);
+		}
+		diagnosticsDialog_->Show(true);
+		diagnosticsDialog_->Raise();
 	}
 
 	void SaveSettings(Settings& settings)
 	{
 		settings_ = settings;
-		chiralScroll_.SetSettings(settings);
+		pipeline_.chiralScroll().StoreNoiseEstimates(settings_);
+		pipeline_.chiralScroll().SetSettings(settings_);
 		settings_.ToFile(settingsPath_);
 	}
 
@@ -274,15 +410,9 @@ public:
 	{
 		if(!stopped_ && message == WM_INPUT)
 		{
-			auto maybeData = HidData::FromRawInput(reinterpret_cast<HRAWINPUT>(lParam));
-			if(maybeData)
-			{
-				HandleRawInput(*maybeData);
-			}
-			else
+			if(pipeline_.HandleRawInput(reinterpret_cast<HRAWINPUT>(lParam)))
 			{
-				// Input must have been keyboard.
-				chiralScroll_.ProcessKeyboard();
+				ScheduleFrameTimer();
 			}
 
 			// Indicates that application was in foreground, we must call DefWindowProc
@@ -302,28 +432,54 @@ public:
 	}
 
 private:
-	void HandleRawInput(HidData& hidData)
+	// Wakes up when the earliest incomplete frame expires, so that a frame
+	// whose last report was lost still gets delivered.
+	void ScheduleFrameTimer()
 	{
-		if(!touchDevices_.contains(hidData.header.hDevice))
+		const std::optional<int> delayMs = FrameTimerDelayMs(pipeline_, clock_);
+		if(!delayMs)
 		{
+			frameTimer_.Stop();
 			return;
 		}
+		frameTimer_.StartOnce(*delayMs);
+	}
 
-		auto& touchDevice = touchDevices_.at(hidData.header.hDevice);
-		const std::optional<std::vector<TouchDevice::Contact>> contacts = touchDevice.GetContacts(hidData);
-		if(!contacts)
+	// Keeps the noise measured this run for the next one.
+	void OnCloseWindow(wxCloseEvent& event)
+	{
+		pipeline_.chiralScroll().StoreNoiseEstimates(settings_);
+		try
+		{
+			settings_.ToFile(settingsPath_);
+		}
+		catch(const std::exception& e)
+		{
+			SPDLOG_WARN("Could not save the noise estimates: {}", e.what());
+		}
+		event.Skip();
+	}
+
+	void OnFrameTimer(wxTimerEvent& event)
+	{
+		if(stopped_)
 		{
 			return;
 		}
-		chiralScroll_.ProcessTouch(touchDevice, *contacts);
+		pipeline_.ExpireFrames();
+		ScheduleFrameTimer();
 	}
 
 	const HWND hWnd_;
-	NotificationIcon* const icon_;
+	NotificationIcon* icon_;
 	Settings& settings_;
 	std::filesystem::path settingsPath_;
-	absl::flat_hash_map<HANDLE, TouchDevice> touchDevices_;
-	ChiralScroll chiralScroll_;
+	InputPipeline pipeline_;
+	const Clock& clock_;
+	wxTimer frameTimer_;
+	wxWeakRef<SettingsDialogImpl> settingsDialog_;
+	wxWeakRef<DiagnosticsDialog> diagnosticsDialog_;
+	int visibleSettings_;
 	bool stopped_;
 };
 
@@ -331,6 +487,11 @@ wxBEGIN_EVENT_TABLE(ChiralScrollFrame::NotificationIcon, wxTaskBarIcon)
 	EVT_TASKBAR_LEFT_UP(ChiralScrollFrame::NotificationIcon::OnClick)
 	EVT_MENU(PU_ENABLE, ChiralScrollFrame::NotificationIcon::OnEnable)
 	EVT_MENU(PU_SETTINGS, ChiralScrollFrame::NotificationIcon::OnSettings)
+	EVT_MENU(PU_DIAGNOSTICS, ChiralScrollFrame::NotificationIcon::OnDiagnostics)
+#ifdef CHIRALSCROLL_PROFILE
+	EVT_MENU(PU_DUMP_PROFILE, ChiralScrollFrame::NotificationIcon::OnDumpProfile)
+#endif
+	EVT_MENU(PU_DUMP_FLIGHT_RECORD, ChiralScrollFrame::NotificationIcon::OnDumpFlightRecord)
 	EVT_MENU(PU_CLOSE, ChiralScrollFrame::NotificationIcon::OnClose)
 wxEND_EVENT_TABLE()
 
@@ -354,6 +515,13 @@ public:
 			{wxCMD_LINE_SWITCH, "", "logToConsole", "Log to console."},
 			{wxCMD_LINE_OPTION, "", "logLevel", "Logging level: trace, debug, info, warn, err, critical, or off (default warn).", wxCMD_LINE_VAL_STRING},
 			{wxCMD_LINE_SWITCH, "", "panicOnUnexpectedInput", "Panic and crash when unexpected inputs are received."},
+#ifdef CHIRALSCROLL_PROFILE
+			{wxCMD_LINE_SWITCH, "", "dumpProfileOnExit", "Write hot path timings to profile.txt on exit."},
+#endif
+			{wxCMD_LINE_OPTION, "", "recordTrace", "Record all touchpad reports to the given file, for replay by the tuner.", wxCMD_LINE_VAL_STRING},
+			{wxCMD_LINE_SWITCH, "", "inOrderFrames", "Handle every frame when input backs up, instead of skipping to the newest position."},
+			{wxCMD_LINE_SWITCH, "", "publishFrames", "Publish the touchpad contacts in shared memory, for other tools to read."},
+			{wxCMD_LINE_SWITCH, "", "ui", "Only show the settings, for ChiralScrollDaemon. Saving tells the daemon to reload them."},
 			{wxCMD_LINE_NONE},
 		};
 		parser.SetDesc(desc);
@@ -376,24 +544,42 @@ public:
 			panicOnUnexpectedInput_ = true;
 		}
 
-		static const absl::flat_hash_map<wxString, spdlog::level::level_enum> levelMap = {
-			{"trace", spdlog::level::trace},
-			{"debug", spdlog::level::debug},
-			{"info", spdlog::level::info},
-			{"warn", spdlog::level::warn},
-			{"err", spdlog::level::err},
-			{"critical", spdlog::level::critical},
-			{"off", spdlog::level::off},
-		};
-		wxString level = "warn";
-		if(parser.Found("logLevel", &level))
+#ifdef CHIRALSCROLL_PROFILE
+		if(parser.Found("dumpProfileOnExit"))
 		{
-			if(!levelMap.contains(level))
-			{
-				return false;
-			}
+			dumpProfileOnExit_ = true;
+		}
+#endif
+
+		if(parser.Found("ui"))
+		{
+			settingsOnly_ = true;
+		}
+
+		if(parser.Found("inOrderFrames"))
+		{
+			framePolicy_ = FrameMailbox::Policy::kInOrder;
+		}
+
+		if(parser.Found("publishFrames"))
+		{
+			publishFrames_ = true;
+		}
+
+		wxString tracePath;
+		if(parser.Found("recordTrace", &tracePath))
+		{
+			tracePath_ = std::filesystem::path(tracePath.ToStdWstring());
 		}
-		spdlog::set_level(levelMap.at(level));
+
+		wxString levelName = "warn";
+		parser.Found("logLevel", &levelName);
+		const std::optional<spdlog::level::level_enum> level = ParseLogLevel(levelName.ToStdString());
+		if(!level)
+		{
+			return false;
+		}
+		spdlog::set_level(*level);
 
 		return true;
 	}
@@ -405,28 +591,38 @@ public:
 			return false;
 		}
 
+		StartupTrace& startupTrace = GetStartupTrace();
+		startupTrace.EndPhase("load");
 		if(logToConsole_)
 		{
 			AllocConsole();
-			spdlog::set_default_logger(spdlog::stderr_color_mt("stderr_logger"));
 		}
-		else
+		if(settingsOnly_)
 		{
-			spdlog::set_default_logger(
-				spdlog::basic_logger_st("basic_logger", (GetCurrentDirectory() / "chiralscroll.log").string(), true));
+			InitLogging(GetCurrentDirectory() / "chiralscroll-ui.log", logToConsole_);
+			ShowSettingsOnly();
+			return true;
 		}
+		InitLogging(GetCurrentDirectory() / "chiralscroll.log", logToConsole_);
+		startupTrace.EndPhase("logging");
 
+		// Everything up to raw input registration is on the path to the first
+		// scroll. The tray icon is created once the event loop runs.
 		absl::flat_hash_map<HANDLE, TouchDevice> devices = chiralscroll::GetTouchDevices(panicOnUnexpectedInput_);
-		std::vector<std::string> deviceNames;
-		deviceNames.reserve(devices.size());
-		for(const auto& pair : devices)
+		startupTrace.EndPhase("devices");
+
+		std::optional<StatsSegment> statsSegment = PublishStats(devices);
+		if(statsSegment)
 		{
-			deviceNames.push_back(std::string(pair.second.name()));
+			statsSegment_.emplace(std::move(*statsSegment));
 		}
+		startupTrace.EndPhase("stats");
 
 		std::filesystem::path settingsPath = GetCurrentDirectory() / "settings.ini";
-		settings_ = Settings::FromFile(settingsPath, deviceNames);
+		settings_ = Settings::FromFile(settingsPath, GetDeviceNames(devices));
+		startupTrace.EndPhase("settings");
 
+		injectionWatchdog_ = std::make_unique<InjectionWatchdog>(clock_);
 		// wx takes ownership.
 		chiralScrollFrame_ = new ChiralScrollFrame(
 			kTitle,
@@ -435,11 +631,33 @@ public:
 			std::move(devices),
 			ChiralScroll(
 				settings_,
-				std::make_unique<WinScroller>(WinScroller::Direction::kVertical),
-				std::make_unique<WinScroller>(WinScroller::Direction::kHorizontal)));
+				WatchScroller(*injectionWatchdog_, WinScroller::Direction::kVertical),
+				WatchScroller(*injectionWatchdog_, WinScroller::Direction::kHorizontal),
+				clock_),
+			clock_,
+			framePolicy_,
+			tracePath_);
+		if(publishFrames_)
+		{
+			chiralScrollFrame_->PublishFrames();
+		}
+		SPDLOG_INFO("Ready: {}.", ResourceSummary());
 		return true;
 	}
 
+	int OnExit() override
+	{
+#ifdef CHIRALSCROLL_PROFILE
+		if(dumpProfileOnExit_)
+		{
+			WriteProfile();
+		}
+#endif
+		GetFlightRecorder().FinishDumps();
+		ShutdownLogging();
+		return wxApp::OnExit();
+	}
+
 	bool OnExceptionInMainLoop() override
 	{
 		// Let OnUnhandledException handle this.
@@ -454,12 +672,42 @@ public:
 		}
 		catch(const std::exception& e)
 		{
-			chiralScrollFrame_->Stop();
+			++GetPipelineStats().exceptions;
+			if(chiralScrollFrame_)
+			{
+				chiralScrollFrame_->Stop();
+			}
+			GetFlightRecorder().Dump(absl::StrCat("unhandled exception: ", e.what()));
 			OnException(e);
 		}
 	}
 
 private:
+	// Runs as the settings UI of ChiralScrollDaemon, which does the scrolling.
+	// Only the device names are read, the touchpads are left to the daemon.
+	// Exits when the dialog is closed.
+	void ShowSettingsOnly()
+	{
+		std::filesystem::path settingsPath = GetCurrentDirectory() / "settings.ini";
+		settings_ = Settings::FromFile(settingsPath, GetDeviceNames(chiralscroll::GetTouchDevices(panicOnUnexpectedInput_)));
+
+		SettingsDialogImpl* settingsDialog = new SettingsDialogImpl(
+			nullptr,
+			settings_,
+			[settingsPath](Settings& settings)
+			{
+				settings.ToFile(settingsPath);
+				if(!DaemonPipe::Send(DaemonPipe::kReload))
+				{
+					SPDLOG_WARN("ChiralScrollDaemon is not running, the settings apply from its next start.");
+				}
+			},
+			nullptr);
+		settingsDialog->Bind(wxEVT_CLOSE_WINDOW, [settingsDialog](wxCloseEvent& event) { settingsDialog->Destroy(); });
+		SetTopWindow(settingsDialog);
+		settingsDialog->Show(true);
+	}
+
 	void OnException(const std::exception& e)
 	{
 		std::string message = absl::StrCat("Caught exception: ", e.what());
@@ -472,9 +720,20 @@ private:
 	}
 
 	Settings settings_;
-	ChiralScrollFrame* chiralScrollFrame_;
+	// Every interval in the pipeline is measured with this clock.
+	MonotonicClock clock_;
+	// Must outlive everything that records statistics.
+	std::optional<StatsSegment> statsSegment_;
+	// Owns the scroll sinks, so must outlive the frame.
+	std::unique_ptr<InjectionWatchdog> injectionWatchdog_;
+	ChiralScrollFrame* chiralScrollFrame_ = nullptr;
 	bool logToConsole_ = false;
 	bool panicOnUnexpectedInput_ = false;
+	bool dumpProfileOnExit_ = false;
+	bool settingsOnly_ = false;
+	FrameMailbox::Policy framePolicy_ = FrameMailbox::Policy::kLatestWins;
+	bool publishFrames_ = false;
+	std::optional<std::filesystem::path> tracePath_;
 };
 
 wxIMPLEMENT_APP(ChiralScrollApp);
@@ -0,0 +1,74 @@
+#include "NoiseEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace chiralscroll
+{
+
+NoiseEstimator::NoiseEstimator(float initialNoise)
+	: meanSquare_(static_cast<double>(initialNoise)*initialNoise),
+	  samples_(initialNoise > 0.0f ? kMinSamples : 0),
+	  settleId_(std::nullopt),
+	  settlePosition_(0.0f, 0.0f),
+	  settleTime_(absl::InfinitePast())
+{
+}
+
+void NoiseEstimator::Update(const Touchpad& device, const ContactTracker& contacts, bool scrolling, absl::Time now)
+{
+	const std::vector<ContactDelta>& deltas = contacts.deltas();
+	if(scrolling || deltas.size() != 1 || !deltas[0].contact.isTouch)
+	{
+		Unsettle();
+		return;
+	}
+
+	const ContactDelta& delta = deltas[0];
+	const Touchpad::ContactInfo::Area& area = device.GetContactInfo(delta.contact.contactInfoLink).logicalArea;
+	const float height = static_cast<float>(area.bottom - area.top);
+	const Vector<float> position(static_cast<float>(delta.contact.logicalX), static_cast<float>(delta.contact.logicalY));
+	const std::optional<float> estimate = noise();
+	const float maxDrift = estimate ? std::min(kSettleNoiseMultiple*(*estimate), kMaxNoise) : kMaxNoise;
+	if(!settleId_ || *settleId_ != delta.contact.id || delta.type == ContactDelta::Type::kDown ||
+	   (position - settlePosition_).Norm()/height > maxDrift)
+	{
+		settleId_ = delta.contact.id;
+		settlePosition_ = position;
+		settleTime_ = now;
+		return;
+	}
+
+	// Repeated positions say nothing about the jitter, only that the device
+	// sent the same frame again.
+	if(delta.type != ContactDelta::Type::kMove || now - settleTime_ < kSettleTime)
+	{
+		return;
+	}
+
+	const double distance = delta.displacement.Norm()/height;
+	if(distance < kMaxNoise)
+	{
+		// Plain mean until warmed up, so that the first samples do not
+		// pull the estimate towards 0.
+		++samples_;
+		const double weight = std::max(kWeight, 1.0/samples_);
+		meanSquare_ += weight*(distance*distance - meanSquare_);
+	}
+}
+
+std::optional<float> NoiseEstimator::noise() const
+{
+	if(samples_ < kMinSamples)
+	{
+		return std::nullopt;
+	}
+	return static_cast<float>(std::sqrt(meanSquare_));
+}
+
+void NoiseEstimator::Unsettle()
+{
+	settleId_.reset();
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <absl/time/time.h>
+
+#include "ContactTracker.h"
+#include "Touchpad.h"
+#include "Vector.h"
+
+namespace chiralscroll
+{
+
+// Estimates how much a resting finger jitters on a touchpad, from how far a
+// lone contact moves between consecutive frames once it has settled. A
+// contact has settled when it has stayed within a few times the current
+// estimate of where it was for a while, so slow drags and the approach into a
+// deadzone are not mistaken for noise. Uses constant memory: the estimate is
+// an exponentially weighted mean square, so it follows slow changes such as a
+// new surface.
+class NoiseEstimator
+{
+public:
+	// Starts from a previous estimate, or from scratch if it is 0.
+	explicit NoiseEstimator(float initialNoise = 0.0f);
+
+	// Takes a sample from the frame if exactly one contact is touching, it
+	// has settled, and it is not scrolling.
+	void Update(const Touchpad& device, const ContactTracker& contacts, bool scrolling, absl::Time now);
+
+	// Root mean square movement of a resting finger between frames, as a
+	// fraction of the touchpad height. Nullopt until enough frames have been
+	// seen.
+	std::optional<float> noise() const;
+
+private:
+	// Larger movements between frames are the finger moving. Just below the
+	// default start deadzone.
+	static constexpr float kMaxNoise = 8.0f/1784;
+	// A contact that strays further than this many times the estimate from
+	// where it settled is moving, and has to settle again.
+	static constexpr float kSettleNoiseMultiple = 3.0f;
+	// How long a contact has to stay put before it is sampled.
+	static constexpr absl::Duration kSettleTime = absl::Milliseconds(250);
+	// Weight of each new sample once warmed up, about 4 seconds of resting
+	// contact at 125 frames per second.
+	static constexpr double kWeight = 1.0/512;
+	static constexpr uint64_t kMinSamples = 256;
+
+	// Forgets the settling contact.
+	void Unsettle();
+
+	double meanSquare_;
+	uint64_t samples_;
+	// The contact being watched, where it settled in logical units, and
+	// since when.
+	std::optional<ULONG> settleId_;
+	Vector<float> settlePosition_;
+	absl::Time settleTime_;
+};
+
+}  // namespace chiralscroll
@@ -0,0 +1,33 @@
+#include "PipelineStats.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Where GetPipelineStats records, which MovePipelineStats can change.
+PipelineStats*& PipelineStatsLocation()
+{
+	static PipelineStats stats;
+	static PipelineStats* location = &stats;
+	return location;
+}
+
+}  // namespace
+
+
+PipelineStats& GetPipelineStats()
+{
+	StartCalibration();
+	return *PipelineStatsLocation();
+}
+
+void MovePipelineStats(PipelineStats& stats)
+{
+	PipelineStats*& location = PipelineStatsLocation();
+	stats = *location;
+	location = &stats;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Profiler.h"
+
+namespace chiralscroll
+{
+
+// Counters for one device's reports and the frames assembled from them. They
+// can be read from any thread while reports are being added.
+struct FrameStats
+{
+	// Reports added, including stray ones.
+	Counter reports;
+	// Frames returned, including partial frames.
+	Counter frames;
+	// Frames returned with fewer contacts than expected.
+	Counter partialFrames;
+	// Incomplete frames that were thrown away.
+	Counter droppedFrames;
+	// Frames that contained the same contact more than once, which means
+	// reports from different scans were combined.
+	Counter mergedFrames;
+	// Continuation reports that did not belong to any frame.
+	Counter strayReports;
+	// Reports that could not be read or decoded.
+	Counter decodeErrors;
+	// Times the device was quarantined for repeated decode errors.
+	Counter quarantines;
+	// Reports ignored while the device was quarantined.
+	Counter quarantinedReports;
+};
+
+// Always-on timings and counts for the whole input path, shown in the
+// diagnostics window. Unlike the stage histograms these are recorded in every
+// build, so they only cover a few coarse steps.
+struct PipelineStats
+{
+	// From receiving a report to having decoded it and added it to a frame.
+	Histogram decode;
+	// Handling of a complete frame by ChiralScroll, including injection.
+	Histogram gesture;
+	// A single call to inject a scroll event.
+	Histogram injection;
+	// Injection calls that took longer than the stall threshold, recorded
+	// when they return.
+	Histogram injectionStalls;
+	// Scroll events injected.
+	Counter scrollEvents;
+	// Scroll events sent through the fallback while injection was stalled.
+	Counter fallbackScrolls;
+	// Scroll events dropped while injection was stalled.
+	Counter droppedScrolls;
+	// Scroll updates which rounded to zero and were not injected.
+	Counter emptyScrolls;
+	// Scroll sessions started.
+	Counter sessionsStarted;
+	// Frames that only moved contacts and were replaced by a newer frame
+	// before the gesture code saw them, because input was backed up.
+	Counter shedFrames;
+	// Frames in which no contact moved, which the session skipped.
+	Counter stationaryFrames;
+	// Unhandled exceptions.
+	Counter exceptions;
+};
+
+PipelineStats& GetPipelineStats();
+
+// Records the pipeline statistics at the given location from now on, e.g. in
+// shared memory, carrying over the counts so far. Must be called before input
+// processing starts, and the location must outlive all recording.
+void MovePipelineStats(PipelineStats& stats);
+
+}  // namespace chiralscroll
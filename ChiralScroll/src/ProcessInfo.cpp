@@ -0,0 +1,89 @@
+#include "ProcessInfo.h"
+
+#include <Windows.h>
+
+// Must come after Windows.h
+#include <psapi.h>
+
+#include <absl/strings/str_format.h>
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+absl::Time FileTimeToTime(const FILETIME& fileTime)
+{
+	ULARGE_INTEGER ticks;
+	ticks.LowPart = fileTime.dwLowDateTime;
+	ticks.HighPart = fileTime.dwHighDateTime;
+	// FILETIME counts 100ns intervals since 1601, which is all that matters
+	// for a difference.
+	return absl::UnixEpoch() + absl::Nanoseconds(static_cast<int64_t>(ticks.QuadPart) * 100);
+}
+
+absl::Duration FileTimeToDuration(const FILETIME& fileTime)
+{
+	return FileTimeToTime(fileTime) - absl::UnixEpoch();
+}
+
+}  // namespace
+
+
+absl::Duration TimeSinceProcessStart()
+{
+	FILETIME creation;
+	FILETIME exit;
+	FILETIME kernel;
+	FILETIME user;
+	if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		return absl::ZeroDuration();
+	}
+	FILETIME now;
+	GetSystemTimePreciseAsFileTime(&now);
+	return FileTimeToTime(now) - FileTimeToTime(creation);
+}
+
+size_t WorkingSetBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.WorkingSetSize;
+}
+
+uint64_t PageFaultCount()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.PageFaultCount;
+}
+
+absl::Duration ProcessCpuTime()
+{
+	FILETIME creation;
+	FILETIME exit;
+	FILETIME kernel;
+	FILETIME user;
+	if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+	{
+		return absl::ZeroDuration();
+	}
+	return FileTimeToDuration(kernel) + FileTimeToDuration(user);
+}
+
+std::string ResourceSummary()
+{
+	return absl::StrFormat("started in %.1fms, working set %.1fMB",
+		absl::ToDoubleMilliseconds(TimeSinceProcessStart()),
+		static_cast<double>(WorkingSetBytes()) / (1024 * 1024));
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <absl/time/time.h>
+
+namespace chiralscroll
+{
+
+// Time since the OS created this process, covering everything from loading
+// the executable and its DLLs to the point of the call.
+absl::Duration TimeSinceProcessStart();
+
+// Resident working set of this process in bytes, or 0 if it could not be
+// read.
+size_t WorkingSetBytes();
+
+// Page faults of this process so far, soft and hard, or 0 if they could not
+// be read.
+uint64_t PageFaultCount();
+
+// User and kernel CPU time used by this process so far, or zero if it could
+// not be read.
+absl::Duration ProcessCpuTime();
+
+// One line with both of the above, for the log.
+std::string ResourceSummary();
+
+}  // namespace chiralscroll
@@ -0,0 +1,145 @@
+#include "Profiler.h"
+
+#include <bit>
+#include <chrono>
+
+#include <absl/strings/str_format.h>
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr const char* kStageNames[] = {
+	"HidData::FromRawInput",
+	"Keyboard triage",
+	"TouchDevice::DecodeReport",
+	"FrameBuilder::AddReport",
+	"FrameBuilder::FinishFrame",
+	"ChiralScroll::ProcessTouch",
+	"ScrollSession::Update",
+	"Scroller::Scroll",
+};
+static_assert(std::size(kStageNames) == static_cast<size_t>(Stage::kCount));
+
+// The TSC and steady clock at startup, used to convert cycles to time.
+struct Calibration
+{
+	uint64_t cycles;
+	std::chrono::steady_clock::time_point time;
+};
+
+const Calibration& GetCalibration()
+{
+	static const Calibration calibration{__rdtsc(), std::chrono::steady_clock::now()};
+	return calibration;
+}
+
+double CyclesPerNanosecond()
+{
+	const Calibration& start = GetCalibration();
+	const uint64_t cycles = __rdtsc() - start.cycles;
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start.time);
+	if(elapsed.count() <= 0)
+	{
+		return 1.0;
+	}
+	return static_cast<double>(cycles)/static_cast<double>(elapsed.count());
+}
+
+}  // namespace
+
+
+size_t Histogram::BucketIndex(uint64_t cycles)
+{
+	static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+	if(cycles < kSubBuckets)
+	{
+		return static_cast<size_t>(cycles);
+	}
+	const int shift = std::bit_width(cycles) - 1 - kSubBucketBits;
+	const uint64_t subBucket = (cycles >> shift) & (kSubBuckets - 1);
+	return (static_cast<size_t>(shift + 1) << kSubBucketBits) + static_cast<size_t>(subBucket);
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index)
+{
+	static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+	if(index < kSubBuckets)
+	{
+		return index;
+	}
+	const int shift = static_cast<int>(index >> kSubBucketBits) - 1;
+	const uint64_t subBucket = index & (kSubBuckets - 1);
+	return ((kSubBuckets + subBucket + 1) << shift) - 1;
+}
+
+uint64_t Histogram::Percentile(double percentile) const
+{
+	const uint64_t total = count();
+	if(total == 0)
+	{
+		return 0;
+	}
+	const uint64_t rank = static_cast<uint64_t>(percentile/100.0*static_cast<double>(total - 1)) + 1;
+	uint64_t seen = 0;
+	for(size_t i = 0; i < kBucketCount; ++i)
+	{
+		seen += buckets_[i].value();
+		if(seen >= rank)
+		{
+			return std::min(BucketUpperBound(i), max());
+		}
+	}
+	return max();
+}
+
+Histogram& GetHistogram(Stage stage)
+{
+	static std::array<Histogram, static_cast<size_t>(Stage::kCount)> histograms;
+	GetCalibration();
+	return histograms[static_cast<size_t>(stage)];
+}
+
+void StartCalibration()
+{
+	GetCalibration();
+}
+
+double CyclesToNanoseconds(uint64_t cycles)
+{
+	return static_cast<double>(cycles)/CyclesPerNanosecond();
+}
+
+uint64_t NanosecondsToCycles(double ns)
+{
+	return static_cast<uint64_t>(ns*CyclesPerNanosecond());
+}
+
+std::string DumpProfile()
+{
+	const double cyclesPerNs = CyclesPerNanosecond();
+	const auto ns = [cyclesPerNs](uint64_t cycles) {
+		return static_cast<double>(cycles)/cyclesPerNs;
+	};
+
+	std::string result = absl::StrFormat("%-28s %10s %10s %10s %10s %10s %10s\n",
+		"Stage (ns)", "count", "p50", "p90", "p99", "p99.9", "max");
+	for(size_t i = 0; i < static_cast<size_t>(Stage::kCount); ++i)
+	{
+		const Histogram& histogram = GetHistogram(static_cast<Stage>(i));
+		absl::StrAppendFormat(&result, "%-28s %10d %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+			kStageNames[i],
+			histogram.count(),
+			ns(histogram.Percentile(50.0)),
+			ns(histogram.Percentile(90.0)),
+			ns(histogram.Percentile(99.0)),
+			ns(histogram.Percentile(99.9)),
+			ns(histogram.max()));
+	}
+	return result;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+namespace chiralscroll
+{
+
+// Stages of the input path which can be timed with PROFILE_SCOPE.
+enum class Stage
+{
+	kFromRawInput,
+	kKeyboard,
+	kDecodeReport,
+	kAddReport,
+	kFinishFrame,
+	kProcessTouch,
+	kSessionUpdate,
+	kScroll,
+	kCount,
+};
+
+// A counter which only one thread may increment, but any thread can read
+// without taking a lock.
+class Counter
+{
+public:
+	Counter() = default;
+	Counter(const Counter& other) : value_(other.value()) {}
+
+	Counter& operator=(const Counter& other)
+	{
+		value_.store(other.value(), std::memory_order_relaxed);
+		return *this;
+	}
+
+	// There is a single writer, so a plain load and store is enough and avoids
+	// a locked instruction.
+	void Add(uint64_t amount)
+	{
+		value_.store(value_.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	Counter& operator++()
+	{
+		Add(1);
+		return *this;
+	}
+
+	uint64_t value() const
+	{
+		return value_.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> value_{0};
+};
+
+// A histogram of durations in TSC cycles. Buckets grow exponentially and each
+// is split into 2^kSubBucketBits linear sub-buckets, so a percentile is within
+// 12.5% of the true value. Only one thread may record, but any thread can
+// read.
+class Histogram
+{
+public:
+	Histogram() = default;
+	Histogram(const Histogram& other)
+	{
+		*this = other;
+	}
+
+	Histogram& operator=(const Histogram& other)
+	{
+		buckets_ = other.buckets_;
+		count_ = other.count_;
+		max_.store(other.max(), std::memory_order_relaxed);
+		return *this;
+	}
+
+	void Record(uint64_t cycles)
+	{
+		++buckets_[BucketIndex(cycles)];
+		++count_;
+		if(cycles > max_.load(std::memory_order_relaxed))
+		{
+			max_.store(cycles, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t count() const
+	{
+		return count_.value();
+	}
+
+	uint64_t max() const
+	{
+		return max_.load(std::memory_order_relaxed);
+	}
+
+	// Returns an upper bound for the given percentile (0-100), in cycles.
+	uint64_t Percentile(double percentile) const;
+
+private:
+	static constexpr int kSubBucketBits = 3;
+	static constexpr size_t kBucketCount = 64 << kSubBucketBits;
+
+	static size_t BucketIndex(uint64_t cycles);
+	static uint64_t BucketUpperBound(size_t index);
+
+	std::array<Counter, kBucketCount> buckets_;
+	Counter count_;
+	std::atomic<uint64_t> max_{0};
+};
+
+Histogram& GetHistogram(Stage stage);
+
+// Starts the TSC calibration used to convert cycles to time, if it has not
+// started yet. The conversion gets more accurate the longer it runs, so
+// everything that records cycles calls this first.
+void StartCalibration();
+
+double CyclesToNanoseconds(uint64_t cycles);
+uint64_t NanosecondsToCycles(double ns);
+
+// Returns a table of the percentiles for each stage, in nanoseconds.
+std::string DumpProfile();
+
+// Records the time from construction to destruction in the given histogram, or
+// the histogram for the given stage.
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(Stage stage) : ScopedTimer(GetHistogram(stage)) {}
+	explicit ScopedTimer(Histogram& histogram) : histogram_(histogram), start_(__rdtsc()) {}
+	~ScopedTimer()
+	{
+		histogram_.Record(__rdtsc() - start_);
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	Histogram& histogram_;
+	const uint64_t start_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope. Compiles to nothing unless
+// CHIRALSCROLL_PROFILE is defined.
+#ifdef CHIRALSCROLL_PROFILE
+#define PROFILE_SCOPE(stage) \
+    ::chiralscroll::ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(::chiralscroll::Stage::stage)
+#else
+#define PROFILE_SCOPE(stage) static_cast<void>(0)
+#endif
+
+}  // namespace chiralscroll
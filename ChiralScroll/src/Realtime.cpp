@@ -0,0 +1,92 @@
+#include "Realtime.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "ChiralScrollException.h"
+#include "ProcessInfo.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Well beyond the deepest call chain on the input path.
+static constexpr size_t kPrefaultStackBytes = 256*1024;
+static constexpr size_t kPageBytes = 4096;
+
+void PrefaultStack()
+{
+	volatile char stack[kPrefaultStackBytes];
+	for(size_t i = 0; i < kPrefaultStackBytes; i += kPageBytes)
+	{
+		stack[i] = 0;
+	}
+}
+
+}  // namespace
+
+
+bool EnterRealtimeMode(size_t headroomBytes)
+{
+	bool ok = true;
+	if(!SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS))
+	{
+		SPDLOG_WARN("Could not raise the priority class: {}", GetErrorMessage(GetLastError()));
+		ok = false;
+	}
+
+	const HANDLE process = GetCurrentProcess();
+	SIZE_T minimum = 0;
+	SIZE_T maximum = 0;
+	DWORD flags = 0;
+	if(!GetProcessWorkingSetSizeEx(process, &minimum, &maximum, &flags))
+	{
+		SPDLOG_WARN("Could not read the working set limits: {}", GetErrorMessage(GetLastError()));
+		return false;
+	}
+	minimum = WorkingSetBytes() + headroomBytes;
+	maximum = std::max(maximum, minimum + headroomBytes);
+	if(!SetProcessWorkingSetSizeEx(process, minimum, maximum, QUOTA_LIMITS_HARDWS_MIN_ENABLE | QUOTA_LIMITS_HARDWS_MAX_DISABLE))
+	{
+		SPDLOG_WARN("Could not lock {:.1f}MB in memory: {}",
+			static_cast<double>(minimum) / (1024 * 1024), GetErrorMessage(GetLastError()));
+		ok = false;
+	}
+	PrefaultStack();
+	return ok;
+}
+
+bool SetRealtimeThread(HANDLE thread, int priority, int cpu)
+{
+	bool ok = true;
+	if(!SetThreadPriority(thread, priority))
+	{
+		SPDLOG_WARN("Could not set thread priority {}: {}", priority, GetErrorMessage(GetLastError()));
+		ok = false;
+	}
+	if(cpu >= 0)
+	{
+		if(cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8) || !SetThreadAffinityMask(thread, DWORD_PTR{1} << cpu))
+		{
+			SPDLOG_WARN("Could not pin a thread to CPU {}: {}", cpu, GetErrorMessage(GetLastError()));
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+PageFaultMonitor::PageFaultMonitor() : last_(PageFaultCount()), total_(0) {}
+
+uint64_t PageFaultMonitor::Check()
+{
+	const uint64_t count = PageFaultCount();
+	const uint64_t faults = count - last_;
+	last_ = count;
+	total_ += faults;
+	return faults;
+}
+
+}  // namespace chiralscroll
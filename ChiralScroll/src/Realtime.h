@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <Windows.h>
+
+namespace chiralscroll
+{
+
+// Opt-in measures that keep the input path from being descheduled or paged
+// out on a loaded machine.
+//
+// Raises the process to the high priority class, and makes its current
+// working set plus headroomBytes a hard minimum, so that the memory manager
+// does not trim the pages of the input path under memory pressure. Then
+// touches the stack of the calling thread, so that deep calls do not fault in
+// new stack pages later. Should be called once everything on the input path
+// has been allocated. Logs and returns false if any step failed.
+bool EnterRealtimeMode(size_t headroomBytes);
+
+// Sets the priority of the given thread, and pins it to the given CPU unless
+// cpu is negative. Logs and returns false if either failed.
+bool SetRealtimeThread(HANDLE thread, int priority, int cpu);
+
+// Counts the page faults of this process, soft and hard, between checks. In
+// real-time mode the steady state should not fault at all, so any it counts
+// point at memory that was not allocated or touched up front.
+class PageFaultMonitor
+{
+public:
+	PageFaultMonitor();
+
+	// Page faults since the last check, or since construction.
+	uint64_t Check();
+
+	// Page faults over all checks so far.
+	uint64_t total() const
+	{
+		return total_;
+	}
+
+private:
+	uint64_t last_;
+	uint64_t total_;
+};
+
+}  // namespace chiralscroll
@@ -0,0 +1,117 @@
+#include "Replay.h"
+
+#include <memory>
+#include <optional>
+
+#include "ChiralScroll.h"
+#include "Clock.h"
+#include "Scroller.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+class ReplayScroller : public Scroller
+{
+public:
+	ReplayScroller(ReplayResult::Axis axis, const Clock& clock, absl::Time epoch, std::vector<ReplayResult::ScrollEvent>& events)
+		: axis_(axis), clock_(clock), epoch_(epoch), events_(events) {}
+
+	void StartScrolling() override
+	{
+		events_.push_back({clock_.Now() - epoch_, axis_, ReplayResult::ScrollEvent::Type::kStart, 0});
+	}
+
+	void Scroll(int amt) override
+	{
+		events_.push_back({clock_.Now() - epoch_, axis_, ReplayResult::ScrollEvent::Type::kScroll, amt});
+	}
+
+	void StopScrolling() override
+	{
+		events_.push_back({clock_.Now() - epoch_, axis_, ReplayResult::ScrollEvent::Type::kStop, 0});
+	}
+
+private:
+	const ReplayResult::Axis axis_;
+	const Clock& clock_;
+	const absl::Time epoch_;
+	std::vector<ReplayResult::ScrollEvent>& events_;
+};
+
+}  // namespace
+
+
+ReplayResult ReplayTrace(const Trace& trace, const Settings& settings, bool keepFrames)
+{
+	ReplayResult result;
+	// Replay time is measured from the start of the trace, and only moves as
+	// the records are replayed.
+	const absl::Time epoch = absl::UnixEpoch();
+	VirtualClock clock(epoch);
+
+	std::vector<TouchDevice::FrameBuilder> frameBuilders;
+	frameBuilders.reserve(trace.devices.size());
+	for(const auto& device : trace.devices)
+	{
+		frameBuilders.emplace_back(device.contactInfo().size(), false);
+	}
+
+	std::optional<ChiralScroll> chiralScroll;
+	chiralScroll.emplace(
+		settings,
+		std::make_unique<ReplayScroller>(ReplayResult::Axis::kVertical, clock, epoch, result.scrolls),
+		std::make_unique<ReplayScroller>(ReplayResult::Axis::kHorizontal, clock, epoch, result.scrolls),
+		clock);
+
+	const auto processFrame = [&](uint32_t device, const TouchDevice::FrameBuilder::Frame& frame)
+	{
+		if(keepFrames)
+		{
+			result.frames.push_back({clock.Now() - epoch, device, frame.contacts});
+		}
+		chiralScroll->ProcessTouch(trace.devices[device], frame.contacts, frame.time);
+	};
+
+	for(const auto& record : trace.records)
+	{
+		// Deliver frames that would have been flushed by the frame timer.
+		for(uint32_t device = 0; device < frameBuilders.size(); ++device)
+		{
+			const absl::Time deadline = frameBuilders[device].deadline();
+			if(deadline < epoch + record.time)
+			{
+				clock.Set(deadline);
+				const auto frame = frameBuilders[device].Expire(deadline + absl::Nanoseconds(1));
+				if(frame)
+				{
+					processFrame(device, *frame);
+				}
+			}
+		}
+
+		clock.Set(epoch + record.time);
+		const auto frames = frameBuilders[record.device].AddReport(record.report, clock.Now());
+		if(frames.flushed)
+		{
+			processFrame(record.device, *frames.flushed);
+		}
+		if(frames.finished)
+		{
+			processFrame(record.device, *frames.finished);
+		}
+	}
+
+	// End any session still in progress.
+	chiralScroll.reset();
+
+	for(const auto& frameBuilder : frameBuilders)
+	{
+		result.frameStats.push_back(frameBuilder.stats());
+	}
+	return result;
+}
+
+}  // namespace chiralscroll
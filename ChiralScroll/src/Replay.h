@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <absl/time/time.h>
+
+#include "HidUtils.h"
+#include "Settings.h"
+#include "Touchpad.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+struct ReplayResult
+{
+	enum class Axis { kVertical, kHorizontal };
+
+	struct Frame
+	{
+		absl::Duration time;
+		uint32_t device;
+		std::vector<Touchpad::Contact> contacts;
+	};
+
+	struct ScrollEvent
+	{
+		enum class Type { kStart, kScroll, kStop };
+
+		absl::Duration time;
+		Axis axis;
+		Type type;
+		// Only set for kScroll.
+		int amount;
+	};
+
+	// Only filled in if requested, since the frames do not depend on the
+	// settings.
+	std::vector<Frame> frames;
+	std::vector<ScrollEvent> scrolls;
+	// Indexed like Trace::devices.
+	std::vector<TouchDevice::FrameBuilder::Stats> frameStats;
+};
+
+// Replays a trace through the frame builder and gesture code with the given
+// settings, and records what would have been scrolled.
+ReplayResult ReplayTrace(const Trace& trace, const Settings& settings, bool keepFrames);
+
+}  // namespace chiralscroll
@@ -8,6 +8,7 @@
 #include <Windows.h>
 
 #include <absl/strings/substitute.h>
+#include <spdlog/spdlog.h>
 
 #include "ChiralScrollException.h"
 #include "StringUtils.h"
@@ -30,6 +31,7 @@ static constexpr struct
 	float reverseDeadzone = 20.0f/1784;
 	float reverseDeadzoneAngle = 3.14159f/1.0f;
 	float sensScalingFactor = 0.1f;
+	bool adaptiveDeadzones = false;
 
 	// Device settings.
 	int typingLockoutMs = 500;
@@ -37,8 +39,13 @@ static constexpr struct
 	float hScrollZone = 0.1f;
 	float vSens = 10.0f;
 	float hSens = 10.0f;
+	float noise = 0.0f;
+	// No acceleration.
+	const char* accelerationCurve = "";
 } kDefaultSettings;
 
+// Initial size of the buffer for a value. Longer values, like acceleration
+// curves with many points, are read again into a larger buffer.
 static constexpr DWORD kMaxBuffer = 64;
 static constexpr DWORD kMaxSectionsBuffer = 1024;
 
@@ -86,6 +93,9 @@ std::wstring ToWstring(bool value) {
 std::wstring ToWstring(std::string_view str) {
 	return StringToWstring(str);
 }
+std::wstring ToWstring(const std::string& str) {
+	return StringToWstring(str);
+}
 std::wstring ToWstring(std::wstring str) {
 	return str;
 }
@@ -100,15 +110,7 @@ public:
 	template<typename T>
 	T ReadSetting(const std::wstring& key, const T& def) const
 	{
-		std::wstring str(kMaxBuffer, '\0');
-		const DWORD size = GetPrivateProfileString(
-			section_.c_str(),
-			key.c_str(),
-			ToWstring(def).c_str(),
-			str.data(),
-			kMaxBuffer,
-			path_.c_str());
-		str.resize(size);
+		const std::wstring str = ReadString(key, ToWstring(def));
 		try
 		{
 			return FromWstring<T>(str);
@@ -118,7 +120,7 @@ public:
 			throw ChiralScrollException(
 				e,
 				absl::Substitute(
-					"Error parsing $0. Could not parse: $2",
+					"Error parsing $0. Could not parse: $1",
 					WstringToString(key),
 					WstringToString(str)));
 		}
@@ -138,6 +140,29 @@ public:
 	}
 
 private:
+	// GetPrivateProfileString truncates a value that does not fit and returns
+	// nSize - 1, so read again with twice the buffer until it fits.
+	std::wstring ReadString(const std::wstring& key, const std::wstring& def) const
+	{
+		std::wstring str;
+		DWORD bufferSize = kMaxBuffer;
+		DWORD size;
+		do
+		{
+			str.resize(bufferSize);
+			size = GetPrivateProfileString(
+				section_.c_str(),
+				key.c_str(),
+				def.c_str(),
+				str.data(),
+				bufferSize,
+				path_.c_str());
+			bufferSize *= 2;
+		} while(size == str.size() - 1);
+		str.resize(size);
+		return str;
+	}
+
 	const std::filesystem::path path_;
 	const std::wstring section_;
 };
@@ -156,6 +181,22 @@ private:
 	const std::filesystem::path path_;
 };
 
+// A bad curve only loses the acceleration of one device, so it is reported
+// and replaced by no acceleration instead of failing to start.
+AccelerationCurve ReadAccelerationCurve(const IniSection& section)
+{
+	const std::string text = section.ReadSetting<std::string>(L"accelerationCurve", kDefaultSettings.accelerationCurve);
+	try
+	{
+		return AccelerationCurve::FromString(text);
+	}
+	catch(const std::exception& e)
+	{
+		SPDLOG_ERROR("Error parsing accelerationCurve, using no acceleration. Could not parse: {}. {}", text, e.what());
+		return AccelerationCurve();
+	}
+}
+
 }
 
 #define READ_SETTING(var) ReadSetting(L#var, kDefaultSettings.var)
@@ -174,6 +215,7 @@ Settings Settings::FromFile(const std::filesystem::path& path, const std::vector
 		globalSection.READ_SETTING(reverseDeadzone),
 		globalSection.READ_SETTING(reverseDeadzoneAngle),
 		globalSection.READ_SETTING(sensScalingFactor),
+		globalSection.READ_SETTING(adaptiveDeadzones),
 	};
 
 	for(const auto& device : devices)
@@ -186,6 +228,8 @@ Settings Settings::FromFile(const std::filesystem::path& path, const std::vector
 			iniSection.READ_SETTING(hScrollZone),
 			iniSection.READ_SETTING(vSens),
 			iniSection.READ_SETTING(hSens),
+			iniSection.READ_SETTING(noise),
+			ReadAccelerationCurve(iniSection),
 		};
 	}
 	return settings;
@@ -196,7 +240,15 @@ Settings Settings::FromFile(const std::filesystem::path& path, const std::vector
 void Settings::ToFile(const std::filesystem::path& path) const
 {
 	const IniFile iniFile(path);
-	iniFile.GetSection(L"Global Settings").WRITE_SETTING(globalSettings_, enabled);
+	iniFile.GetSection(L"Global Settings")
+		.WRITE_SETTING(globalSettings_, enabled)
+		.WRITE_SETTING(globalSettings_, startDeadzone)
+		.WRITE_SETTING(globalSettings_, startDeadzoneAngle)
+		.WRITE_SETTING(globalSettings_, moveDeadzone)
+		.WRITE_SETTING(globalSettings_, reverseDeadzone)
+		.WRITE_SETTING(globalSettings_, reverseDeadzoneAngle)
+		.WRITE_SETTING(globalSettings_, sensScalingFactor)
+		.WRITE_SETTING(globalSettings_, adaptiveDeadzones);
 
 	for(const auto& pair : deviceSettings_)
 	{
@@ -208,7 +260,9 @@ void Settings::ToFile(const std::filesystem::path& path) const
 			.WRITE_SETTING(settings, vScrollZone)
 			.WRITE_SETTING(settings, hScrollZone)
 			.WRITE_SETTING(settings, vSens)
-			.WRITE_SETTING(settings, hSens);
+			.WRITE_SETTING(settings, hSens)
+			.WRITE_SETTING(settings, noise)
+			.WriteSetting(L"accelerationCurve", settings.accelerationCurve.ToString());
 	}
 }
 
@@ -237,6 +291,8 @@ Settings::DeviceSettings& Settings::GetDeviceSettings(std::string_view deviceNam
 		kDefaultSettings.hScrollZone,
 		kDefaultSettings.vSens,
 		kDefaultSettings.hSens,
+		kDefaultSettings.noise,
+		AccelerationCurve(),
 	};
 	return settings;
 }
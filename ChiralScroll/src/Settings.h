@@ -6,6 +6,8 @@
 
 #include <absl/container/flat_hash_map.h>
 
+#include "AccelerationCurve.h"
+
 namespace chiralscroll
 {
 
@@ -30,6 +32,8 @@ public:
 		float reverseDeadzoneAngle;
 		// A scaling factor applied to sensitivity to make the vSens and hSens settings more convenient.
 		float sensScalingFactor;
+		// Whether to scale the deadzones to the measured noise of each device.
+		bool adaptiveDeadzones;
 	};
 
 	struct DeviceSettings
@@ -48,6 +52,11 @@ public:
 		float vSens;
 		// Horizontal scrolling sensitivity.
 		float hSens;
+		// Measured jitter of a resting finger, as a fraction of the vertical
+		// height, or 0 if not measured yet. Learned while running.
+		float noise;
+		// Scales the sensitivity by how fast the finger moves.
+		AccelerationCurve accelerationCurve;
 	};
 
 	Settings() = default;
@@ -0,0 +1,46 @@
+#include "StartupTrace.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+
+#include "ProcessInfo.h"
+
+namespace chiralscroll
+{
+
+StartupTrace::StartupTrace()
+	: processStart_(absl::Now() - TimeSinceProcessStart()),
+	  phaseStart_(processStart_)
+{
+}
+
+void StartupTrace::EndPhase(std::string_view name)
+{
+	const absl::Time now = absl::Now();
+	phases_.push_back({std::string(name), now - phaseStart_});
+	phaseStart_ = now;
+}
+
+absl::Duration StartupTrace::elapsed() const
+{
+	return absl::Now() - processStart_;
+}
+
+std::string StartupTrace::Summary() const
+{
+	std::string summary;
+	for(const Phase& phase : phases_)
+	{
+		absl::StrAppendFormat(&summary, "%s %.1fms, ", phase.name, absl::ToDoubleMilliseconds(phase.duration));
+	}
+	absl::StrAppendFormat(&summary, "total %.1fms", absl::ToDoubleMilliseconds(phaseStart_ - processStart_));
+	return summary;
+}
+
+StartupTrace& GetStartupTrace()
+{
+	static StartupTrace trace;
+	return trace;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/time/time.h>
+
+namespace chiralscroll
+{
+
+// Times startup in named phases, so that a slow start after login can be
+// pinned on one of them. The phases are back to back and the first one starts
+// when the OS created the process, so it covers loading the executable and
+// its DLLs and everything before the first call to EndPhase. Only used from
+// the thread that starts the application.
+class StartupTrace
+{
+public:
+	StartupTrace();
+
+	// Ends the phase in progress, which gets the given name, and starts the
+	// next one.
+	void EndPhase(std::string_view name);
+
+	// Time since the OS created the process.
+	absl::Duration elapsed() const;
+
+	// Each phase with its duration, in order, and the total, in one line for
+	// the log.
+	std::string Summary() const;
+
+private:
+	struct Phase
+	{
+		std::string name;
+		absl::Duration duration;
+	};
+
+	absl::Time processStart_;
+	absl::Time phaseStart_;
+	std::vector<Phase> phases_;
+};
+
+// The trace of this process, started on first use.
+StartupTrace& GetStartupTrace();
+
+}  // namespace chiralscroll
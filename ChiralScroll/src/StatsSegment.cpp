@@ -0,0 +1,108 @@
+#include "StatsSegment.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#include "ChiralScrollException.h"
+
+namespace chiralscroll
+{
+
+std::optional<StatsSegment> StatsSegment::Create(const wchar_t* name)
+{
+	const HANDLE mapping = CreateFileMapping(
+		INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedStats), name);
+	if(!mapping)
+	{
+		SPDLOG_WARN("Could not create the stats segment: {}", GetErrorMessage(GetLastError()));
+		return std::nullopt;
+	}
+	if(GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		SPDLOG_WARN("The stats segment is owned by another process, not publishing stats.");
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedStats));
+	if(!view)
+	{
+		SPDLOG_WARN("Could not map the stats segment: {}", GetErrorMessage(GetLastError()));
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	// The pages of a new mapping are zeroed, but the counters still need to be
+	// constructed.
+	SharedStats* stats = new(view) SharedStats();
+	stats->version = SharedStats::kVersion;
+	stats->processId = GetCurrentProcessId();
+	stats->magic.store(SharedStats::kMagic, std::memory_order_release);
+	return StatsSegment(mapping, stats);
+}
+
+std::optional<StatsSegment> StatsSegment::Open(const wchar_t* name)
+{
+	const HANDLE mapping = OpenFileMapping(FILE_MAP_READ, FALSE, name);
+	if(!mapping)
+	{
+		return std::nullopt;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(SharedStats));
+	if(!view)
+	{
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	SharedStats* stats = static_cast<SharedStats*>(view);
+	if(stats->magic.load(std::memory_order_acquire) != SharedStats::kMagic
+	   || stats->version != SharedStats::kVersion)
+	{
+		UnmapViewOfFile(view);
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+	return StatsSegment(mapping, stats);
+}
+
+StatsSegment::StatsSegment(StatsSegment&& other) noexcept
+	: mapping_(std::exchange(other.mapping_, nullptr)),
+	  stats_(std::exchange(other.stats_, nullptr))
+{
+}
+
+StatsSegment::~StatsSegment()
+{
+	if(stats_)
+	{
+		UnmapViewOfFile(stats_);
+	}
+	if(mapping_)
+	{
+		CloseHandle(mapping_);
+	}
+}
+
+FrameStats* StatsSegment::AddDevice(std::string_view name)
+{
+	const uint32_t index = stats_->deviceCount.load(std::memory_order_relaxed);
+	if(index >= SharedStats::kMaxDevices)
+	{
+		SPDLOG_WARN("No room in the stats segment for device {}.", name);
+		return nullptr;
+	}
+
+	SharedStats::Device& device = stats_->devices[index];
+	const size_t length = std::min(name.size(), SharedStats::kMaxNameLength - 1);
+	std::copy_n(name.begin(), length, device.name.begin());
+	device.name[length] = '\0';
+	stats_->deviceCount.store(index + 1, std::memory_order_release);
+	return &device.frames;
+}
+
+}  // namespace chiralscroll
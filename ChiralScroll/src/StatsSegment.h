@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <Windows.h>
+
+#include "PipelineStats.h"
+
+namespace chiralscroll
+{
+
+static constexpr wchar_t kStatsSegmentName[] = L"Local\\ChiralScrollStats";
+
+// Layout of the statistics segment shared with StatsReader. Both sides must be
+// built from the same version of this header; bump kVersion when changing it.
+struct SharedStats
+{
+	static constexpr uint64_t kMagic = 0x5354415453534353;  // "CSSSTATS"
+	static constexpr uint32_t kVersion = 5;
+	static constexpr size_t kMaxDevices = 8;
+	static constexpr size_t kMaxNameLength = 256;
+
+	// Padded to a cache line so that the reader touching one device does not
+	// share a line with the writer updating another.
+	struct alignas(64) Device
+	{
+		std::array<char, kMaxNameLength> name;
+		FrameStats frames;
+	};
+
+	// Set last, once the rest of the header is valid.
+	std::atomic<uint64_t> magic;
+	uint32_t version;
+	uint32_t processId;
+	// Devices before this index are valid.
+	std::atomic<uint32_t> deviceCount;
+	alignas(64) PipelineStats pipeline;
+	std::array<Device, kMaxDevices> devices;
+};
+
+// A named shared memory segment holding SharedStats, so that the statistics
+// can be read by another process without any cost to this one.
+class StatsSegment
+{
+public:
+	// Creates the segment. Returns nullopt if it cannot be created, for
+	// example because another instance is already running.
+	static std::optional<StatsSegment> Create(const wchar_t* name = kStatsSegmentName);
+
+	// Opens an existing segment for reading. Returns nullopt if there is none
+	// or it has a different layout.
+	static std::optional<StatsSegment> Open(const wchar_t* name = kStatsSegmentName);
+
+	StatsSegment(StatsSegment&& other) noexcept;
+	StatsSegment& operator=(StatsSegment&&) = delete;
+	StatsSegment(const StatsSegment&) = delete;
+	StatsSegment& operator=(const StatsSegment&) = delete;
+	~StatsSegment();
+
+	SharedStats& stats()
+	{
+		return *stats_;
+	}
+
+	const SharedStats& stats() const
+	{
+		return *stats_;
+	}
+
+	// Reserves a slot for the named device and returns its counters, or
+	// nullptr if all slots are taken. Only the creating process may call this.
+	FrameStats* AddDevice(std::string_view name);
+
+private:
+	StatsSegment(HANDLE mapping, SharedStats* stats) : mapping_(mapping), stats_(stats) {}
+
+	HANDLE mapping_;
+	SharedStats* stats_;
+};
+
+}  // namespace chiralscroll
@@ -2,6 +2,9 @@
 
 #include <algorithm>
 
+#include "PipelineStats.h"
+#include "Profiler.h"
+
 namespace chiralscroll
 {
 
@@ -18,17 +21,18 @@ namespace
 }  // namespace
 
 
-bool NonScrollSession::Update(const std::vector<TouchDevice::Contact>& contacts)
+bool NonScrollSession::Update(const ContactTracker& contacts)
 {
-	return std::any_of(contacts.begin(), contacts.end(),
-		[](const auto& contact) { return contact.isTouch; });
+	return std::any_of(contacts.deltas().begin(), contacts.deltas().end(),
+		[](const auto& delta) { return delta.contact.isTouch; });
 }
 
 ScrollSession::ScrollSession(
-	const TouchDevice& device,
-	const TouchDevice::Contact& initialContact,
+	const Touchpad& device,
+	const Touchpad::Contact& initialContact,
 	Vector<float> initialDirection,
 	float sens,
+	const AccelerationCurve& accelerationCurve,
 	const Settings::GlobalSettings& globalSettings,
 	Scroller& scroller)
 	: TouchSession(device),
@@ -38,6 +42,7 @@ ScrollSession::ScrollSession(
 	  position_(ScaleVector(Vector<LONG>(initialContact.logicalX, initialContact.logicalY))),
 	  scrollDirection_(0.0f),
 	  sens_(sens),
+	  accelerationCurve_(accelerationCurve),
 	  settings_(globalSettings),
 	  scroller_(scroller)
 {
@@ -48,32 +53,33 @@ ScrollSession::~ScrollSession()
 	scroller_.StopScrolling();
 }
 
-bool ScrollSession::Update(const std::vector<TouchDevice::Contact>& contacts)
+bool ScrollSession::Update(const ContactTracker& contacts)
 {
-	for(const auto& contact : contacts)
+	PROFILE_SCOPE(kSessionUpdate);
+	const ContactDelta* delta = contacts.Find(contactId_);
+	if(!delta || delta->type == ContactDelta::Type::kUp)
 	{
-		if(contact.id == contactId_)
-		{
-			if(!contact.isTouch)
-			{
-				return false;
-			}
-			if(scrollDirection_ == 0.0f)
-			{
-				StartScrolling(contact);
-			}
-			else
-			{
-				ContinueScrolling(contact);
-			}
-			return true;
-		}
+		return false;
+	}
+	// The last frame was evaluated at the same position.
+	if(delta->type == ContactDelta::Type::kUnchanged)
+	{
+		return true;
+	}
+	if(scrollDirection_ == 0.0f)
+	{
+		StartScrolling(*delta);
 	}
-	return false;
+	else
+	{
+		ContinueScrolling(*delta);
+	}
+	return true;
 }
 
-void ScrollSession::StartScrolling(const TouchDevice::Contact& contact)
+void ScrollSession::StartScrolling(const ContactDelta& delta)
 {
+	const Touchpad::Contact& contact = delta.contact;
 	const Vector<float> newPos = ScaleVector(Vector<LONG>(contact.logicalX, contact.logicalY));
 	const Vector<float> newDir = newPos - position_;
 	const float dot = newDir*direction_;
@@ -85,19 +91,20 @@ void ScrollSession::StartScrolling(const TouchDevice::Contact& contact)
 	{
 		scrollDirection_ = 1.0f;
 		scroller_.StartScrolling();
-		Scroll(newDir, newPos);
+		Scroll(newDir, newPos, delta);
 	}
 	else if(AngleBetween(direction_, -newDir) < settings_.startDeadzoneAngle/2 &&
 	        dot < -settings_.startDeadzone)
 	{
 		scrollDirection_ = -1.0f;
 		scroller_.StartScrolling();
-		Scroll(newDir, newPos);
+		Scroll(newDir, newPos, delta);
 	}
 }
 
-void ScrollSession::ContinueScrolling(const TouchDevice::Contact& contact)
+void ScrollSession::ContinueScrolling(const ContactDelta& delta)
 {
+	const Touchpad::Contact& contact = delta.contact;
 	const Vector<float> newPos = ScaleVector(Vector<LONG>(contact.logicalX, contact.logicalY));
 	const Vector<float> newDir = newPos - position_;
 
@@ -108,7 +115,7 @@ void ScrollSession::ContinueScrolling(const TouchDevice::Contact& contact)
 		if(newDir.Norm() > settings_.reverseDeadzone)
 		{
 			scrollDirection_ *= -1.0f;
-			Scroll(newDir, newPos);
+			Scroll(newDir, newPos, delta);
 		}
 	}
 	// To continue scrolling in the same direction the distance must be greater
@@ -117,20 +124,32 @@ void ScrollSession::ContinueScrolling(const TouchDevice::Contact& contact)
 	// any other direction.
 	else if(newDir.Norm() > settings_.reverseDeadzone || newDir*direction_ > settings_.moveDeadzone)
 	{
-		Scroll(newDir, newPos);
+		Scroll(newDir, newPos, delta);
 	}
 }
 
-void ScrollSession::Scroll(Vector<float> newDir, Vector<float> newPos)
+void ScrollSession::Scroll(Vector<float> newDir, Vector<float> newPos, const ContactDelta& delta)
 {
 	const double distance = newDir.Norm();
 	const LONG contactAreaHeight = contactInfo_.logicalArea.bottom - contactInfo_.logicalArea.top;
-	scroller_.Scroll(static_cast<int>(
+	// Measured over the last frame rather than since the last scroll, which
+	// for the first scroll would include the time spent in the deadzone.
+	const float speed = delta.velocity.Norm()/static_cast<float>(contactAreaHeight);
+	const int amount = static_cast<int>(
 		scrollDirection_
 		* distance
 		* sens_
+		* accelerationCurve_.Gain(speed)
 		* settings_.sensScalingFactor
-		* contactAreaHeight));
+		* contactAreaHeight);
+	if(amount != 0)
+	{
+		scroller_.Scroll(amount);
+	}
+	else
+	{
+		++GetPipelineStats().emptyScrolls;
+	}
 	position_ = newPos;
 	direction_ = newDir/static_cast<float>(distance);
 }
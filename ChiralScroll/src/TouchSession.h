@@ -3,9 +3,11 @@
 #include <vector>
 #include <Windows.h>
 
-#include "HidUtils.h"
+#include "AccelerationCurve.h"
+#include "ContactTracker.h"
 #include "Scroller.h"
 #include "Settings.h"
+#include "Touchpad.h"
 #include "Vector.h"
 
 namespace chiralscroll
@@ -14,65 +16,93 @@ namespace chiralscroll
 class TouchSession
 {
 public:
-	TouchSession(const TouchDevice& device) : device_(device) {}
+	TouchSession(const Touchpad& device) : device_(device) {}
 	virtual ~TouchSession() = default;
 
 	// Returns true if the touch session continues, false if it ends.
-	virtual bool Update(const std::vector<TouchDevice::Contact>& contacts) = 0;
+	virtual bool Update(const ContactTracker& contacts) = 0;
 
-	const TouchDevice& device() const
+	const Touchpad& device() const
 	{
 		return device_;
 	}
 
 private:
-	const TouchDevice& device_;
+	const Touchpad& device_;
 };
 
 class NonScrollSession : public TouchSession
 {
 public:
-	NonScrollSession(const TouchDevice& device) : TouchSession(device) {}
+	NonScrollSession(const Touchpad& device) : TouchSession(device) {}
 
-	bool Update(const std::vector<TouchDevice::Contact>& contacts) override;
+	bool Update(const ContactTracker& contacts) override;
 };
 
 class ScrollSession : public TouchSession
 {
 public:
 	ScrollSession(
-		const TouchDevice& device,
-		const TouchDevice::Contact& initialContact,
+		const Touchpad& device,
+		const Touchpad::Contact& initialContact,
 		Vector<float> initialDirection,
 		float sens,
+		const AccelerationCurve& accelerationCurve,
 		const Settings::GlobalSettings& settings,
 		Scroller& scroller);
 	~ScrollSession();
 
-	bool Update(const std::vector<TouchDevice::Contact>& contacts) override;
+	// Only looks at the contact that started the session.
+	bool Update(const ContactTracker& contacts) override;
+
+	ULONG contactId() const
+	{
+		return contactId_;
+	}
+
+	// True once the scroll direction has been determined.
+	bool scrolling() const
+	{
+		return scrollDirection_ != 0.0f;
+	}
+
+	// Unit vector of the last scroll movement.
+	Vector<float> direction() const
+	{
+		return direction_;
+	}
+
+	const Scroller& scroller() const
+	{
+		return scroller_;
+	}
 
 private:
 	// Handles update when scrolling has not yet started, direction has not yet
 	// been determined.
-	void StartScrolling(const TouchDevice::Contact& contact);
+	void StartScrolling(const ContactDelta& delta);
 
 	// Handles update after scrolling has started, direction has been
 	// determined.
-	void ContinueScrolling(const TouchDevice::Contact& contact);
+	void ContinueScrolling(const ContactDelta& delta);
 
-	// Performs a scroll action.
-	void Scroll(Vector<float> newDir, Vector<float> newPos);
+	// Performs a scroll action, accelerated by the contact's speed in the
+	// last frame.
+	void Scroll(Vector<float> newDir, Vector<float> newPos, const ContactDelta& delta);
 
 	// Scale a vector by the contact area height so that different resolutions
 	// will not affect sensitivity.
 	Vector<float> ScaleVector(Vector<LONG> vector) const;
 
 	ULONG contactId_;
-	TouchDevice::ContactInfo contactInfo_;
+	Touchpad::ContactInfo contactInfo_;
 	Vector<float> direction_;
 	Vector<float> position_;
 	float scrollDirection_;
 	float sens_;
+	// Copied, like the settings, since the settings can change during a
+	// session.
+	AccelerationCurve accelerationCurve_;
 	Settings::GlobalSettings settings_;
 	Scroller& scroller_;
 };
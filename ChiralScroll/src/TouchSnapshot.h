@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+namespace chiralscroll
+{
+
+// The latest frame as seen by the gesture code, for display. Positions are
+// fractions of the contact area, with (0, 0) at the top left. Fixed size so
+// that publishing one does not allocate.
+struct TouchSnapshot
+{
+	static constexpr size_t kMaxContacts = 10;
+
+	enum class Session { kNone, kVertical, kHorizontal };
+
+	struct Contact
+	{
+		float x;
+		float y;
+		// The contact driving the scroll session.
+		bool scrolling;
+	};
+
+	// Name of the device the frame came from. Points into the device, which
+	// outlives any snapshot of it.
+	std::string_view device;
+	size_t contactCount = 0;
+	std::array<Contact, kMaxContacts> contacts{};
+	Session session = Session::kNone;
+	// Unit vector of the current scroll direction, if the session has started
+	// scrolling.
+	float directionX = 0.0f;
+	float directionY = 0.0f;
+};
+
+}  // namespace chiralscroll
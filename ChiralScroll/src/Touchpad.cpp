@@ -0,0 +1,17 @@
+#include "Touchpad.h"
+
+#include <algorithm>
+
+namespace chiralscroll
+{
+
+const Touchpad::ContactInfo& Touchpad::GetContactInfo(ULONG link) const
+{
+	const std::vector<ContactInfo>& infos = contactInfo();
+	return *std::find_if(infos.begin(), infos.end(),
+		[link](const ContactInfo& info) {
+			return info.link == link;
+		});
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <Windows.h>
+
+namespace chiralscroll
+{
+
+// A touchpad as seen by the gesture code: its name and the layout of its
+// contacts. Implemented by TouchDevice for live input, and by recorded devices
+// when replaying a trace.
+class Touchpad
+{
+public:
+	struct ContactInfo
+	{
+		struct Area
+		{
+			LONG top;
+			LONG bottom;
+			LONG left;
+			LONG right;
+		};
+
+		USHORT link;
+		Area logicalArea;
+		Area physicalArea;
+	};
+
+	struct Contact
+	{
+		ULONG id;
+		ULONG contactInfoLink;
+		bool isTouch;
+		bool confidence;
+		ULONG logicalX;
+		ULONG logicalY;
+		LONG physicalX;
+		LONG physicalY;
+	};
+
+	virtual ~Touchpad() = default;
+
+	virtual std::string_view name() const = 0;
+	virtual const std::vector<ContactInfo>& contactInfo() const = 0;
+
+	const ContactInfo& GetContactInfo(ULONG link) const;
+};
+
+}  // namespace chiralscroll
@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include <wx/colour.h>
+#include <wx/dcbuffer.h>
 #include <wx/dcmemory.h>
 #include <wx/utils.h>
 
@@ -95,24 +96,25 @@ TouchpadCtrl::TouchpadCtrl(
 	: wxWindow(parent, id, pos, size, style, name),
 	  vGrabber_(*new Grabber(*this, Grabber::Direction::VERTICAL)),
 	  hGrabber_(*new Grabber(*this, Grabber::Direction::HORIZONTAL)),
-	  clippingRegion_(GetClippingRegion(GetClientSize())),
 	  vScrollZone_(0.0f),
 	  hScrollZone_(0.0f)
 {
-	Render();
+	// Everything is drawn in OnPaint, so skip erasing to avoid flicker.
+	SetBackgroundStyle(wxBG_STYLE_PAINT);
+	UpdateGrabberColours();
 };
 
 void TouchpadCtrl::SetVerticalZone(float vScrollZone)
 {
 	DoSetVerticalZone(vScrollZone);
-	Render();
+	Refresh(false);
 	StartVerticalEvent();
 }
 
 void TouchpadCtrl::SetHorizontalZone(float hScrollZone)
 {
 	DoSetHorizontalZone(hScrollZone);
-	Render();
+	Refresh(false);
 	StartHorizontalEvent();
 }
 
@@ -120,7 +122,7 @@ void TouchpadCtrl::SetValue(float vScrollZone, float hScrollZone)
 {
 	DoSetVerticalZone(vScrollZone);
 	DoSetHorizontalZone(hScrollZone);
-	Render();
+	Refresh(false);
 	StartVerticalEvent();
 	StartHorizontalEvent();
 }
@@ -140,6 +142,21 @@ std::pair<float, float> TouchpadCtrl::GetValue() const
 	return std::make_pair(vScrollZone_, hScrollZone_);
 }
 
+void TouchpadCtrl::SetOverlay(const TouchSnapshot& snapshot)
+{
+	overlay_ = snapshot;
+	Refresh(false);
+}
+
+void TouchpadCtrl::ClearOverlay()
+{
+	if(overlay_)
+	{
+		overlay_.reset();
+		Refresh(false);
+	}
+}
+
 void TouchpadCtrl::DoSetVerticalZone(float vScrollZone)
 {
 	vScrollZone_ = std::clamp(vScrollZone, 0.0f, 1.0f);;
@@ -176,7 +193,8 @@ void TouchpadCtrl::StartHorizontalEvent()
 
 bool TouchpadCtrl::Enable(bool enable) {
 	bool result = wxWindow::Enable(enable);
-	Render();
+	UpdateGrabberColours();
+	Refresh(false);
 	vGrabber_.Refresh();
 	hGrabber_.Refresh();
 	return result;
@@ -184,96 +202,131 @@ bool TouchpadCtrl::Enable(bool enable) {
 
 void TouchpadCtrl::OnResize(wxSizeEvent& event)
 {
-	clippingRegion_ = GetClippingRegion(event.GetSize());
+	background_ = wxNullBitmap;
+	Refresh(false);
+	event.Skip();
 }
 
 void TouchpadCtrl::OnPaint(wxPaintEvent& event)
 {
-	wxPaintDC dc{this};
-	Render(dc);
-}
-
-void TouchpadCtrl::Render()
-{
-	wxClientDC dc{this};
+	wxAutoBufferedPaintDC dc{this};
 	Render(dc);
 }
 
-void TouchpadCtrl::Render(wxClientDC& dc)
+void TouchpadCtrl::Render(wxDC& dc)
 {
 	const wxSize size = GetClientSize();
 	const int width = size.GetWidth();
 	const int height = size.GetHeight();
+	if(width <= 0 || height <= 0)
+	{
+		return;
+	}
 
-	wxBrush touchpadBrush = *wxGREY_BRUSH;
-	wxBrush vZoneBrush = *wxGREEN_BRUSH;
-	vZoneBrush.SetStyle(wxBRUSHSTYLE_FDIAGONAL_HATCH);
-	wxBrush hZoneBrush = *wxRED_BRUSH;
-	hZoneBrush.SetStyle(wxBRUSHSTYLE_BDIAGONAL_HATCH);
+	dc.DrawBitmap(GetBackground(), 0, 0);
+	if(!IsEnabled())
+	{
+		return;
+	}
 
-	// Draw the background.
-	dc.SetDeviceClippingRegion(clippingRegion_);
+	const int vScrollZone = GetVerticalZonePixels();
+	const int hScrollZone = GetHorizontalZonePixels();
 
-	dc.SetBrush(touchpadBrush);
-	dc.SetPen(wxNullPen);
-	dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
+	// Fill in the scroll zones by clipping the touchpad to each zone's
+	// rectangle, so the hatching follows the rounded corners. The outline is
+	// drawn again with each zone so that it is not hatched over.
+	dc.SetPen(*wxBLACK_PEN);
+	if(vScrollZone_ > 0)
+	{
+		wxBrush vZoneBrush(*wxGREEN, wxBRUSHSTYLE_FDIAGONAL_HATCH);
+		dc.SetBrush(vZoneBrush);
+		dc.SetClippingRegion(wxPoint{vScrollZone, 0}, wxSize{width - vScrollZone, height});
+		dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
+		dc.DestroyClippingRegion();
+	}
+	if(hScrollZone_ > 0)
+	{
+		wxBrush hZoneBrush(*wxRED, wxBRUSHSTYLE_BDIAGONAL_HATCH);
+		dc.SetBrush(hZoneBrush);
+		dc.SetClippingRegion(wxPoint{0, hScrollZone}, wxSize{vScrollZone, height - hScrollZone});
+		dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
+		dc.DestroyClippingRegion();
+	}
 
-	if(IsEnabled())
+	// Draw scroll zone outlines.
+	if(hScrollZone_ > 0)
 	{
-		vGrabber_.SetBackgroundColour(*wxBLACK);
-		hGrabber_.SetBackgroundColour(*wxBLACK);
+		dc.SetPen(*wxRED_PEN);
+		dc.DrawLine(wxPoint{0, hScrollZone}, wxPoint{vScrollZone, hScrollZone});
+	}
+	if(vScrollZone_ > 0)
+	{
+		dc.SetPen(*wxGREEN_PEN);
+		dc.DrawLine(wxPoint{vScrollZone, 0}, wxPoint{vScrollZone, height});
+	}
 
-		int vScrollZone = GetVerticalZonePixels();
-		int hScrollZone = GetHorizontalZonePixels();
+	RenderOverlay(dc);
+}
+
+void TouchpadCtrl::RenderOverlay(wxDC& dc)
+{
+	if(!overlay_)
+	{
+		return;
+	}
 
-		wxPoint vScrollTopLeft{vScrollZone, 0};
-		wxPoint vScrollBottomRight{width, height};
-		wxPoint vScrollBottomLeft{vScrollZone, height};
-		wxPoint hScrollTopLeft{0, hScrollZone};
-		wxPoint hScrollBottomRight{vScrollZone, height};
-		wxPoint hScrollTopRight{vScrollZone, hScrollZone};
+	const wxSize size = GetClientSize();
+	const wxColour sessionColour = overlay_->session == TouchSnapshot::Session::kVertical ? *wxGREEN : *wxRED;
+	for(size_t i = 0; i < overlay_->contactCount; ++i)
+	{
+		const TouchSnapshot::Contact& contact = overlay_->contacts[i];
+		const wxPoint center{
+			static_cast<int>(contact.x*static_cast<float>(size.GetWidth())),
+			static_cast<int>(contact.y*static_cast<float>(size.GetHeight()))};
 
-		// Draw scroll zone outlines.
-		if(hScrollZone_ > 0)
+		if(contact.scrolling)
 		{
-			dc.SetPen(*wxRED_PEN);
-			dc.DrawLine(hScrollTopLeft, hScrollTopRight);
+			dc.SetPen(wxPen(sessionColour, 2));
+			dc.SetBrush(wxBrush(sessionColour));
 		}
-		if(vScrollZone_ > 0)
+		else
 		{
-			dc.SetPen(*wxGREEN_PEN);
-			dc.DrawLine(vScrollTopLeft, vScrollBottomLeft);
+			dc.SetPen(wxPen(*wxBLUE, 2));
+			dc.SetBrush(*wxTRANSPARENT_BRUSH);
 		}
+		dc.DrawCircle(center, kContactRadius);
 
-		// Fill in scroll zones.
-		if(hScrollZone_ > 0)
-		{
-			dc.SetBrush(hZoneBrush);
-			dc.FloodFill((hScrollTopLeft + hScrollBottomRight)/2, touchpadBrush.GetColour());
-		}
-		if(vScrollZone_ > 0)
+		if(contact.scrolling && (overlay_->directionX != 0.0f || overlay_->directionY != 0.0f))
 		{
-			dc.SetBrush(vZoneBrush);
-			dc.FloodFill((vScrollTopLeft + vScrollBottomRight)/2, touchpadBrush.GetColour());
+			dc.DrawLine(center, center + wxPoint{
+				static_cast<int>(overlay_->directionX*kDirectionLength),
+				static_cast<int>(overlay_->directionY*kDirectionLength)});
 		}
 	}
-	else  // !IsEnabled()
+}
+
+const wxBitmap& TouchpadCtrl::GetBackground()
+{
+	const wxSize size = GetClientSize();
+	if(!background_.IsOk() || background_.GetSize() != size)
 	{
-		// Blend grabbers into background.
-		vGrabber_.SetBackgroundColour(touchpadBrush.GetColour());
-		hGrabber_.SetBackgroundColour(touchpadBrush.GetColour());
+		background_ = wxBitmap(size);
+		wxMemoryDC dc(background_);
+		dc.SetBackground(wxBrush(GetBackgroundColour()));
+		dc.Clear();
+		dc.SetBrush(*wxGREY_BRUSH);
+		dc.SetPen(*wxBLACK_PEN);
+		dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
 	}
+	return background_;
 }
 
-wxRegion TouchpadCtrl::GetClippingRegion(wxSize size)
+void TouchpadCtrl::UpdateGrabberColours()
 {
-	wxBitmap bitmap(size, 1);
-	wxMemoryDC dc;
-	dc.SelectObject(bitmap);
-	dc.SetPen(*wxWHITE_PEN);
-	dc.SetBrush(*wxWHITE_BRUSH);
-	dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
-	return wxRegion(bitmap, *wxBLACK);
+	// Blend the grabbers into the background when disabled.
+	const wxColour colour = IsEnabled() ? *wxBLACK : wxGREY_BRUSH->GetColour();
+	vGrabber_.SetBackgroundColour(colour);
+	hGrabber_.SetBackgroundColour(colour);
 }
 
 int TouchpadCtrl::GetVerticalZonePixels() const
@@ -1,12 +1,16 @@
 #pragma once
 
-#include <wx/dcclient.h>
+#include <optional>
+
+#include <wx/bitmap.h>
 #include <wx/cursor.h>
+#include <wx/dc.h>
 #include <wx/event.h>
 #include <wx/panel.h>
-#include <wx/region.h>
 #include <wx/window.h>
 
+#include "TouchSnapshot.h"
+
 namespace chiralscroll
 {
 
@@ -52,6 +56,15 @@ public:
 	float GetHorizontalZone() const;
 	std::pair<float, float> GetValue() const;
 
+	// Draws the contacts and scroll session from the given frame on top of the
+	// zones, until cleared.
+	void SetOverlay(const TouchSnapshot& snapshot);
+	void ClearOverlay();
+
+	// Draws the touchpad, the zones and the overlay as OnPaint does. The
+	// grabbers are child windows and draw themselves.
+	void Render(wxDC& dc);
+
 private:
 	friend class Grabber;
 
@@ -66,23 +79,29 @@ private:
 
 	void OnResize(wxSizeEvent& event);
 	void OnPaint(wxPaintEvent& event);
-	void Render();
-	void Render(wxClientDC& dc);
+	void RenderOverlay(wxDC& dc);
+
+	// Returns the touchpad outline on the window background, redrawing it only
+	// when the size has changed.
+	const wxBitmap& GetBackground();
 
-	wxRegion GetClippingRegion(wxSize size);
+	void UpdateGrabberColours();
 
 	int GetVerticalZonePixels() const;
 	int GetHorizontalZonePixels() const;
 
 	// This is tuned to match the width of the slider knobs.
 	static constexpr int kCornerSize = 13;
+	static constexpr int kContactRadius = 6;
+	static constexpr int kDirectionLength = 24;
 
 	Grabber& hGrabber_;
 	Grabber& vGrabber_;
 
-	wxRegion clippingRegion_;
+	wxBitmap background_;
 	float vScrollZone_;
 	float hScrollZone_;
+	std::optional<TouchSnapshot> overlay_;
 
 	wxDECLARE_EVENT_TABLE();
 };
@@ -0,0 +1,232 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <Windows.h>
+
+#include <absl/strings/str_cat.h>
+
+#include "ChiralScrollException.h"
+#include "StringUtils.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// File layout, all values in native byte order:
+//   magic
+//   uint32 device count
+//   per device: uint32 name length, name, uint32 contact info count, ContactInfo[]
+//   records until the end of the file:
+//     int64 time in microseconds, uint32 device, uint32 contact count,
+//     uint8 has scan time, uint32 scan time, uint32 contacts, Contact[]
+static constexpr char kMagic[8] = {'C', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+template<typename T>
+void WriteValue(std::ostream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void WriteArray(std::ostream& out, const std::vector<T>& values)
+{
+	WriteValue(out, static_cast<uint32_t>(values.size()));
+	out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size()*sizeof(T)));
+}
+
+// Reads values from a trace held in memory.
+class TraceReader
+{
+public:
+	TraceReader(const char* data, size_t size) : next_(data), end_(data + size) {}
+
+	bool AtEnd() const
+	{
+		return next_ == end_;
+	}
+
+	template<typename T>
+	bool ReadValue(T* value)
+	{
+		if(static_cast<size_t>(end_ - next_) < sizeof(T))
+		{
+			return false;
+		}
+		std::memcpy(value, next_, sizeof(T));
+		next_ += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	bool ReadArray(std::vector<T>* values)
+	{
+		uint32_t size;
+		if(!ReadValue(&size) || static_cast<size_t>(end_ - next_)/sizeof(T) < size)
+		{
+			return false;
+		}
+		values->resize(size);
+		std::memcpy(values->data(), next_, size*sizeof(T));
+		next_ += size*sizeof(T);
+		return true;
+	}
+
+private:
+	const char* next_;
+	const char* end_;
+};
+
+// A read-only view of a whole file.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path) : file_(INVALID_HANDLE_VALUE), mapping_(nullptr), view_(nullptr), size_(0)
+	{
+		// Traces are still being written while the application runs.
+		file_ = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		THROW_IF_FALSE(file_ != INVALID_HANDLE_VALUE, absl::StrCat("Could not open trace ", path.string()));
+		LARGE_INTEGER size;
+		THROW_IF_FALSE(GetFileSizeEx(file_, &size), absl::StrCat("Could not open trace ", path.string()));
+		size_ = static_cast<size_t>(size.QuadPart);
+		// An empty file cannot be mapped.
+		if(size_ == 0)
+		{
+			return;
+		}
+		mapping_ = CreateFileMapping(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		THROW_IF_FALSE(mapping_, absl::StrCat("Could not map trace ", path.string()));
+		view_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		THROW_IF_FALSE(view_, absl::StrCat("Could not map trace ", path.string()));
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		if(view_)
+		{
+			UnmapViewOfFile(view_);
+		}
+		if(mapping_)
+		{
+			CloseHandle(mapping_);
+		}
+		if(file_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_);
+		}
+	}
+
+	const char* data() const
+	{
+		return static_cast<const char*>(view_);
+	}
+
+	size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	HANDLE file_;
+	HANDLE mapping_;
+	void* view_;
+	size_t size_;
+};
+
+}  // namespace
+
+
+Trace Trace::FromFile(const std::filesystem::path& path)
+{
+	// Mapping the file avoids copying it through a stream buffer, which
+	// dominates loading time for large traces.
+	const MappedFile file(path);
+	return FromMemory(file.data(), file.size(), path.string());
+}
+
+Trace Trace::FromMemory(const char* data, size_t size, std::string_view source)
+{
+	TraceReader in(data, size);
+
+	char magic[sizeof(kMagic)];
+	THROW_IF_FALSE(in.ReadValue(&magic) && std::equal(magic, magic + sizeof(magic), kMagic),
+		absl::StrCat("Not a trace file: ", ToAbslView(source)));
+
+	Trace trace;
+	uint32_t deviceCount;
+	THROW_IF_FALSE(in.ReadValue(&deviceCount), absl::StrCat("Truncated trace header in ", ToAbslView(source)));
+	for(uint32_t i = 0; i < deviceCount; ++i)
+	{
+		std::vector<char> name;
+		std::vector<Touchpad::ContactInfo> contactInfo;
+		THROW_IF_FALSE(in.ReadArray(&name) && in.ReadArray(&contactInfo),
+			absl::StrCat("Truncated trace header in ", ToAbslView(source)));
+		trace.devices.emplace_back(std::string(name.begin(), name.end()), std::move(contactInfo));
+	}
+
+	while(!in.AtEnd())
+	{
+		int64_t timeUs;
+		Record record;
+		uint8_t hasScanTime;
+		ULONG scanTime;
+		// A record cut short by a crash is ignored.
+		if(!in.ReadValue(&timeUs) ||
+		   !in.ReadValue(&record.device) ||
+		   !in.ReadValue(&record.report.contactCount) ||
+		   !in.ReadValue(&hasScanTime) ||
+		   !in.ReadValue(&scanTime) ||
+		   !in.ReadArray(&record.report.contacts))
+		{
+			break;
+		}
+		THROW_IF_FALSE(record.device < trace.devices.size(),
+			absl::StrCat("Invalid device index in ", ToAbslView(source)));
+		record.time = absl::Microseconds(timeUs);
+		if(hasScanTime)
+		{
+			record.report.scanTime = scanTime;
+		}
+		trace.records.push_back(std::move(record));
+	}
+	return trace;
+}
+
+
+TraceWriter::TraceWriter(const std::filesystem::path& path, const std::vector<const Touchpad*>& devices, const Clock& clock)
+	: file_(path, std::ios::binary | std::ios::trunc),
+	  start_(clock.Now())
+{
+	THROW_IF_FALSE(file_.is_open(), absl::StrCat("Could not create trace ", path.string()));
+	file_.write(kMagic, sizeof(kMagic));
+	WriteValue(file_, static_cast<uint32_t>(devices.size()));
+	for(const Touchpad* device : devices)
+	{
+		deviceIndex_[device] = static_cast<uint32_t>(deviceIndex_.size());
+		WriteArray(file_, std::vector<char>(device->name().begin(), device->name().end()));
+		WriteArray(file_, device->contactInfo());
+	}
+}
+
+void TraceWriter::Write(const Touchpad& device, const TouchDevice::FrameBuilder::Report& report, absl::Time time)
+{
+	const auto it = deviceIndex_.find(&device);
+	if(it == deviceIndex_.end())
+	{
+		return;
+	}
+	WriteValue(file_, absl::ToInt64Microseconds(time - start_));
+	WriteValue(file_, it->second);
+	WriteValue(file_, report.contactCount);
+	WriteValue(file_, static_cast<uint8_t>(report.scanTime.has_value()));
+	WriteValue(file_, report.scanTime.value_or(0));
+	WriteArray(file_, report.contacts);
+}
+
+}  // namespace chiralscroll
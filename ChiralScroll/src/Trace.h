@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/time/time.h>
+
+#include "Clock.h"
+#include "HidUtils.h"
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+// A touchpad loaded from a trace.
+class RecordedTouchpad : public Touchpad
+{
+public:
+	RecordedTouchpad(std::string name, std::vector<ContactInfo> contactInfo)
+		: name_(std::move(name)),
+		  contactInfo_(std::move(contactInfo)) {}
+
+	std::string_view name() const override
+	{
+		return name_;
+	}
+
+	const std::vector<ContactInfo>& contactInfo() const override
+	{
+		return contactInfo_;
+	}
+
+private:
+	std::string name_;
+	std::vector<ContactInfo> contactInfo_;
+};
+
+// A recording of the decoded reports from every touchpad, which can be
+// replayed through the frame builder and gesture code.
+struct Trace
+{
+	struct Record
+	{
+		// Time since the start of the trace.
+		absl::Duration time;
+		// Index into devices.
+		uint32_t device;
+		TouchDevice::FrameBuilder::Report report;
+	};
+
+	// Throws an exception if the file cannot be read.
+	static Trace FromFile(const std::filesystem::path& path);
+	// Parses a trace that is already in memory. The source is only used in
+	// error messages.
+	static Trace FromMemory(const char* data, size_t size, std::string_view source);
+
+	std::vector<RecordedTouchpad> devices;
+	std::vector<Record> records;
+};
+
+// Writes a trace while the application runs. Record times must come from the
+// given clock.
+class TraceWriter
+{
+public:
+	TraceWriter(const std::filesystem::path& path, const std::vector<const Touchpad*>& devices, const Clock& clock);
+
+	void Write(const Touchpad& device, const TouchDevice::FrameBuilder::Report& report, absl::Time time);
+
+private:
+	std::ofstream file_;
+	absl::flat_hash_map<const Touchpad*, uint32_t> deviceIndex_;
+	absl::Time start_;
+};
+
+}  // namespace chiralscroll
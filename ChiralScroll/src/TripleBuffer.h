@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace chiralscroll
+{
+
+// Passes the latest value from one writer thread to one reader thread without
+// locks. The writer fills the back slot and publishes it by swapping it with
+// the middle slot; the reader takes the middle slot when it has been
+// published since the last read. Neither side ever waits for the other, and
+// values published faster than the reader takes them are skipped.
+template<typename T>
+class TripleBuffer
+{
+public:
+	// The slot the writer may fill. Only the writer may call this.
+	T& back()
+	{
+		return slots_[back_];
+	}
+
+	// Makes the back slot the latest value. Only the writer may call this.
+	void Publish()
+	{
+		const uint8_t previous = middle_.exchange(static_cast<uint8_t>(back_ | kFresh), std::memory_order_acq_rel);
+		back_ = previous & kIndexMask;
+	}
+
+	// Takes the latest value if one was published since the last call.
+	// Returns false if front() is unchanged. Only the reader may call this.
+	bool Update()
+	{
+		if(!(middle_.load(std::memory_order_relaxed) & kFresh))
+		{
+			return false;
+		}
+		const uint8_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+		front_ = previous & kIndexMask;
+		return true;
+	}
+
+	// The value taken by the last call to Update. Only the reader may call
+	// this.
+	const T& front() const
+	{
+		return slots_[front_];
+	}
+
+private:
+	static constexpr uint8_t kIndexMask = 0x3;
+	static constexpr uint8_t kFresh = 0x4;
+
+	std::array<T, 3> slots_{};
+	uint8_t back_ = 0;
+	std::atomic<uint8_t> middle_{1};
+	uint8_t front_ = 2;
+};
+
+}  // namespace chiralscroll
@@ -69,7 +69,7 @@ public:
 	template<typename U>
 	friend constexpr Vector<Result<U>> operator*(U lhs, Vector rhs)
 	{
-		return Vector<Result<U>>(lhs*rhs.x_, lhs*rhs.x_);
+		return Vector<Result<U>>(lhs*rhs.x_, lhs*rhs.y_);
 	}
 	template<typename U>
 	friend constexpr Vector<Result<U>> operator/(Vector lhs, U rhs)
@@ -1,8 +1,13 @@
 #include "WinScroller.h"
 
+#include <algorithm>
+#include <climits>
+
 #include <spdlog/spdlog.h>
 
 #include "ChiralScrollException.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
 
 namespace chiralscroll
 {
@@ -30,6 +35,10 @@ void WinScroller::StartScrolling()
 
 void WinScroller::Scroll(int amt)
 {
+	PROFILE_SCOPE(kScroll);
+	PipelineStats& stats = GetPipelineStats();
+	ScopedTimer timer(stats.injection);
+	++stats.scrollEvents;
 	INPUT input{};
 
 	input.type = INPUT_MOUSE;
@@ -56,4 +65,27 @@ void WinScroller::StopScrolling()
 	}
 }
 
+void MessageScroller::Scroll(int amt)
+{
+	POINT cursor;
+	if(!GetCursorPos(&cursor))
+	{
+		return;
+	}
+	const HWND target = WindowFromPoint(cursor);
+	if(!target)
+	{
+		return;
+	}
+	// The wheel delta is a signed 16 bit value in the high word.
+	const SHORT delta = static_cast<SHORT>(std::clamp<int>(amt, SHRT_MIN, SHRT_MAX));
+	PostMessage(
+		target,
+		dir_ == WinScroller::Direction::kVertical ? WM_MOUSEWHEEL : WM_MOUSEHWHEEL,
+		MAKEWPARAM(0, static_cast<WORD>(delta)),
+		MAKELPARAM(static_cast<WORD>(cursor.x), static_cast<WORD>(cursor.y)));
+	SPDLOG_DEBUG("Posted scroll by {} {}.",
+		amt, dir_ == WinScroller::Direction::kVertical ? "vertical" : "horizontal");
+}
+
 }  // namespace chiralscroll
@@ -24,4 +24,21 @@ private:
 	HHOOK hookHandle_;
 };
 
+// Posts wheel messages straight to the window under the cursor, bypassing the
+// input queue. Never blocks, so it can stand in for WinScroller while
+// SendInput is stalled, but applications that read the wheel from raw input
+// do not see it.
+class MessageScroller : public Scroller
+{
+public:
+	explicit MessageScroller(WinScroller::Direction dir) : dir_(dir) {}
+
+	void StartScrolling() override {}
+	void Scroll(int amt) override;
+	void StopScrolling() override {}
+
+private:
+	const WinScroller::Direction dir_;
+};
+
 }  // namespace chiralscroll
@@ -0,0 +1,150 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace chiralscroll
+{
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+	: nextQueue_(0),
+	  queued_(0),
+	  pending_(0),
+	  stopping_(false)
+{
+	if(threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for(size_t i = 0; i < threadCount; ++i)
+	{
+		queues_.push_back(std::make_unique<Queue>());
+	}
+	for(size_t i = 0; i < threadCount; ++i)
+	{
+		threads_.emplace_back(&WorkStealingPool::Run, this, i);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for(auto& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void WorkStealingPool::Submit(std::function<void()> task)
+{
+	++pending_;
+	Queue& queue = *queues_[nextQueue_++ % queues_.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+		++queued_;
+	}
+	// Taking the lock orders the notification after a worker that found no
+	// task has started waiting, so that it cannot be missed.
+	std::lock_guard<std::mutex> lock(mutex_);
+	wake_.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return pending_ == 0; });
+	if(exception_)
+	{
+		std::exception_ptr exception = std::exchange(exception_, nullptr);
+		std::rethrow_exception(exception);
+	}
+}
+
+void WorkStealingPool::Run(size_t index)
+{
+	while(true)
+	{
+		std::function<void()> task = Pop(index);
+		if(!task)
+		{
+			// If a task was pushed to a queue after Pop looked at it, queued_
+			// is already above zero and Pop looks again.
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+			if(queued_ == 0)
+			{
+				return;
+			}
+			continue;
+		}
+
+		std::exception_ptr exception;
+		try
+		{
+			task();
+		}
+		catch(...)
+		{
+			exception = std::current_exception();
+		}
+		Finish(exception);
+	}
+}
+
+std::function<void()> WorkStealingPool::Pop(size_t index)
+{
+	std::function<void()> task;
+	// Own queue first, newest task first, since it is most likely to be warm
+	// in the cache.
+	{
+		Queue& queue = *queues_[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			--queued_;
+			return task;
+		}
+	}
+	// Then steal the oldest task from another worker.
+	for(size_t i = 1; i < queues_.size(); ++i)
+	{
+		Queue& queue = *queues_[(index + i) % queues_.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			--queued_;
+			return task;
+		}
+	}
+	return task;
+}
+
+void WorkStealingPool::Finish(std::exception_ptr exception)
+{
+	if(exception)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(!exception_)
+		{
+			exception_ = exception;
+		}
+	}
+	if(--pending_ == 0)
+	{
+		// Taking the lock orders the notification after Wait checks
+		// pending_, so that it cannot be missed.
+		std::lock_guard<std::mutex> lock(mutex_);
+		done_.notify_all();
+	}
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chiralscroll
+{
+
+// A fixed-size thread pool in which every worker has its own task queue with
+// its own lock. A worker takes tasks from the back of its own queue, and
+// steals from the front of the other queues when its own is empty, so workers
+// only contend on a queue when one of them runs dry. A worker that finds
+// every queue empty sleeps on a separate mutex until a task is submitted.
+class WorkStealingPool
+{
+public:
+	// Uses one thread per core if threadCount is 0.
+	explicit WorkStealingPool(size_t threadCount = 0);
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	void Submit(std::function<void()> task);
+
+	// Blocks until every submitted task has finished. Rethrows the first
+	// exception thrown by a task.
+	void Wait();
+
+	size_t threadCount() const
+	{
+		return threads_.size();
+	}
+
+private:
+	// Aligned to its own cache line, so that workers taking tasks from their
+	// own queues do not share one.
+	struct alignas(64) Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void Run(size_t index);
+	// Takes a task from the given worker's queue, or steals one from another.
+	// Returns an empty function if every queue is empty.
+	std::function<void()> Pop(size_t index);
+	void Finish(std::exception_ptr exception);
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::atomic<size_t> nextQueue_;
+
+	// Guards sleeping and waking the workers, stopping_ and exception_.
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	// Tasks in the queues. Changed under a queue's lock together with the
+	// push or pop, so it is only above zero while a task can be taken.
+	std::atomic<size_t> queued_;
+	// Tasks submitted but not yet finished.
+	std::atomic<size_t> pending_;
+	bool stopping_;
+	std::exception_ptr exception_;
+
+	std::vector<std::thread> threads_;
+};
+
+}  // namespace chiralscroll
@@ -0,0 +1,551 @@
+// Headless ChiralScroll.
+//
+// Reads the touchpads and scrolls exactly like ChiralScroll.exe, but without
+// wxWidgets, so that what stays resident is only the input path: a
+// message-only window for raw input, a timer for frame deadlines and a bare
+// notification icon. The settings dialog runs in a separate process,
+// ChiralScroll.exe --ui, started from the icon when needed, which asks the
+// daemon to reload the settings over DaemonPipe when they are saved.
+//
+// The time from process creation to the first input and the resident working
+// set are logged at startup and returned by the status request, along with
+// the time taken by each phase of startup. Raw input is registered before the
+// notification icon is added, which waits for the message loop.
+//
+// With --realtime, the process runs at high priority with the input and
+// injection threads at --realtimePriority, optionally pinned to CPUs, and its
+// working set is kept resident. The daemon then warns about any page faults
+// once it is running, since the steady state should have none.
+//
+// Usage: ChiralScrollDaemon [flags]
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <Windows.h>
+
+// Must come after Windows.h
+#include <shellapi.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_cat.h>
+#include <spdlog/spdlog.h>
+
+#include "ChiralScroll.h"
+#include "ChiralScrollException.h"
+#include "Clock.h"
+#include "DaemonPipe.h"
+#include "EntryPoint.h"
+#include "FlightRecorder.h"
+#include "FrameMailbox.h"
+#include "HidUtils.h"
+#include "InjectionWatchdog.h"
+#include "InputPipeline.h"
+#include "Logging.h"
+#include "PipelineStats.h"
+#include "ProcessInfo.h"
+#include "Profiler.h"
+#include "Realtime.h"
+#include "resource.h"
+#include "Settings.h"
+#include "StartupTrace.h"
+#include "StatsSegment.h"
+#include "StringUtils.h"
+#include "WinScroller.h"
+
+ABSL_FLAG(bool, logToConsole, false, "Log to console.");
+ABSL_FLAG(std::string, logLevel, "warn", "Logging level: trace, debug, info, warn, err, critical, or off.");
+ABSL_FLAG(bool, panicOnUnexpectedInput, false, "Panic and crash when unexpected inputs are received.");
+#ifdef CHIRALSCROLL_PROFILE
+ABSL_FLAG(bool, dumpProfileOnExit, false, "Write hot path timings to profile.txt on exit.");
+#endif
+ABSL_FLAG(std::string, recordTrace, "", "Record all touchpad reports to the given file, for replay by the tuner.");
+ABSL_FLAG(bool, noTrayIcon, false, "Run without a notification icon, controlled only through the pipe.");
+ABSL_FLAG(bool, inOrderFrames, false, "Handle every frame when input backs up, instead of skipping to the newest position.");
+ABSL_FLAG(bool, publishFrames, false, "Publish the touchpad contacts in shared memory, for other tools to read.");
+ABSL_FLAG(bool, realtime, false, "Keep the input path resident in memory and run it at high priority, for loaded machines.");
+ABSL_FLAG(int, realtimePriority, THREAD_PRIORITY_TIME_CRITICAL,
+	"Priority of the input and injection threads with --realtime: -2 to 2, or 15 for time critical.");
+ABSL_FLAG(int, inputCpu, -1, "With --realtime, run the input thread only on this CPU.");
+ABSL_FLAG(int, injectionCpu, -1, "With --realtime, run the injection thread only on this CPU.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr wchar_t kWindowClass[] = L"ChiralScrollDaemon";
+static constexpr wchar_t kTitle[] = L"ChiralScroll";
+static constexpr wchar_t kSettingsProcess[] = L"ChiralScroll.exe";
+
+static constexpr UINT kTrayMessage = WM_APP;
+// Posted once raw input is registered. wParam is whether to add the icon.
+static constexpr UINT kFinishStartupMessage = WM_APP + 1;
+static constexpr UINT_PTR kFrameTimer = 1;
+static constexpr UINT_PTR kPageFaultTimer = 2;
+
+// How often real-time mode checks that the steady state does not page fault.
+static constexpr UINT kPageFaultCheckMs = 10000;
+// Room for the working set to grow in real-time mode before pages can be
+// trimmed again.
+static constexpr size_t kRealtimeHeadroomBytes = 16*1024*1024;
+
+enum MenuItem : UINT_PTR
+{
+	kMenuEnable = 1,
+	kMenuSettings,
+	kMenuDumpFlightRecord,
+	kMenuClose,
+};
+
+std::filesystem::path GetExecutableDirectory()
+{
+	std::wstring path(MAX_PATH, '\0');
+	const DWORD size = GetModuleFileName(nullptr, path.data(), static_cast<DWORD>(path.size()));
+	path.resize(size);
+	return std::filesystem::path(path).parent_path();
+}
+
+class Daemon
+{
+public:
+	Daemon(
+		Settings settings,
+		std::filesystem::path settingsPath,
+		absl::flat_hash_map<HANDLE, TouchDevice> touchDevices,
+		InjectionWatchdog& injectionWatchdog,
+		const Clock& clock,
+		FrameMailbox::Policy framePolicy,
+		const std::optional<std::filesystem::path>& tracePath,
+		bool trayIcon)
+		: hWnd_(CreateMessageWindow(this)),
+		  settings_(std::move(settings)),
+		  settingsPath_(std::move(settingsPath)),
+		  clock_(clock),
+		  pipeline_(
+			  std::move(touchDevices),
+			  ChiralScroll(
+				  settings_,
+				  WatchScroller(injectionWatchdog, WinScroller::Direction::kVertical),
+				  WatchScroller(injectionWatchdog, WinScroller::Direction::kHorizontal),
+				  clock_),
+			  clock_,
+			  framePolicy,
+			  tracePath),
+		  pipe_([this](std::string_view request) { return HandleRequest(request); }),
+		  icon_{}
+	{
+		InputPipeline::RegisterRawInput(hWnd_);
+		GetStartupTrace().EndPhase("input");
+		PostMessage(hWnd_, kFinishStartupMessage, trayIcon, 0);
+	}
+
+	~Daemon()
+	{
+		if(icon_.cbSize)
+		{
+			Shell_NotifyIcon(NIM_DELETE, &icon_);
+		}
+		DestroyWindow(hWnd_);
+	}
+
+	Daemon(const Daemon&) = delete;
+	Daemon& operator=(const Daemon&) = delete;
+
+	// Runs until asked to exit. Window messages and pipe requests are served
+	// from the same thread as the input.
+	void Run()
+	{
+		const HANDLE pipeEvent = pipe_.event();
+		while(true)
+		{
+			if(MsgWaitForMultipleObjects(1, &pipeEvent, false, INFINITE, QS_ALLINPUT) == WAIT_OBJECT_0)
+			{
+				pipe_.Serve();
+			}
+			MSG msg;
+			while(PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+			{
+				if(msg.message == WM_QUIT)
+				{
+					return;
+				}
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		}
+	}
+
+	// Warns whenever the process page faulted since the last check, which in
+	// real-time mode should never happen once it is running.
+	void WatchPageFaults()
+	{
+		pageFaults_.emplace();
+		SetTimer(hWnd_, kPageFaultTimer, kPageFaultCheckMs, nullptr);
+	}
+
+	void PublishFrames()
+	{
+		pipeline_.PublishFrames();
+	}
+
+	// Keeps the noise measured this run for the next one.
+	void SaveNoiseEstimates()
+	{
+		pipeline_.chiralScroll().StoreNoiseEstimates(settings_);
+		try
+		{
+			settings_.ToFile(settingsPath_);
+		}
+		catch(const std::exception& e)
+		{
+			SPDLOG_WARN("Could not save the noise estimates: {}", e.what());
+		}
+	}
+
+private:
+	static HWND CreateMessageWindow(Daemon* daemon)
+	{
+		WNDCLASSEX windowClass{};
+		windowClass.cbSize = sizeof(windowClass);
+		windowClass.lpfnWndProc = &Daemon::WindowProc;
+		windowClass.hInstance = GetModuleHandle(nullptr);
+		windowClass.lpszClassName = kWindowClass;
+		THROW_IF_FALSE(RegisterClassEx(&windowClass) != 0,
+			absl::StrCat("RegisterClassEx failed: ", GetErrorMessage(GetLastError())));
+		const HWND hWnd = CreateWindowEx(
+			0, kWindowClass, kTitle, 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, windowClass.hInstance, daemon);
+		THROW_IF_FALSE(hWnd != nullptr,
+			absl::StrCat("CreateWindowEx failed: ", GetErrorMessage(GetLastError())));
+		return hWnd;
+	}
+
+	static LRESULT CALLBACK WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+	{
+		if(message == WM_NCCREATE)
+		{
+			const CREATESTRUCT* create = reinterpret_cast<const CREATESTRUCT*>(lParam);
+			SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+		}
+		Daemon* daemon = reinterpret_cast<Daemon*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+		if(daemon && hWnd == daemon->hWnd_)
+		{
+			return daemon->HandleMessage(message, wParam, lParam);
+		}
+		return DefWindowProc(hWnd, message, wParam, lParam);
+	}
+
+	LRESULT HandleMessage(UINT message, WPARAM wParam, LPARAM lParam)
+	{
+		switch(message)
+		{
+		case WM_INPUT:
+			if(pipeline_.HandleRawInput(reinterpret_cast<HRAWINPUT>(lParam)))
+			{
+				ScheduleFrameTimer();
+			}
+			break;
+		case WM_TIMER:
+			if(wParam == kFrameTimer)
+			{
+				pipeline_.ExpireFrames();
+				ScheduleFrameTimer();
+			}
+			else if(wParam == kPageFaultTimer)
+			{
+				CheckPageFaults();
+			}
+			return 0;
+		case kFinishStartupMessage:
+			if(wParam)
+			{
+				AddTrayIcon();
+				GetStartupTrace().EndPhase("tray icon");
+			}
+			SPDLOG_INFO("Startup: {}.", GetStartupTrace().Summary());
+			return 0;
+		case kTrayMessage:
+			if(LOWORD(lParam) == WM_LBUTTONUP || LOWORD(lParam) == WM_RBUTTONUP)
+			{
+				ShowMenu();
+			}
+			return 0;
+		}
+		return DefWindowProc(hWnd_, message, wParam, lParam);
+	}
+
+	// Wakes up when the earliest incomplete frame expires, so that a frame
+	// whose last report was lost still gets delivered.
+	void ScheduleFrameTimer()
+	{
+		const std::optional<int> delayMs = FrameTimerDelayMs(pipeline_, clock_);
+		if(!delayMs)
+		{
+			KillTimer(hWnd_, kFrameTimer);
+			return;
+		}
+		// SetTimer raises shorter delays to USER_TIMER_MINIMUM.
+		SetTimer(hWnd_, kFrameTimer, static_cast<UINT>(*delayMs), nullptr);
+	}
+
+	void CheckPageFaults()
+	{
+		const uint64_t faults = pageFaults_->Check();
+		if(faults > 0)
+		{
+			SPDLOG_WARN("{} page faults in the last {}s in real-time mode.", faults, kPageFaultCheckMs / 1000);
+		}
+	}
+
+	std::string HandleRequest(std::string_view request)
+	{
+		if(request == DaemonPipe::kReload)
+		{
+			Settings settings = Settings::FromFile(settingsPath_, GetDeviceNames(pipeline_.touchDevices()));
+			pipeline_.chiralScroll().StoreNoiseEstimates(settings);
+			settings_ = std::move(settings);
+			pipeline_.chiralScroll().SetSettings(settings_);
+			SPDLOG_INFO("Reloaded settings from {}.", settingsPath_.string());
+			return "ok";
+		}
+		if(request == DaemonPipe::kEnable || request == DaemonPipe::kDisable)
+		{
+			SetEnabled(request == DaemonPipe::kEnable);
+			return "ok";
+		}
+		if(request == DaemonPipe::kStatus)
+		{
+			return absl::StrCat(
+				settings_.GetGlobalSettings().enabled ? "enabled" : "disabled",
+				", ", pipeline_.touchDevices().size(), " touchpads, ",
+				ResourceSummary(), "; startup: ", GetStartupTrace().Summary(),
+				pageFaults_ ? absl::StrCat("; ", pageFaults_->total(), " page faults in real-time mode") : "");
+		}
+		if(request == DaemonPipe::kDump)
+		{
+			const std::optional<std::filesystem::path> path = GetFlightRecorder().Dump("requested over the pipe");
+			return path ? path->string() : "error: could not write the flight record";
+		}
+		if(request == DaemonPipe::kExit)
+		{
+			PostQuitMessage(0);
+			return "ok";
+		}
+		return absl::StrCat("error: unknown request \"", ToAbslView(request), "\"");
+	}
+
+	void SetEnabled(bool enabled)
+	{
+		settings_.GetGlobalSettings().enabled = enabled;
+		pipeline_.chiralScroll().SetSettings(settings_);
+	}
+
+	void AddTrayIcon()
+	{
+		icon_.cbSize = sizeof(icon_);
+		icon_.hWnd = hWnd_;
+		icon_.uID = 1;
+		icon_.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP;
+		icon_.uCallbackMessage = kTrayMessage;
+		icon_.hIcon = LoadIcon(GetModuleHandle(nullptr), MAKEINTRESOURCE(IDI_CHIRALSCROLL));
+		wcscpy_s(icon_.szTip, kTitle);
+		if(!Shell_NotifyIcon(NIM_ADD, &icon_))
+		{
+			SPDLOG_WARN("Could not add the notification icon.");
+			icon_.cbSize = 0;
+		}
+	}
+
+	void ShowMenu()
+	{
+		const HMENU menu = CreatePopupMenu();
+		AppendMenu(menu, MF_STRING | (settings_.GetGlobalSettings().enabled ? MF_CHECKED : MF_UNCHECKED), kMenuEnable, L"Enable");
+		AppendMenu(menu, MF_STRING, kMenuSettings, L"Settings");
+		AppendMenu(menu, MF_STRING, kMenuDumpFlightRecord, L"Dump flight record");
+		AppendMenu(menu, MF_SEPARATOR, 0, nullptr);
+		AppendMenu(menu, MF_STRING, kMenuClose, L"Close");
+
+		POINT cursor;
+		GetCursorPos(&cursor);
+		// Without this the menu does not close when clicking elsewhere.
+		SetForegroundWindow(hWnd_);
+		const UINT_PTR item = TrackPopupMenu(
+			menu, TPM_RETURNCMD | TPM_NONOTIFY | TPM_RIGHTBUTTON, cursor.x, cursor.y, 0, hWnd_, nullptr);
+		DestroyMenu(menu);
+
+		switch(item)
+		{
+		case kMenuEnable:
+			SetEnabled(!settings_.GetGlobalSettings().enabled);
+			break;
+		case kMenuSettings:
+			LaunchSettings();
+			break;
+		case kMenuDumpFlightRecord:
+			GetFlightRecorder().RequestDump("requested from the tray menu");
+			break;
+		case kMenuClose:
+			PostQuitMessage(0);
+			break;
+		}
+	}
+
+	// Starts the settings UI next to this executable. It exits when its dialog
+	// is closed, so nothing of it stays resident.
+	void LaunchSettings()
+	{
+		const std::filesystem::path exe = GetExecutableDirectory() / kSettingsProcess;
+		std::wstring commandLine = L"\"" + exe.wstring() + L"\" --ui";
+		STARTUPINFO startupInfo{};
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo{};
+		if(!CreateProcess(
+			exe.c_str(), commandLine.data(), nullptr, nullptr, false, 0, nullptr, nullptr, &startupInfo, &processInfo))
+		{
+			SPDLOG_ERROR("Could not start {}: {}", exe.string(), GetErrorMessage(GetLastError()));
+			return;
+		}
+		CloseHandle(processInfo.hThread);
+		CloseHandle(processInfo.hProcess);
+	}
+
+	const HWND hWnd_;
+	Settings settings_;
+	std::filesystem::path settingsPath_;
+	const Clock& clock_;
+	InputPipeline pipeline_;
+	DaemonPipe pipe_;
+	NOTIFYICONDATA icon_;
+	// Only in real-time mode.
+	std::optional<PageFaultMonitor> pageFaults_;
+};
+
+int Run()
+{
+	StartupTrace& startupTrace = GetStartupTrace();
+	absl::flat_hash_map<HANDLE, TouchDevice> devices = GetTouchDevices(absl::GetFlag(FLAGS_panicOnUnexpectedInput));
+	startupTrace.EndPhase("devices");
+	// Must outlive everything that records statistics.
+	std::optional<StatsSegment> statsSegment = PublishStats(devices);
+	startupTrace.EndPhase("stats");
+
+	const std::filesystem::path settingsPath = GetCurrentDirectory() / "settings.ini";
+	Settings settings = Settings::FromFile(settingsPath, GetDeviceNames(devices));
+	startupTrace.EndPhase("settings");
+
+	std::optional<std::filesystem::path> tracePath;
+	if(!absl::GetFlag(FLAGS_recordTrace).empty())
+	{
+		tracePath = std::filesystem::path(absl::GetFlag(FLAGS_recordTrace));
+	}
+
+	// Every interval in the pipeline is measured with this clock.
+	MonotonicClock clock;
+	// Owns the scroll sinks, so must outlive the daemon.
+	InjectionWatchdog injectionWatchdog(clock);
+	Daemon daemon(
+		std::move(settings),
+		settingsPath,
+		std::move(devices),
+		injectionWatchdog,
+		clock,
+		absl::GetFlag(FLAGS_inOrderFrames) ? FrameMailbox::Policy::kInOrder : FrameMailbox::Policy::kLatestWins,
+		tracePath,
+		!absl::GetFlag(FLAGS_noTrayIcon));
+	if(absl::GetFlag(FLAGS_publishFrames))
+	{
+		daemon.PublishFrames();
+	}
+	if(absl::GetFlag(FLAGS_realtime))
+	{
+		// Everything on the input path exists by now, so what is resident is
+		// what it needs.
+		const int priority = absl::GetFlag(FLAGS_realtimePriority);
+		EnterRealtimeMode(kRealtimeHeadroomBytes);
+		SetRealtimeThread(GetCurrentThread(), priority, absl::GetFlag(FLAGS_inputCpu));
+		SetRealtimeThread(injectionWatchdog.worker(), priority, absl::GetFlag(FLAGS_injectionCpu));
+		daemon.WatchPageFaults();
+		startupTrace.EndPhase("real-time mode");
+	}
+	SPDLOG_INFO("Ready: {}.", ResourceSummary());
+
+	try
+	{
+		daemon.Run();
+	}
+	catch(const std::exception& e)
+	{
+		++GetPipelineStats().exceptions;
+		GetFlightRecorder().Dump(absl::StrCat("unhandled exception: ", e.what()));
+		throw;
+	}
+	daemon.SaveNoiseEstimates();
+#ifdef CHIRALSCROLL_PROFILE
+	if(absl::GetFlag(FLAGS_dumpProfileOnExit))
+	{
+		WriteProfile();
+	}
+#endif
+	return 0;
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR commandLine, int showCommand)
+{
+	chiralscroll::GetStartupTrace().EndPhase("load");
+	absl::SetProgramUsageMessage("Headless ChiralScroll, with the settings in ChiralScroll.exe --ui.\n"
+		"Usage: ChiralScrollDaemon [flags]");
+	absl::ParseCommandLine(__argc, __argv);
+
+	const std::optional<spdlog::level::level_enum> level = chiralscroll::ParseLogLevel(absl::GetFlag(FLAGS_logLevel));
+	if(!level)
+	{
+		return 1;
+	}
+	spdlog::set_level(*level);
+
+	const bool logToConsole = absl::GetFlag(FLAGS_logToConsole);
+	if(logToConsole)
+	{
+		AllocConsole();
+	}
+	chiralscroll::InitLogging(chiralscroll::GetCurrentDirectory() / "chiralscroll.log", logToConsole);
+	chiralscroll::GetStartupTrace().EndPhase("logging");
+
+	int result = 1;
+	try
+	{
+		result = chiralscroll::Run();
+	}
+	catch(const std::exception& e)
+	{
+		const std::string message = absl::StrCat("Caught exception: ", e.what());
+		SPDLOG_ERROR(message);
+		MessageBox(
+			nullptr,
+			chiralscroll::StringToWstring(message).c_str(),
+			L"ChiralScroll Error",
+			MB_OK | MB_ICONERROR);
+	}
+	chiralscroll::GetFlightRecorder().FinishDumps();
+	chiralscroll::ShutdownLogging();
+	if(logToConsole)
+	{
+		FreeConsole();
+	}
+	return result;
+}
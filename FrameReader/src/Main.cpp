@@ -0,0 +1,98 @@
+// Follows the touchpad contacts that a running ChiralScroll publishes in
+// shared memory when started with --publishFrames, and prints each frame.
+// Reading them has no effect on ChiralScroll: the segment is mapped
+// read-only, and frames this reader falls behind on are skipped and counted.
+//
+// Usage: FrameReader [--duration=10s] [--poll=1ms]
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+
+#include "FrameSegment.h"
+
+ABSL_FLAG(absl::Duration, duration, absl::ZeroDuration(), "How long to follow the frames. Until interrupted if zero.");
+ABSL_FLAG(absl::Duration, poll, absl::Milliseconds(1), "How long to sleep when there is no new frame.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+std::string FormatFrame(const SharedFrames& frames, const SharedFrames::Frame& frame, int64_t firstUs)
+{
+	std::string result = absl::StrFormat("%10.3f %-12s",
+		static_cast<double>(frame.timeUs - firstUs)/1000.0,
+		frames.devices[frame.device].data());
+	for(uint32_t i = 0; i < frame.contactCount; ++i)
+	{
+		const SharedFrames::Contact& contact = frame.contacts[i];
+		absl::StrAppendFormat(&result, "  %d%s (%.3f, %.3f)",
+			contact.id, contact.isTouch ? "" : " up", contact.x, contact.y);
+	}
+	return result;
+}
+
+int Run()
+{
+	const std::optional<FrameSegment> segment = FrameSegment::Open();
+	if(!segment)
+	{
+		absl::FPrintF(stderr, "ChiralScroll is not running with --publishFrames, or is a different version.\n");
+		return 1;
+	}
+	const SharedFrames& frames = segment->frames();
+	absl::PrintF("ChiralScroll process %d, %d touchpads\n", frames.processId, frames.deviceCount);
+
+	const absl::Duration duration = absl::GetFlag(FLAGS_duration);
+	const absl::Duration poll = absl::GetFlag(FLAGS_poll);
+	const absl::Time end = duration > absl::ZeroDuration() ? absl::Now() + duration : absl::InfiniteFuture();
+	FrameSegment::Reader reader(*segment);
+	std::optional<int64_t> firstUs;
+	uint64_t count = 0;
+	uint64_t lost = 0;
+	SharedFrames::Frame frame;
+	while(absl::Now() < end)
+	{
+		if(!reader.Next(&frame))
+		{
+			std::fflush(stdout);
+			absl::SleepFor(poll);
+			continue;
+		}
+		if(reader.lost() != lost)
+		{
+			absl::PrintF("%d frames lost\n", reader.lost() - lost);
+			lost = reader.lost();
+		}
+		if(!firstUs)
+		{
+			firstUs = frame.timeUs;
+		}
+		absl::PrintF("%s\n", FormatFrame(frames, frame, *firstUs));
+		++count;
+	}
+	absl::PrintF("%d frames read, %d lost\n", count, reader.lost());
+	return 0;
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int main(int argc, char* argv[])
+{
+	absl::SetProgramUsageMessage("Prints the touchpad contacts published by a running ChiralScroll.\n"
+		"Usage: FrameReader [--duration=10s] [--poll=1ms]");
+	absl::ParseCommandLine(argc, argv);
+	return chiralscroll::Run();
+}
@@ -0,0 +1,149 @@
+#include "CurveChecks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/strings/str_format.h>
+
+#include "AccelerationCurve.h"
+#include "Settings.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Largest difference in gain allowed between the table and the exact curve.
+// Interpolating the table is exact within a segment, and only rounds off the
+// corners, by at most a quarter of a table step times the change in slope.
+static constexpr float kTolerance = 0.01f;
+// Speeds compared per curve, from 0 to half again the speed of the last
+// point.
+static constexpr int kSamples = 100000;
+static constexpr int kTimedCalls = 1000000;
+static constexpr char kDevice[] = "Curve check device";
+
+// Longer than the first buffer that settings are read into, and exactly
+// printable with %g, so that the points read back compare equal.
+static constexpr char kLongCurve[] =
+	"0.125:0.5 0.25:0.75 0.5:1 0.75:1.25 1:1.5 1.5:2 2:2.5 3:3 4:3.5 6:4";
+
+// Keeps the timed calls from being optimized away.
+volatile float sink;
+
+// Returns the average time per call of gain over the given speeds, in
+// nanoseconds.
+template<typename Gain>
+double TimePerCall(const std::vector<float>& speeds, Gain gain)
+{
+	float sum = 0.0f;
+	const auto start = std::chrono::steady_clock::now();
+	for(int i = 0; i < kTimedCalls; ++i)
+	{
+		sum += gain(speeds[i % speeds.size()]);
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	sink = sum;
+	return std::chrono::duration<double, std::nano>(elapsed).count()/kTimedCalls;
+}
+
+bool SamePoints(const AccelerationCurve& a, const AccelerationCurve& b)
+{
+	return std::equal(a.points().begin(), a.points().end(), b.points().begin(), b.points().end(),
+		[](const AccelerationCurve::Point& a, const AccelerationCurve::Point& b) {
+			return a.speed == b.speed && a.gain == b.gain;
+		});
+}
+
+// Writes a curve to a settings file and reads it back, then overwrites it
+// with a curve that does not parse, which reads back as no acceleration.
+bool CheckSettingsFile()
+{
+	bool passed = true;
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "chiralscroll-curvechecks.ini";
+	std::filesystem::remove(path);
+
+	const AccelerationCurve curve = AccelerationCurve::FromString(kLongCurve);
+	Settings settings;
+	settings.GetDeviceSettings(kDevice).accelerationCurve = curve;
+	settings.ToFile(path);
+	const AccelerationCurve read = Settings::FromFile(path, {kDevice}).GetDeviceSettings(kDevice).accelerationCurve;
+	bool ok = SamePoints(curve, read);
+	absl::PrintF("  %-5s %d points round trip through a settings file: \"%s\"\n",
+		ok ? "ok" : "FAIL", curve.points().size(), read.ToString());
+	passed &= ok;
+
+	WritePrivateProfileString(L"Curve check device", L"accelerationCurve", L"1:2 0.5:1", path.c_str());
+	const AccelerationCurve bad = Settings::FromFile(path, {kDevice}).GetDeviceSettings(kDevice).accelerationCurve;
+	ok = bad.points().empty();
+	absl::PrintF("  %-5s a curve that does not parse reads as no acceleration: \"%s\"\n",
+		ok ? "ok" : "FAIL", bad.ToString());
+	passed &= ok;
+
+	std::filesystem::remove(path);
+	return passed;
+}
+
+}  // namespace
+
+
+bool RunCurveChecks()
+{
+	bool passed = true;
+	absl::PrintF("Acceleration curve tables against the exact curves, within %g:\n", kTolerance);
+	const std::vector<std::string> curves = {
+		"",
+		"1:2",
+		"0.5:1 2:3",
+		"0.2:1 1:2 4:6",
+		"0:3 1:1",
+		"0.25:1 0.5:1.5 1:2.5 2:4 3:4.5",
+	};
+	for(const std::string& text : curves)
+	{
+		const AccelerationCurve curve = AccelerationCurve::FromString(text);
+		const float maxSpeed = 1.5f*(curve.points().empty() ? 1.0f : std::max(curve.points().back().speed, 1.0f));
+		float worst = 0.0f;
+		float worstSpeed = 0.0f;
+		for(int i = 0; i <= kSamples; ++i)
+		{
+			const float speed = maxSpeed*static_cast<float>(i)/kSamples;
+			const float difference = std::abs(curve.Gain(speed) - curve.Evaluate(speed));
+			if(difference > worst)
+			{
+				worst = difference;
+				worstSpeed = speed;
+			}
+		}
+		const bool ok = worst <= kTolerance;
+		absl::PrintF("  %-5s \"%s\": largest difference %.4f at %.3f heights/s\n",
+			ok ? "ok" : "FAIL", text, worst, worstSpeed);
+		passed &= ok;
+	}
+
+	// Speeds like a scrolling finger's, in a random order so that the
+	// segment search cannot be predicted.
+	const AccelerationCurve curve = AccelerationCurve::FromString(curves.back());
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> speed(0.0f, 4.0f);
+	std::vector<float> speeds(4096);
+	std::generate(speeds.begin(), speeds.end(), [&] { return speed(random); });
+	const double table = TimePerCall(speeds, [&](float speed) { return curve.Gain(speed); });
+	const double exact = TimePerCall(speeds, [&](float speed) { return curve.Evaluate(speed); });
+	absl::PrintF("  time  \"%s\": %.1fns per table lookup, %.1fns per exact evaluation\n",
+		curves.back(), table, exact);
+
+	absl::PrintF("Acceleration curves in settings files:\n");
+	passed &= CheckSettingsFile();
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Compares the table lookup of several acceleration curves with the exact
+// piecewise linear curve across and beyond their speed range, and times both
+// per call. Prints one line per curve and returns whether all of them were
+// within tolerance.
+bool RunCurveChecks();
+
+}  // namespace chiralscroll
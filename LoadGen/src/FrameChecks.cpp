@@ -0,0 +1,265 @@
+#include "FrameChecks.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/time/time.h>
+
+#include "HidUtils.h"
+#include "PipelineStats.h"
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Two contacts per report, so that frames of three or more contacts take
+// several reports, as in hybrid mode.
+static constexpr size_t kContactsPerReport = 2;
+static constexpr absl::Duration kScanPeriod = absl::Milliseconds(8);
+static constexpr absl::Duration kTimeout = TouchDevice::FrameBuilder::kDefaultTimeout;
+
+using PartialFramePolicy = TouchDevice::FrameBuilder::PartialFramePolicy;
+
+struct Expected
+{
+	int64_t frames;
+	int64_t partialFrames;
+	int64_t droppedFrames;
+	int64_t mergedFrames;
+	int64_t strayReports;
+	// IDs of the lifts in the delivered frames, in order.
+	std::vector<ULONG> lifts;
+};
+
+// Each contact stays at its own position, so that a lift matches the frame
+// before it.
+Touchpad::Contact Touch(ULONG id)
+{
+	const ULONG x = 100*(id + 1);
+	return {id, 1, true, true, x, 100, static_cast<LONG>(x)*10, 1000};
+}
+
+Touchpad::Contact Lift(ULONG id)
+{
+	Touchpad::Contact contact = Touch(id);
+	contact.isTouch = false;
+	return contact;
+}
+
+// Feeds reports to a frame builder and collects the frames it delivers, the
+// way the input pipeline does. Unless the frame timer is late, a frame whose
+// deadline passes before the next report is expired first.
+class Script
+{
+public:
+	Script(PartialFramePolicy policy, bool frameTimer)
+		: builder_(kContactsPerReport, false, kTimeout, policy),
+		  frameTimer_(frameTimer) {}
+
+	// Adds a report of the given scan, arriving delay after the scan.
+	void Add(int scan, ULONG contactCount, std::vector<Touchpad::Contact> contacts,
+		absl::Duration delay = absl::ZeroDuration())
+	{
+		const absl::Time arrival = absl::UnixEpoch() + scan*kScanPeriod + delay;
+		if(frameTimer_ && builder_.deadline() < arrival)
+		{
+			Deliver(builder_.Expire(builder_.deadline() + absl::Nanoseconds(1)));
+		}
+		// Scan time is in 100us units.
+		const ULONG scanTime = static_cast<ULONG>(absl::ToInt64Microseconds(scan*kScanPeriod)/100);
+		TouchDevice::FrameBuilder::Frames frames =
+			builder_.AddReport({contactCount, scanTime, std::move(contacts)}, arrival);
+		Deliver(std::move(frames.flushed));
+		Deliver(std::move(frames.finished));
+	}
+
+	// Lets the frame timer expire the frame in progress.
+	void Finish()
+	{
+		if(builder_.InProgress())
+		{
+			Deliver(builder_.Expire(builder_.deadline() + absl::Nanoseconds(1)));
+		}
+	}
+
+	const FrameStats& stats() const
+	{
+		return builder_.stats();
+	}
+
+	const std::vector<ULONG>& lifts() const
+	{
+		return lifts_;
+	}
+
+private:
+	void Deliver(std::optional<TouchDevice::FrameBuilder::Frame> frame)
+	{
+		if(!frame)
+		{
+			return;
+		}
+		for(const auto& contact : frame->contacts)
+		{
+			if(!contact.isTouch)
+			{
+				lifts_.push_back(contact.id);
+			}
+		}
+	}
+
+	TouchDevice::FrameBuilder builder_;
+	bool frameTimer_;
+	std::vector<ULONG> lifts_;
+};
+
+bool Check(std::string_view name, Script& script, const Expected& expected)
+{
+	script.Finish();
+	const FrameStats& stats = script.stats();
+	const Expected actual{
+		static_cast<int64_t>(stats.frames.value()),
+		static_cast<int64_t>(stats.partialFrames.value()),
+		static_cast<int64_t>(stats.droppedFrames.value()),
+		static_cast<int64_t>(stats.mergedFrames.value()),
+		static_cast<int64_t>(stats.strayReports.value()),
+		script.lifts(),
+	};
+	const auto format = [](const Expected& counts) {
+		return absl::StrFormat("%d frames, %d partial, %d dropped, %d merged, %d stray, lifts [%s]",
+			counts.frames, counts.partialFrames, counts.droppedFrames, counts.mergedFrames, counts.strayReports,
+			absl::StrJoin(counts.lifts, " "));
+	};
+	const bool passed = actual.frames == expected.frames &&
+		actual.partialFrames == expected.partialFrames &&
+		actual.droppedFrames == expected.droppedFrames &&
+		actual.mergedFrames == expected.mergedFrames &&
+		actual.strayReports == expected.strayReports &&
+		actual.lifts == expected.lifts;
+	if(passed)
+	{
+		absl::PrintF("  ok    %s: %s\n", name, format(actual));
+	}
+	else
+	{
+		absl::PrintF("  FAIL  %s: got %s, expected %s\n", name, format(actual), format(expected));
+	}
+	return passed;
+}
+
+}  // namespace
+
+
+bool RunFrameChecks()
+{
+	bool passed = true;
+	absl::PrintF("Frame assembly with lost, reordered and duplicated reports:\n");
+
+	{
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 3, {Lift(0), Lift(1)});
+		script.Add(1, 0, {Lift(2)});
+		passed &= Check("complete frames", script, {2, 0, 0, 0, 0, {0, 1, 2}});
+	}
+	{
+		// The next frame arrives before the frame timer fires, and flushes the
+		// lifts that did arrive.
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 3, {Lift(0), Lift(1)});
+		script.Add(2, 1, {Touch(3)});
+		script.Add(3, 1, {Lift(3)});
+		passed &= Check("lost continuation, next frame", script, {4, 1, 0, 0, 0, {0, 1, 3}});
+	}
+	{
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 3, {Lift(0), Lift(1)});
+		passed &= Check("lost continuation, frame timer", script, {2, 1, 0, 0, 0, {0, 1}});
+	}
+	{
+		Script script(PartialFramePolicy::kDiscard, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 3, {Lift(0), Lift(1)});
+		script.Add(2, 1, {Touch(3)});
+		script.Add(3, 1, {Lift(3)});
+		passed &= Check("lost continuation, discarded", script, {3, 0, 1, 0, 0, {3}});
+	}
+	{
+		// The continuation of scan 1 arrives ahead of its first report.
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 0, {Touch(2)});
+		script.Add(1, 3, {Touch(0), Touch(1)});
+		script.Add(2, 3, {Touch(0), Touch(1)});
+		script.Add(2, 0, {Touch(2)});
+		script.Add(3, 3, {Lift(0), Lift(1)});
+		script.Add(3, 0, {Lift(2)});
+		passed &= Check("reordered continuation", script, {4, 1, 0, 0, 1, {0, 1, 2}});
+	}
+	{
+		// Five contacts take three reports, so the duplicate completes the
+		// frame and the real last report is left over.
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 5, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2), Touch(3)});
+		script.Add(0, 0, {Touch(2), Touch(3)});
+		script.Add(0, 0, {Touch(4)});
+		script.Add(1, 5, {Touch(0), Touch(1)});
+		script.Add(1, 0, {Touch(2), Touch(3)});
+		script.Add(1, 0, {Touch(4)});
+		script.Add(2, 5, {Lift(0), Lift(1)});
+		script.Add(2, 0, {Lift(2), Lift(3)});
+		script.Add(2, 0, {Lift(4)});
+		passed &= Check("duplicated continuation", script, {3, 1, 0, 1, 1, {0, 1, 2, 3, 4}});
+	}
+	{
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)});
+		script.Add(1, 3, {Lift(0), Lift(1)});
+		script.Add(1, 0, {Lift(2)});
+		passed &= Check("duplicated first report", script, {3, 1, 0, 0, 0, {0, 1, 2}});
+	}
+	{
+		// The frame timer expires the frame before its continuation arrives.
+		Script script(PartialFramePolicy::kFlush, true);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)}, kTimeout + absl::Milliseconds(5));
+		script.Add(5, 3, {Touch(0), Touch(1)});
+		script.Add(5, 0, {Touch(2)});
+		script.Add(6, 3, {Lift(0), Lift(1)});
+		script.Add(6, 0, {Lift(2)});
+		passed &= Check("late continuation", script, {3, 1, 0, 0, 1, {0, 1, 2}});
+	}
+	{
+		// Without the frame timer, the late continuation ends the frame.
+		Script script(PartialFramePolicy::kFlush, false);
+		script.Add(0, 3, {Touch(0), Touch(1)});
+		script.Add(0, 0, {Touch(2)}, kTimeout + absl::Milliseconds(5));
+		script.Add(5, 3, {Touch(0), Touch(1)});
+		script.Add(5, 0, {Touch(2)});
+		script.Add(6, 3, {Lift(0), Lift(1)});
+		script.Add(6, 0, {Lift(2)});
+		passed &= Check("late continuation, late timer", script, {3, 1, 0, 0, 1, {0, 1, 2}});
+	}
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Replays short scripted report sequences with lost, reordered, duplicated
+// and late reports through a hybrid mode frame builder, and checks its frame
+// counts and which lifts it delivers against the expected ones. Prints one
+// line per script and returns whether all of them passed.
+bool RunFrameChecks();
+
+}  // namespace chiralscroll
@@ -0,0 +1,275 @@
+#include "Generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// The size of a typical precision touchpad.
+static constexpr LONG kLogicalWidth = 1228;
+static constexpr LONG kLogicalHeight = 928;
+static constexpr LONG kPhysicalWidth = 10500;
+static constexpr LONG kPhysicalHeight = 7900;
+
+static constexpr float kPi = 3.14159f;
+
+static constexpr absl::Duration kMinGesture = absl::Milliseconds(200);
+static constexpr absl::Duration kMaxGesture = absl::Seconds(2);
+static constexpr absl::Duration kMinRest = absl::Milliseconds(50);
+static constexpr absl::Duration kMaxRest = absl::Milliseconds(500);
+
+// A contact the device never reported down, which the frame builder has to
+// throw away.
+static constexpr ULONG kBogusContactId = 9;
+// How far a moved lift is from its contact.
+static constexpr LONG kLiftShift = 50;
+
+enum class Corruption
+{
+	// The last report of the scan is lost.
+	kDropReport,
+	// One report of the scan is delivered twice.
+	kDuplicateReport,
+	// The first report claims more contacts than the scan has.
+	kOvercount,
+	// The first report claims to be a continuation.
+	kStray,
+	// The scan lifts a contact that was never down.
+	kBogusLift,
+	// The scan lifts the last contact that is down somewhere other than where
+	// it was, which the frame builder throws away like a bogus lift.
+	kMovedLift,
+	kCount,
+};
+
+std::vector<Touchpad::ContactInfo> MakeContactInfo(size_t contactsPerReport)
+{
+	std::vector<Touchpad::ContactInfo> contactInfo;
+	for(size_t slot = 0; slot < contactsPerReport; ++slot)
+	{
+		contactInfo.push_back({
+			static_cast<USHORT>(slot + 1),
+			{0, kLogicalHeight, 0, kLogicalWidth},
+			{0, kPhysicalHeight, 0, kPhysicalWidth},
+		});
+	}
+	return contactInfo;
+}
+
+absl::Duration UniformDuration(std::mt19937& rng, absl::Duration min, absl::Duration max)
+{
+	std::uniform_real_distribution<double> seconds(absl::ToDoubleSeconds(min), absl::ToDoubleSeconds(max));
+	return absl::Seconds(seconds(rng));
+}
+
+}  // namespace
+
+
+ReportGenerator::ReportGenerator(std::string name, const Options& options, uint32_t seed)
+	: device_(std::move(name), MakeContactInfo(options.contactsPerReport)),
+	  options_(options),
+	  rng_(seed),
+	  period_(absl::Seconds(1.0/options.rateHz)),
+	  scans_(0),
+	  malformedScans_(0)
+{
+	// Start each device at a different point in its scan period, so that the
+	// devices interleave.
+	nextScan_ = absl::UnixEpoch() + UniformDuration(rng_, absl::ZeroDuration(), period_);
+	StartGesture();
+}
+
+void ReportGenerator::Next(std::vector<TouchDevice::FrameBuilder::Report>* reports)
+{
+	reports->clear();
+	for(int i = 0; i < BatchLength(); ++i)
+	{
+		const bool lift = scansLeft_ <= 0;
+		AddScan(lift, reports);
+		nextScan_ += period_;
+		if(lift)
+		{
+			nextScan_ += UniformDuration(rng_, kMinRest, kMaxRest);
+			StartGesture();
+			return;
+		}
+		--scansLeft_;
+	}
+	nextArrival_ = nextScan_ + period_*(BatchLength() - 1);
+}
+
+int ReportGenerator::BatchLength() const
+{
+	return pattern_ == Pattern::kBurst ? std::max(1, options_.burstLength) : 1;
+}
+
+void ReportGenerator::StartGesture()
+{
+	pattern_ = options_.patterns[std::uniform_int_distribution<size_t>(0, options_.patterns.size() - 1)(rng_)];
+	scansLeft_ = static_cast<int>(UniformDuration(rng_, kMinGesture, kMaxGesture)/period_);
+	nextArrival_ = nextScan_ + period_*(BatchLength() - 1);
+
+	const float rate = static_cast<float>(options_.rateHz);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	fingers_.clear();
+	if(pattern_ == Pattern::kMultiFinger)
+	{
+		const int count = std::uniform_int_distribution<int>(2, 4)(rng_);
+		for(int i = 0; i < count; ++i)
+		{
+			// Up to a touchpad width per second in each direction.
+			fingers_.push_back({
+				static_cast<ULONG>(i),
+				unit(rng_)*kLogicalWidth,
+				unit(rng_)*kLogicalHeight,
+				(2.0f*unit(rng_) - 1.0f)*kLogicalWidth/rate,
+				(2.0f*unit(rng_) - 1.0f)*kLogicalWidth/rate,
+				0.0f,
+				0.0f,
+			});
+		}
+		return;
+	}
+
+	// Touch down near the right edge, at the rightmost point of a circle,
+	// and circle half a turn to two turns a second either way.
+	const float radius = (0.05f + 0.1f*unit(rng_))*kLogicalHeight;
+	const float revsPerSecond = 0.5f + 1.5f*unit(rng_);
+	const float direction = unit(rng_) < 0.5f ? -1.0f : 1.0f;
+	fingers_.push_back({
+		0,
+		0.97f*kLogicalWidth - radius,
+		(0.3f + 0.4f*unit(rng_))*kLogicalHeight,
+		direction*2.0f*kPi*revsPerSecond/rate,
+		0.0f,
+		0.0f,
+		radius,
+	});
+}
+
+void ReportGenerator::AddScan(bool lift, std::vector<TouchDevice::FrameBuilder::Report>* reports)
+{
+	if(!lift)
+	{
+		for(auto& finger : fingers_)
+		{
+			if(finger.radius > 0.0f)
+			{
+				finger.angle += finger.vx;
+				continue;
+			}
+			finger.x += finger.vx;
+			finger.y += finger.vy;
+			if(finger.x < 0.0f || finger.x >= kLogicalWidth)
+			{
+				finger.vx = -finger.vx;
+				finger.x = std::clamp(finger.x, 0.0f, static_cast<float>(kLogicalWidth - 1));
+			}
+			if(finger.y < 0.0f || finger.y >= kLogicalHeight)
+			{
+				finger.vy = -finger.vy;
+				finger.y = std::clamp(finger.y, 0.0f, static_cast<float>(kLogicalHeight - 1));
+			}
+		}
+	}
+
+	// Scan time is in 100us units and wraps at 16 bits.
+	const ULONG scanTime = static_cast<ULONG>((absl::ToInt64Microseconds(nextScan_ - absl::UnixEpoch())/100) & 0xFFFF);
+	const size_t firstReport = reports->size();
+	const size_t perReport = std::max<size_t>(1, options_.contactsPerReport);
+	for(size_t i = 0; i < fingers_.size(); ++i)
+	{
+		if(i % perReport == 0)
+		{
+			reports->push_back({i == 0 ? static_cast<ULONG>(fingers_.size()) : 0, scanTime, {}});
+		}
+		reports->back().contacts.push_back(MakeContact(fingers_[i], i % perReport, !lift));
+	}
+	++scans_;
+
+	if(std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < options_.malformedFraction)
+	{
+		Corrupt(firstReport, reports);
+	}
+}
+
+void ReportGenerator::Corrupt(size_t firstReport, std::vector<TouchDevice::FrameBuilder::Report>* reports)
+{
+	++malformedScans_;
+	const size_t reportCount = reports->size() - firstReport;
+	const auto corruption = static_cast<Corruption>(
+		std::uniform_int_distribution<int>(0, static_cast<int>(Corruption::kCount) - 1)(rng_));
+	switch(corruption)
+	{
+	case Corruption::kDropReport:
+		reports->pop_back();
+		break;
+	case Corruption::kDuplicateReport:
+	{
+		const size_t index = firstReport + std::uniform_int_distribution<size_t>(0, reportCount - 1)(rng_);
+		reports->insert(reports->begin() + static_cast<ptrdiff_t>(index), (*reports)[index]);
+		break;
+	}
+	case Corruption::kOvercount:
+		(*reports)[firstReport].contactCount += 1;
+		break;
+	case Corruption::kStray:
+		(*reports)[firstReport].contactCount = 0;
+		break;
+	case Corruption::kBogusLift:
+	{
+		Finger bogus = fingers_.front();
+		bogus.id = kBogusContactId;
+		(*reports)[firstReport].contacts.push_back(MakeContact(bogus, 0, false));
+		break;
+	}
+	case Corruption::kMovedLift:
+	{
+		const ULONG id = fingers_.back().id;
+		for(size_t i = firstReport; i < reports->size(); ++i)
+		{
+			for(auto& contact : (*reports)[i].contacts)
+			{
+				if(contact.id == id && contact.isTouch)
+				{
+					contact.isTouch = false;
+					contact.logicalX += contact.logicalX < kLogicalWidth/2 ? kLiftShift : -kLiftShift;
+				}
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+Touchpad::Contact ReportGenerator::MakeContact(const Finger& finger, size_t slot, bool isTouch) const
+{
+	float x = finger.x;
+	float y = finger.y;
+	if(finger.radius > 0.0f)
+	{
+		x += finger.radius*std::cos(finger.angle);
+		y += finger.radius*std::sin(finger.angle);
+	}
+	const LONG logicalX = std::clamp(static_cast<LONG>(std::lround(x)), 0L, kLogicalWidth - 1);
+	const LONG logicalY = std::clamp(static_cast<LONG>(std::lround(y)), 0L, kLogicalHeight - 1);
+	return {
+		finger.id,
+		device_.contactInfo()[slot].link,
+		isTouch,
+		true,
+		static_cast<ULONG>(logicalX),
+		static_cast<ULONG>(logicalY),
+		logicalX*kPhysicalWidth/kLogicalWidth,
+		logicalY*kPhysicalHeight/kLogicalHeight,
+	};
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <absl/time/time.h>
+
+#include "HidUtils.h"
+#include "Touchpad.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+// Synthesizes the decoded reports of a virtual touchpad, as TouchDevice would
+// pass them to its frame builder. The device repeatedly touches down, moves
+// one or more fingers for a while, lifts, and rests, like a user would.
+class ReportGenerator
+{
+public:
+	enum class Pattern
+	{
+		// One finger circling in the vertical scroll zone.
+		kScroll,
+		// Two to four fingers moving across the touchpad.
+		kMultiFinger,
+		// A scroll whose reports are held back and delivered all at once, as
+		// happens when the input thread is descheduled.
+		kBurst,
+	};
+
+	struct Options
+	{
+		// Scans per second while a finger is down.
+		double rateHz;
+		// Contacts that fit in one report. Frames with more contacts are split
+		// over several reports, as in hybrid mode.
+		size_t contactsPerReport;
+		std::vector<Pattern> patterns;
+		// Fraction of scans to corrupt.
+		double malformedFraction;
+		// Scans delivered together in a burst.
+		int burstLength;
+	};
+
+	ReportGenerator(std::string name, const Options& options, uint32_t seed);
+
+	const RecordedTouchpad& device() const
+	{
+		return device_;
+	}
+
+	// Time at which the next reports arrive.
+	absl::Time nextArrival() const
+	{
+		return nextArrival_;
+	}
+
+	// Replaces reports with the reports arriving at nextArrival, and moves on
+	// to the next arrival.
+	void Next(std::vector<TouchDevice::FrameBuilder::Report>* reports);
+
+	// Scans that were deliberately corrupted.
+	int64_t malformedScans() const
+	{
+		return malformedScans_;
+	}
+
+	// Frames generated, including the ones that were corrupted.
+	int64_t scans() const
+	{
+		return scans_;
+	}
+
+private:
+	struct Finger
+	{
+		ULONG id;
+		float x;
+		float y;
+		// Per scan. For circling fingers vx is the angle step, and (x, y) is
+		// the center of the circle.
+		float vx;
+		float vy;
+		float angle;
+		float radius;
+	};
+
+	// Scans delivered at each arrival.
+	int BatchLength() const;
+	void StartGesture();
+	void AddScan(bool lift, std::vector<TouchDevice::FrameBuilder::Report>* reports);
+	void Corrupt(size_t firstReport, std::vector<TouchDevice::FrameBuilder::Report>* reports);
+	Touchpad::Contact MakeContact(const Finger& finger, size_t slot, bool isTouch) const;
+
+	RecordedTouchpad device_;
+	Options options_;
+	std::mt19937 rng_;
+	absl::Duration period_;
+
+	absl::Time nextScan_;
+	absl::Time nextArrival_;
+	Pattern pattern_;
+	std::vector<Finger> fingers_;
+	// Scans left in the current gesture before the fingers lift.
+	int scansLeft_;
+
+	int64_t scans_;
+	int64_t malformedScans_;
+};
+
+}  // namespace chiralscroll
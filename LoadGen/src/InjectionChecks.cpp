@@ -0,0 +1,176 @@
+#include "InjectionChecks.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/time/time.h>
+
+#include "Clock.h"
+#include "FlightRecorder.h"
+#include "InjectionWatchdog.h"
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "Scroller.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr absl::Duration kStallThreshold = InjectionWatchdog::kDefaultStallThreshold;
+// How long to wait for the worker before giving up on it.
+static constexpr std::chrono::seconds kWorkerTimeout{5};
+
+// A clock that only moves when told to, and that the worker thread can read
+// while the check moves it.
+class SteppedClock : public Clock
+{
+public:
+	absl::Time Now() const override
+	{
+		return absl::UnixEpoch() + absl::Nanoseconds(ns_.load(std::memory_order_acquire));
+	}
+
+	void Advance(absl::Duration duration)
+	{
+		ns_.fetch_add(absl::ToInt64Nanoseconds(duration), std::memory_order_acq_rel);
+	}
+
+private:
+	std::atomic<int64_t> ns_{0};
+};
+
+// Records the amounts it is sent. After Stall, each call blocks until
+// Release.
+class StallingScroller : public Scroller
+{
+public:
+	void StartScrolling() override {}
+
+	void Scroll(int amt) override
+	{
+		std::unique_lock lock(mutex_);
+		amounts_.push_back(amt);
+		changed_.notify_all();
+		changed_.wait(lock, [this] { return !stalling_; });
+	}
+
+	void StopScrolling() override {}
+
+	void Stall()
+	{
+		std::lock_guard lock(mutex_);
+		stalling_ = true;
+	}
+
+	void Release()
+	{
+		std::lock_guard lock(mutex_);
+		stalling_ = false;
+		changed_.notify_all();
+	}
+
+	// Waits until the sink has been called count times in all. Returns false
+	// if it was not in time.
+	bool WaitForCalls(size_t count)
+	{
+		std::unique_lock lock(mutex_);
+		return changed_.wait_for(lock, kWorkerTimeout, [this, count] { return amounts_.size() >= count; });
+	}
+
+	std::vector<int> amounts()
+	{
+		std::lock_guard lock(mutex_);
+		return amounts_;
+	}
+
+private:
+	std::mutex mutex_;
+	std::condition_variable changed_;
+	std::vector<int> amounts_;
+	bool stalling_ = false;
+};
+
+bool Expect(std::string_view name, bool passed, const std::string& detail)
+{
+	absl::PrintF("  %-5s %s: %s\n", passed ? "ok" : "FAIL", name, detail);
+	return passed;
+}
+
+bool ExpectAmounts(std::string_view name, StallingScroller& sink, const std::vector<int>& expected)
+{
+	const std::vector<int> amounts = sink.amounts();
+	return Expect(name, amounts == expected,
+		absl::StrFormat("sent [%s], expected [%s]", absl::StrJoin(amounts, " "), absl::StrJoin(expected, " ")));
+}
+
+}  // namespace
+
+
+bool RunInjectionChecks()
+{
+	// The stall is staged, so it should not write a flight record.
+	GetFlightRecorder().SetAnomalyDumps(false);
+	PipelineStats& stats = GetPipelineStats();
+	const uint64_t fallbackScrolls = stats.fallbackScrolls.value();
+	const uint64_t droppedScrolls = stats.droppedScrolls.value();
+	const uint64_t stalls = stats.injectionStalls.count();
+
+	bool passed = true;
+	absl::PrintF("Scroll injection with a stalling sink:\n");
+	SteppedClock clock;
+	InjectionWatchdog watchdog(clock, kStallThreshold);
+	auto primary = std::make_unique<StallingScroller>();
+	auto fallback = std::make_unique<StallingScroller>();
+	auto unbacked = std::make_unique<StallingScroller>();
+	StallingScroller& primarySink = *primary;
+	StallingScroller& fallbackSink = *fallback;
+	StallingScroller& unbackedSink = *unbacked;
+	const std::unique_ptr<Scroller> scroller = watchdog.Watch(std::move(primary), std::move(fallback));
+	const std::unique_ptr<Scroller> unbackedScroller = watchdog.Watch(std::move(unbacked), nullptr);
+
+	// The first call blocks. Scrolls before the threshold wait for it and are
+	// sent together afterwards, later ones go around it.
+	primarySink.Stall();
+	scroller->Scroll(1);
+	passed &= Expect("call in progress", primarySink.WaitForCalls(1), "the worker called the primary sink");
+	clock.Advance(kStallThreshold/5);
+	scroller->Scroll(4);
+	scroller->Scroll(5);
+	passed &= Expect("slow call", !watchdog.stalled(), "not stalled before the threshold");
+	clock.Advance(kStallThreshold);
+	passed &= Expect("stalled call", watchdog.stalled(), "stalled after the threshold");
+	scroller->Scroll(2);
+	scroller->Scroll(3);
+	unbackedScroller->Scroll(7);
+
+	primarySink.Release();
+	passed &= Expect("recovery", primarySink.WaitForCalls(2), "the worker sent the waiting scrolls");
+	passed &= Expect("after stall", !watchdog.stalled(), "not stalled once the call returned");
+	scroller->Scroll(6);
+	passed &= Expect("back to primary", primarySink.WaitForCalls(3), "the worker sent the next scroll");
+
+	passed &= ExpectAmounts("coalesced", primarySink, {1, 9, 6});
+	passed &= ExpectAmounts("fallback", fallbackSink, {2, 3});
+	passed &= ExpectAmounts("dropped", unbackedSink, {});
+	passed &= Expect("fallbackScrolls", stats.fallbackScrolls.value() - fallbackScrolls == 2,
+		absl::StrFormat("%d, expected 2", stats.fallbackScrolls.value() - fallbackScrolls));
+	passed &= Expect("droppedScrolls", stats.droppedScrolls.value() - droppedScrolls == 1,
+		absl::StrFormat("%d, expected 1", stats.droppedScrolls.value() - droppedScrolls));
+	passed &= Expect("injectionStalls", stats.injectionStalls.count() - stalls == 1,
+		absl::StrFormat("%d, expected 1, longest %.0fms", stats.injectionStalls.count() - stalls,
+			CyclesToNanoseconds(stats.injectionStalls.max())/1e6));
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Drives an InjectionWatchdog with a sink that stalls on command and a clock
+// moved by hand, and checks that scrolls are coalesced while a call is in
+// progress, go to the fallback sink or are dropped during a stall, and go
+// back to the primary sink afterwards, along with the counts in
+// PipelineStats. Prints one line per check and returns whether all of them
+// passed.
+bool RunInjectionChecks();
+
+}  // namespace chiralscroll
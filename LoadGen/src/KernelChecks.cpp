@@ -0,0 +1,135 @@
+#include "KernelChecks.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+
+#include "ContactBatch.h"
+#include "Touchpad.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr size_t kMaxContacts = ContactBatch::kMaxContacts;
+// Written past the end of the output, which the kernel must leave alone.
+static constexpr float kGuard = -12345.0f;
+// Multiplying by the reciprocal may differ from dividing in the last bits.
+static constexpr float kDivisionTolerance = 1e-6f;
+
+bool Expect(std::string_view name, bool passed, const std::string& detail)
+{
+	absl::PrintF("  %-5s %s: %s\n", passed ? "ok" : "FAIL", name, detail);
+	return passed;
+}
+
+// Positions, contact area corners and reciprocal sizes like a touchpad's.
+struct Inputs
+{
+	std::array<float, kMaxContacts> in;
+	std::array<float, kMaxContacts> offset;
+	std::array<float, kMaxContacts> scale;
+};
+
+Inputs RandomInputs(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(0.0f, 4000.0f);
+	std::uniform_real_distribution<float> size(500.0f, 4000.0f);
+	Inputs inputs;
+	for(size_t i = 0; i < kMaxContacts; ++i)
+	{
+		inputs.in[i] = position(random);
+		inputs.offset[i] = position(random)/8;
+		inputs.scale[i] = 1.0f/size(random);
+	}
+	return inputs;
+}
+
+// The number of elements of out that differ from the plain loop, plus any
+// guard past n that was overwritten.
+int CountWrong(const Inputs& inputs, const std::array<float, kMaxContacts + 1>& out, size_t n)
+{
+	int wrong = 0;
+	for(size_t i = 0; i < n; ++i)
+	{
+		wrong += out[i] == (inputs.in[i] - inputs.offset[i])*inputs.scale[i] ? 0 : 1;
+	}
+	for(size_t i = n; i < out.size(); ++i)
+	{
+		wrong += out[i] == kGuard ? 0 : 1;
+	}
+	return wrong;
+}
+
+}  // namespace
+
+
+bool RunKernelChecks()
+{
+	bool passed = true;
+	absl::PrintF("Contact batch normalization against plain arithmetic:\n");
+	std::mt19937 random(1);
+
+	int outOfPlace = 0;
+	int inPlace = 0;
+	for(size_t n = 0; n <= kMaxContacts; ++n)
+	{
+		const Inputs inputs = RandomInputs(random);
+		std::array<float, kMaxContacts + 1> out;
+		out.fill(kGuard);
+		kernels::Normalize(inputs.in.data(), inputs.offset.data(), inputs.scale.data(), out.data(), n);
+		outOfPlace += CountWrong(inputs, out, n);
+
+		out.fill(kGuard);
+		std::copy_n(inputs.in.begin(), n, out.begin());
+		kernels::Normalize(out.data(), inputs.offset.data(), inputs.scale.data(), out.data(), n);
+		inPlace += CountWrong(inputs, out, n);
+	}
+	passed &= Expect("out of place", outOfPlace == 0,
+		absl::StrFormat("%d wrong values over batches of 0 to %d", outOfPlace, kMaxContacts));
+	passed &= Expect("in place", inPlace == 0,
+		absl::StrFormat("%d wrong values over batches of 0 to %d", inPlace, kMaxContacts));
+
+	// A full frame with a lift and more contacts than fit, scaled to a
+	// contact area the way the snapshot is and the way it was before batching.
+	const Touchpad::ContactInfo::Area area{10, 1794, 20, 3220};
+	std::vector<Touchpad::Contact> contacts;
+	for(ULONG id = 0; id < kMaxContacts + 2; ++id)
+	{
+		contacts.push_back({id, 0, id != 1, true, 20 + 173*id, 10 + 97*id, 0, 0});
+	}
+	ContactBatch batch = ContactBatch::FromContacts(contacts, true);
+	passed &= Expect("touches only", batch.size == kMaxContacts && batch.ids[0] == 0 && batch.ids[1] == 2 &&
+			batch.ids[kMaxContacts - 1] == kMaxContacts,
+		absl::StrFormat("%d contacts, ids %d, %d ... %d", batch.size, batch.ids[0], batch.ids[1], batch.ids[kMaxContacts - 1]));
+
+	std::array<float, kMaxContacts> left, top, xScale, yScale;
+	left.fill(static_cast<float>(area.left));
+	top.fill(static_cast<float>(area.top));
+	xScale.fill(1.0f/static_cast<float>(area.right - area.left));
+	yScale.fill(1.0f/static_cast<float>(area.bottom - area.top));
+	kernels::Normalize(batch.x.data(), left.data(), xScale.data(), batch.x.data(), batch.size);
+	kernels::Normalize(batch.y.data(), top.data(), yScale.data(), batch.y.data(), batch.size);
+	float worst = 0.0f;
+	for(size_t i = 0; i < batch.size; ++i)
+	{
+		const Touchpad::Contact& contact = contacts[batch.ids[i]];
+		const float x = static_cast<float>(contact.logicalX - area.left)/static_cast<float>(area.right - area.left);
+		const float y = static_cast<float>(contact.logicalY - area.top)/static_cast<float>(area.bottom - area.top);
+		worst = std::max({worst, std::abs(batch.x[i] - x), std::abs(batch.y[i] - y)});
+	}
+	passed &= Expect("against division", worst <= kDivisionTolerance,
+		absl::StrFormat("largest difference %g, tolerance %g", worst, kDivisionTolerance));
+	return passed;
+}
+
+}  // namespace chiralscroll
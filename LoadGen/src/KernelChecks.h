@@ -0,0 +1,12 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Compares the vectorized contact normalization with plain per-contact
+// arithmetic for every batch size, in place and out of place, and checks
+// that ContactBatch copies the right contacts. Prints one line per check and
+// returns whether all of them passed.
+bool RunKernelChecks();
+
+}  // namespace chiralscroll
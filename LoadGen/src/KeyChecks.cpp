@@ -0,0 +1,104 @@
+#include "KeyChecks.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Windows.h>
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+
+#include "HidUtils.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// A key event as keyboard raw input delivers it. Auto-repeat sends the key
+// down again without a release in between.
+struct Key
+{
+	char key;
+	bool down;
+};
+
+Key Down(char key)
+{
+	return {key, true};
+}
+
+Key Up(char key)
+{
+	return {key, false};
+}
+
+RAWKEYBOARD ToRawKeyboard(const Key& key)
+{
+	RAWKEYBOARD keyboard = {};
+	// Letter keys' virtual key codes are their upper case characters.
+	keyboard.VKey = static_cast<USHORT>(key.key);
+	keyboard.Flags = key.down ? RI_KEY_MAKE : RI_KEY_BREAK;
+	keyboard.Message = key.down ? WM_KEYDOWN : WM_KEYUP;
+	return keyboard;
+}
+
+struct Case
+{
+	std::string_view name;
+	std::vector<Key> keys;
+	// The keys which should count as new presses, in order.
+	std::string expected;
+};
+
+bool CheckCase(const Case& check)
+{
+	KeyPressFilter filter;
+	std::string presses;
+	for(const Key& key : check.keys)
+	{
+		if(filter.IsNewPress(ToRawKeyboard(key)))
+		{
+			presses.push_back(key.key);
+		}
+	}
+
+	const std::string script = absl::StrJoin(check.keys, " ", [](std::string* out, const Key& key) {
+		absl::StrAppendFormat(out, "%c%s", key.key, key.down ? "v" : "^");
+	});
+	const bool ok = presses == check.expected;
+	absl::PrintF("  %-5s %s: %s gives presses \"%s\", expected \"%s\"\n",
+		ok ? "ok" : "FAIL", check.name, script, presses, check.expected);
+	return ok;
+}
+
+}  // namespace
+
+
+bool RunKeyChecks()
+{
+	const std::vector<Case> cases = {
+		{"tap", {Down('A'), Up('A')}, "A"},
+		{"held with auto-repeat", {Down('A'), Down('A'), Down('A'), Down('A'), Up('A')}, "A"},
+		{"tapped twice", {Down('A'), Up('A'), Down('A'), Down('A'), Up('A')}, "AA"},
+		{"second key while the first repeats",
+			{Down('A'), Down('A'), Down('B'), Down('B'), Down('B'), Up('B'), Up('A')}, "AB"},
+		{"first key released while the second repeats",
+			{Down('A'), Down('B'), Up('A'), Down('B'), Down('B'), Up('B')}, "AB"},
+		{"first key pressed again while the second is held",
+			{Down('A'), Down('B'), Up('A'), Down('A'), Down('A'), Up('A'), Up('B')}, "ABA"},
+		{"release without a press", {Up('A'), Down('B'), Up('B')}, "B"},
+		{"rollover", {Down('A'), Down('B'), Down('C'), Up('A'), Up('B'), Down('C'), Up('C')}, "ABC"},
+	};
+
+	absl::PrintF("Key presses, where v is a key down and ^ a release:\n");
+	bool passed = true;
+	for(const Case& check : cases)
+	{
+		passed &= CheckCase(check);
+	}
+	return passed;
+}
+
+}  // namespace chiralscroll
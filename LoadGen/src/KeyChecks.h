@@ -0,0 +1,11 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Feeds scripted key presses, auto-repeats and releases of one and several
+// keys to the key press filter, and checks that only new presses get
+// through. Prints one line per check and returns whether all of them passed.
+bool RunKeyChecks();
+
+}  // namespace chiralscroll
@@ -0,0 +1,280 @@
+#include "MailboxChecks.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/time/time.h>
+
+#include "FrameMailbox.h"
+#include "PipelineStats.h"
+#include "Touchpad.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr int kRandomPosts = 100000;
+// Chance of handing the waiting frames to the gesture code after a post.
+static constexpr double kDrainChance = 0.1;
+// Contact IDs a random touchpad can have down at once.
+static constexpr ULONG kMaxContacts = 3;
+
+Touchpad::Contact Touch(ULONG id, ULONG x)
+{
+	return {id, 1, true, true, x, 100, static_cast<LONG>(x)*10, 1000};
+}
+
+Touchpad::Contact Lift(ULONG id, ULONG x)
+{
+	Touchpad::Contact contact = Touch(id, x);
+	contact.isTouch = false;
+	return contact;
+}
+
+// A frame is named by its touchpad and scan time in milliseconds. A frame
+// that replaced others is named by when the oldest of them was posted and
+// when the newest was scanned, e.g. A8..24.
+std::string FrameName(const FrameMailbox::Frame& frame, absl::Time epoch)
+{
+	const int64_t posted = absl::ToInt64Milliseconds(frame.posted - epoch);
+	const int64_t scanned = absl::ToInt64Milliseconds(frame.time - epoch);
+	return posted == scanned
+		? absl::StrFormat("%s%d", frame.device->name(), scanned)
+		: absl::StrFormat("%s%d..%d", frame.device->name(), posted, scanned);
+}
+
+struct Post
+{
+	// Index into the touchpads.
+	int device;
+	// Scan time, which is also when the frame is posted.
+	int ms;
+	std::vector<Touchpad::Contact> contacts;
+	// Whether the gesture code takes the waiting frames after this post.
+	bool drain = false;
+};
+
+struct Case
+{
+	std::string_view name;
+	FrameMailbox::Policy policy;
+	std::vector<Post> posts;
+	std::vector<std::string> expected;
+	uint64_t expectedShed;
+};
+
+bool CheckCase(const Case& check)
+{
+	const RecordedTouchpad devices[] = {{"A", {}}, {"B", {}}};
+	const absl::Time epoch = absl::UnixEpoch();
+	FrameMailbox mailbox(check.policy);
+	std::vector<std::string> delivered;
+	const auto drain = [&] {
+		mailbox.Drain([&](const FrameMailbox::Frame& frame) { delivered.push_back(FrameName(frame, epoch)); });
+	};
+
+	const uint64_t shedBefore = GetPipelineStats().shedFrames.value();
+	for(const Post& post : check.posts)
+	{
+		const absl::Time time = epoch + absl::Milliseconds(post.ms);
+		mailbox.Post(devices[post.device], post.contacts, time, time);
+		if(post.drain)
+		{
+			drain();
+		}
+	}
+	drain();
+	const uint64_t shed = GetPipelineStats().shedFrames.value() - shedBefore;
+
+	const bool ok = delivered == check.expected && shed == check.expectedShed;
+	if(ok)
+	{
+		absl::PrintF("  ok    %s: %s, %d shed\n", check.name, absl::StrJoin(delivered, " "), shed);
+	}
+	else
+	{
+		absl::PrintF("  FAIL  %s: got %s, %d shed, expected %s, %d shed\n", check.name,
+			absl::StrJoin(delivered, " "), shed, absl::StrJoin(check.expected, " "), check.expectedShed);
+	}
+	return ok;
+}
+
+bool CheckScripted()
+{
+	const auto kLatestWins = FrameMailbox::Policy::kLatestWins;
+	const std::vector<Post> oneFinger = {
+		{0, 0, {Touch(0, 100)}},
+		{0, 8, {Touch(0, 110)}},
+		{0, 16, {Touch(0, 120)}},
+		{0, 24, {Touch(0, 130)}},
+		{0, 32, {Lift(0, 130)}},
+	};
+	const std::vector<Case> cases = {
+		{"one finger", kLatestWins, oneFinger, {"A0", "A8..24", "A32"}, 2},
+		{"one finger, in order", FrameMailbox::Policy::kInOrder, oneFinger, {"A0", "A8", "A16", "A24", "A32"}, 0},
+		{"second finger down and up between moves", kLatestWins, {
+			{0, 0, {Touch(0, 100)}},
+			{0, 8, {Touch(0, 110)}},
+			{0, 16, {Touch(0, 120)}},
+			{0, 24, {Touch(0, 120), Touch(1, 500)}},
+			{0, 32, {Touch(0, 130), Touch(1, 510)}},
+			{0, 40, {Touch(0, 140), Touch(1, 520)}},
+			{0, 48, {Touch(0, 140), Lift(1, 520)}},
+			{0, 56, {Touch(0, 150)}},
+			{0, 64, {Touch(0, 160)}},
+			{0, 72, {Lift(0, 160)}},
+		}, {"A0", "A8..16", "A24", "A32..40", "A48", "A56..64", "A72"}, 3},
+		{"finger replaced without a lift", kLatestWins, {
+			{0, 0, {Touch(0, 100)}},
+			{0, 8, {Touch(1, 300)}},
+			{0, 16, {Touch(1, 310)}},
+			{0, 24, {Touch(1, 320)}},
+		}, {"A0", "A8", "A16..24"}, 1},
+		{"two touchpads interleaved", kLatestWins, {
+			{0, 0, {Touch(0, 100)}},
+			{1, 1, {Touch(0, 100)}},
+			{0, 8, {Touch(0, 110)}},
+			{1, 9, {Touch(0, 110)}},
+			{0, 16, {Touch(0, 120)}},
+			{1, 17, {Touch(0, 120)}},
+			{0, 24, {Lift(0, 120)}},
+			{1, 25, {Lift(0, 120)}},
+		}, {"A0", "B1", "A8..16", "B9..17", "A24", "B25"}, 2},
+		{"delivered between moves", kLatestWins, {
+			{0, 0, {Touch(0, 100)}},
+			{0, 8, {Touch(0, 110)}, true},
+			{0, 16, {Touch(0, 120)}},
+			{0, 24, {Touch(0, 130)}},
+			{0, 32, {Lift(0, 130)}},
+		}, {"A0", "A8", "A16..24", "A32"}, 1},
+	};
+
+	bool passed = true;
+	for(const Case& check : cases)
+	{
+		passed &= CheckCase(check);
+	}
+	return passed;
+}
+
+// Posts random frames of two touchpads, each touching down, lifting or moving
+// up to kMaxContacts contacts, and drains the mailbox at random.
+bool CheckRandom()
+{
+	const RecordedTouchpad devices[] = {{"A", {}}, {"B", {}}};
+	const absl::Time epoch = absl::UnixEpoch();
+	std::mt19937 random(1);
+	std::bernoulli_distribution drainNow(kDrainChance);
+	std::uniform_int_distribution<int> pickDevice(0, 1);
+	std::uniform_int_distribution<int> pickAction(0, 9);
+	std::uniform_int_distribution<ULONG> pickId(0, kMaxContacts - 1);
+
+	FrameMailbox mailbox(FrameMailbox::Policy::kLatestWins);
+	// The touching contacts of each touchpad.
+	std::vector<ULONG> touching[2];
+	// Frames in which a contact touched down or lifted, by scan time, in the
+	// order they were posted and the order they were delivered.
+	std::vector<int64_t> transitionsPosted;
+	std::vector<int64_t> transitionsDelivered;
+	absl::flat_hash_set<int64_t> transitions;
+	// The newest frame of each touchpad since the last drain.
+	absl::flat_hash_map<const Touchpad*, int64_t> newest;
+	int delivered = 0;
+	int newestMissed = 0;
+
+	const uint64_t shedBefore = GetPipelineStats().shedFrames.value();
+	for(int64_t ms = 0; ms < kRandomPosts; ++ms)
+	{
+		const int device = pickDevice(random);
+		std::vector<ULONG>& ids = touching[device];
+		const ULONG id = pickId(random);
+		const bool down = std::find(ids.begin(), ids.end(), id) == ids.end();
+		// Mostly moves, otherwise the picked contact touches down if it is
+		// not touching and lifts if it is.
+		const bool transition = ids.empty() || pickAction(random) < 3;
+		std::vector<Touchpad::Contact> contacts;
+		for(ULONG touchingId : ids)
+		{
+			const ULONG x = static_cast<ULONG>(ms % 1000);
+			contacts.push_back(transition && !down && touchingId == id ? Lift(touchingId, x) : Touch(touchingId, x));
+		}
+		if(transition)
+		{
+			if(down)
+			{
+				contacts.push_back(Touch(id, 0));
+				ids.push_back(id);
+			}
+			else
+			{
+				ids.erase(std::find(ids.begin(), ids.end(), id));
+			}
+			transitionsPosted.push_back(ms);
+			transitions.insert(ms);
+		}
+
+		const absl::Time time = epoch + absl::Milliseconds(ms);
+		mailbox.Post(devices[device], std::move(contacts), time, time);
+		newest[&devices[device]] = ms;
+
+		if(drainNow(random) || ms + 1 == kRandomPosts)
+		{
+			absl::flat_hash_set<int64_t> scans;
+			mailbox.Drain([&](const FrameMailbox::Frame& frame) {
+				const int64_t scan = absl::ToInt64Milliseconds(frame.time - epoch);
+				if(transitions.contains(scan))
+				{
+					transitionsDelivered.push_back(scan);
+				}
+				scans.insert(scan);
+				++delivered;
+			});
+			for(const auto& pair : newest)
+			{
+				newestMissed += scans.contains(pair.second) ? 0 : 1;
+			}
+			newest.clear();
+		}
+	}
+	const uint64_t shed = GetPipelineStats().shedFrames.value() - shedBefore;
+
+	bool passed = true;
+	const auto report = [&](bool ok, std::string_view what) {
+		absl::PrintF("  %-5s %s\n", ok ? "ok" : "FAIL", what);
+		passed &= ok;
+	};
+	report(transitionsDelivered == transitionsPosted, absl::StrFormat(
+		"%d of %d frames with a contact touching down or lifting delivered in order",
+		transitionsDelivered.size(), transitionsPosted.size()));
+	report(newestMissed == 0, absl::StrFormat(
+		"%d newest frames of a touchpad not delivered", newestMissed));
+	report(delivered + shed == kRandomPosts, absl::StrFormat(
+		"%d frames delivered and %d shed of %d posted", delivered, shed, kRandomPosts));
+	return passed;
+}
+
+}  // namespace
+
+
+bool RunMailboxChecks()
+{
+	bool passed = true;
+	absl::PrintF("Scripted frames:\n");
+	passed &= CheckScripted();
+	absl::PrintF("%d random frames of two touchpads:\n", kRandomPosts);
+	passed &= CheckRandom();
+	return passed;
+}
+
+}  // namespace chiralscroll
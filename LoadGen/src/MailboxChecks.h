@@ -0,0 +1,15 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Posts scripted frames of one and two touchpads to the latest-wins mailbox
+// and checks which frames are delivered, with which posting and scan times.
+// Then posts random touches, lifts and moves, and checks that every frame in
+// which a contact touches down or lifts is delivered in order, that the
+// newest frame of each touchpad is always delivered, and that every other
+// frame is counted as shed. Prints one line per check and returns whether
+// all of them passed.
+bool RunMailboxChecks();
+
+}  // namespace chiralscroll
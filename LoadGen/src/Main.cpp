@@ -0,0 +1,641 @@
+// Load generator and soak test for the input path.
+//
+// Synthesizes the decoded reports of several virtual touchpads at a high
+// report rate, with scrolls, multi-finger touches, bursts of held back
+// reports, and a fraction of corrupted frames, and feeds them through the
+// frame builders and gesture code for a long stretch of simulated time. It
+// measures the time spent per report and its tail, the CPU used per report,
+// the growth of the working set, and how many frames were lost, and fails if
+// memory keeps growing or frames are lost without being corrupted.
+//
+// The reports go through the touchpad decoder's contact decoding, which only
+// reads the fields the gesture code needs. With --verifyLazyFields, they are
+// also decoded with every field and assembled into frames as well, and the
+// run fails if the gesture code could tell any of them apart from the lazily
+// decoded ones.
+//
+// With --checkFrames, it instead replays scripted report sequences with lost,
+// reordered, duplicated and late reports, and checks the frame builder's
+// counts and the lifts it delivers. With --checkInjection, it drives the
+// injection watchdog with a sink that stalls on command, and checks the
+// switch to the fallback sink, coalescing, and the scroll counts. With
+// --checkRendering, it draws the settings window's touchpad control off
+// screen and compares it with the flood filled drawing it replaced. With
+// --checkTripleBuffer, it hammers the buffer that passes touch snapshots to
+// the settings window from two threads. With --checkKernels, it compares
+// the vectorized contact normalization with plain arithmetic. With
+// --checkCurves, it compares the acceleration curve table with the exact
+// curve, times a lookup, and reads a long curve back from a settings file.
+// With --checkTracker, it checks the contact tracker's deltas and stationary
+// frames, and that a finger's velocity does not depend on how its frames are
+// delivered. With --checkMailbox, it checks that the latest-wins mailbox only
+// sheds frames that move contacts, and keeps every touch down and lift. With
+// --checkNoise, it checks that the noise estimate converges on synthetic
+// jitter of a resting finger, and ignores everything else. With --checkKeys,
+// it checks that the key press filter drops auto-repeats and releases. With
+// --checkStats, it publishes statistics in a segment of its own and reads
+// them back the way StatsReader does.
+//
+// With --measureRealtime, it instead hands reports to the input path in real
+// time while another process keeps every core busy, and prints the latency
+// from handing over a report to injecting its scroll, first as the input
+// thread normally runs and then in real-time mode.
+//
+// Usage: LoadGen [flags]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <intrin.h>
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+#include <spdlog/spdlog.h>
+
+#include "ChiralScroll.h"
+#include "ChiralScrollException.h"
+#include "Clock.h"
+#include "CurveChecks.h"
+#include "FrameChecks.h"
+#include "FrameMailbox.h"
+#include "Generator.h"
+#include "HidUtils.h"
+#include "InjectionChecks.h"
+#include "KernelChecks.h"
+#include "KeyChecks.h"
+#include "MailboxChecks.h"
+#include "NoiseChecks.h"
+#include "PipelineStats.h"
+#include "ProcessInfo.h"
+#include "Profiler.h"
+#include "RealtimeLatency.h"
+#include "RenderChecks.h"
+#include "Scroller.h"
+#include "Settings.h"
+#include "StatsChecks.h"
+#include "TrackerChecks.h"
+#include "TripleBufferChecks.h"
+
+ABSL_FLAG(int, devices, 4, "Number of virtual touchpads.");
+ABSL_FLAG(double, rateHz, 1000.0, "Scans per second for each touchpad while touched.");
+ABSL_FLAG(absl::Duration, duration, absl::Minutes(30), "Simulated time to run for.");
+ABSL_FLAG(absl::Duration, progressInterval, absl::Minutes(1), "Simulated time between progress lines.");
+ABSL_FLAG(std::vector<std::string>, patterns, std::vector<std::string>({"scroll", "multi", "burst"}),
+	"Touch patterns to pick from: scroll, multi, or burst.");
+ABSL_FLAG(double, malformed, 0.001, "Fraction of scans to corrupt.");
+ABSL_FLAG(int, burstLength, 8, "Scans delivered together in a burst.");
+ABSL_FLAG(int, hybridContacts, 2,
+	"Contacts per report on every other touchpad, to exercise hybrid mode. 0 keeps every touchpad in parallel mode.");
+ABSL_FLAG(bool, inOrderFrames, false,
+	"Hand every frame of a burst to the gesture code, instead of skipping to the newest position.");
+ABSL_FLAG(uint32_t, seed, 1, "Seed for the generated input.");
+ABSL_FLAG(std::string, settings, "settings.ini", "Settings file to run with. Missing settings take the built-in defaults.");
+ABSL_FLAG(double, maxGrowthMb, 8.0, "Working set growth after the first progress interval at which the run fails.");
+ABSL_FLAG(bool, checkFrames, false,
+	"Instead of the load test, check frame assembly against scripted lost, reordered and duplicated reports.");
+ABSL_FLAG(bool, checkInjection, false,
+	"Instead of the load test, check the injection watchdog against a sink that stalls on command.");
+ABSL_FLAG(bool, checkRendering, false,
+	"Instead of the load test, check the touchpad control's drawing against the flood filled drawing it replaced.");
+ABSL_FLAG(bool, checkTripleBuffer, false,
+	"Instead of the load test, check the touch snapshot buffer from a writer and a reader thread.");
+ABSL_FLAG(bool, checkKernels, false,
+	"Instead of the load test, check the vectorized contact normalization against plain arithmetic.");
+ABSL_FLAG(bool, checkCurves, false,
+	"Instead of the load test, check the acceleration curve tables against the exact curves, time them, and read them back from settings.");
+ABSL_FLAG(bool, checkTracker, false,
+	"Instead of the load test, check the contact tracker's deltas and velocities, however the frames are delivered.");
+ABSL_FLAG(bool, checkMailbox, false,
+	"Instead of the load test, check which frames the latest-wins mailbox sheds and which it delivers.");
+ABSL_FLAG(bool, checkNoise, false,
+	"Instead of the load test, check that the noise estimate converges on synthetic jitter.");
+ABSL_FLAG(bool, checkKeys, false,
+	"Instead of the load test, check that the key press filter drops auto-repeats and releases.");
+ABSL_FLAG(bool, checkStats, false,
+	"Instead of the load test, check that statistics published in shared memory read back in another view.");
+ABSL_FLAG(bool, measureRealtime, false,
+	"Instead of the load test, measure the latency to injection with every core busy, without and with real-time mode.");
+ABSL_FLAG(absl::Duration, realtimePhase, absl::Minutes(1), "How long --measureRealtime measures each mode for.");
+ABSL_FLAG(bool, burnCpu, false, "Keep every core busy until killed. Started by --measureRealtime.");
+ABSL_FLAG(bool, verifyLazyFields, false,
+	"Also assemble frames from fully decoded reports, and fail if they differ from the lazily decoded frames.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr size_t kParallelContacts = 5;
+
+class CountingScroller : public Scroller
+{
+public:
+	explicit CountingScroller(int64_t& count) : count_(count) {}
+
+	void StartScrolling() override {}
+
+	void Scroll(int amt) override
+	{
+		++count_;
+	}
+
+	void StopScrolling() override {}
+
+private:
+	int64_t& count_;
+};
+
+double ToMicroseconds(uint64_t cycles)
+{
+	return CyclesToNanoseconds(cycles)/1000.0;
+}
+
+double ToMegabytes(size_t bytes)
+{
+	return static_cast<double>(bytes)/(1024*1024);
+}
+
+// Reads the fields of each contact of a generated report, as they would be
+// read from the HID report, for DecodeContacts.
+class GeneratedFields
+{
+public:
+	explicit GeneratedFields(const TouchDevice::FrameBuilder::Report& report) : contacts_(report.contacts) {}
+
+	size_t slotCount() const
+	{
+		return contacts_.size();
+	}
+
+	ULONG Link(size_t slot) const
+	{
+		return contacts_[slot].contactInfoLink;
+	}
+
+	NTSTATUS Id(size_t slot, ULONG* id) const
+	{
+		*id = contacts_[slot].id;
+		return HIDP_STATUS_SUCCESS;
+	}
+
+	NTSTATUS TipSwitch(size_t slot, bool* isTouch) const
+	{
+		*isTouch = contacts_[slot].isTouch;
+		return HIDP_STATUS_SUCCESS;
+	}
+
+	NTSTATUS Confidence(size_t slot, bool* confidence) const
+	{
+		*confidence = contacts_[slot].confidence;
+		return HIDP_STATUS_SUCCESS;
+	}
+
+	NTSTATUS Position(size_t slot, ULONG* x, ULONG* y) const
+	{
+		*x = contacts_[slot].logicalX;
+		*y = contacts_[slot].logicalY;
+		return HIDP_STATUS_SUCCESS;
+	}
+
+	NTSTATUS PhysicalPosition(size_t slot, LONG* x, LONG* y) const
+	{
+		*x = contacts_[slot].physicalX;
+		*y = contacts_[slot].physicalY;
+		return HIDP_STATUS_SUCCESS;
+	}
+
+private:
+	const std::vector<Touchpad::Contact>& contacts_;
+};
+
+// Decodes a generated report the way TouchDevice::GetContactsInReport
+// decodes an HID report, reading the fields the cache asks for.
+TouchDevice::FrameBuilder::Report Decode(const TouchDevice::FrameBuilder::Report& report, ContactFieldCache& cache)
+{
+	TouchDevice::FrameBuilder::Report decoded{report.contactCount, report.scanTime, {}};
+	THROW_IF_FALSE(DecodeContacts(GeneratedFields(report), cache, &decoded.contacts) == HIDP_STATUS_SUCCESS,
+		"Decoding a generated report");
+	return decoded;
+}
+
+// Whether the gesture code would see the same frame: the same time and the
+// same contacts in the same order, with the same tip switches and at the
+// same positions.
+bool SameForGestures(
+	const std::optional<TouchDevice::FrameBuilder::Frame>& full,
+	const std::optional<TouchDevice::FrameBuilder::Frame>& lazy)
+{
+	if(full.has_value() != lazy.has_value())
+	{
+		return false;
+	}
+	if(!full)
+	{
+		return true;
+	}
+	return full->time == lazy->time &&
+	       std::equal(full->contacts.begin(), full->contacts.end(), lazy->contacts.begin(), lazy->contacts.end(),
+		[](const Touchpad::Contact& a, const Touchpad::Contact& b) {
+			return a.id == b.id &&
+			       a.isTouch == b.isTouch &&
+			       a.logicalX == b.logicalX &&
+			       a.logicalY == b.logicalY;
+		});
+}
+
+std::optional<std::vector<ReportGenerator::Pattern>> ParsePatterns(const std::vector<std::string>& names)
+{
+	std::vector<ReportGenerator::Pattern> patterns;
+	for(const auto& name : names)
+	{
+		if(name == "scroll")
+		{
+			patterns.push_back(ReportGenerator::Pattern::kScroll);
+		}
+		else if(name == "multi")
+		{
+			patterns.push_back(ReportGenerator::Pattern::kMultiFinger);
+		}
+		else if(name == "burst")
+		{
+			patterns.push_back(ReportGenerator::Pattern::kBurst);
+		}
+		else
+		{
+			absl::FPrintF(stderr, "Unknown pattern %s.\n", name);
+			return std::nullopt;
+		}
+	}
+	if(patterns.empty())
+	{
+		absl::FPrintF(stderr, "No patterns given.\n");
+		return std::nullopt;
+	}
+	return patterns;
+}
+
+int Run()
+{
+	if(absl::GetFlag(FLAGS_burnCpu))
+	{
+		BurnCpu();
+	}
+	if(absl::GetFlag(FLAGS_measureRealtime))
+	{
+		const bool passed = RunRealtimeLatency(std::filesystem::absolute(absl::GetFlag(FLAGS_settings)),
+			absl::GetFlag(FLAGS_rateHz), absl::GetFlag(FLAGS_realtimePhase));
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkFrames))
+	{
+		const bool passed = RunFrameChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkInjection))
+	{
+		const bool passed = RunInjectionChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkRendering))
+	{
+		const bool passed = RunRenderChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkTripleBuffer))
+	{
+		const bool passed = RunTripleBufferChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkKernels))
+	{
+		const bool passed = RunKernelChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkCurves))
+	{
+		const bool passed = RunCurveChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkTracker))
+	{
+		const bool passed = RunTrackerChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkMailbox))
+	{
+		const bool passed = RunMailboxChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkNoise))
+	{
+		const bool passed = RunNoiseChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkKeys))
+	{
+		const bool passed = RunKeyChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+	if(absl::GetFlag(FLAGS_checkStats))
+	{
+		const bool passed = RunStatsChecks();
+		absl::PrintF(passed ? "PASS\n" : "FAIL\n");
+		return passed ? 0 : 1;
+	}
+
+	const std::optional<std::vector<ReportGenerator::Pattern>> patterns = ParsePatterns(absl::GetFlag(FLAGS_patterns));
+	const int deviceCount = absl::GetFlag(FLAGS_devices);
+	const double rateHz = absl::GetFlag(FLAGS_rateHz);
+	if(!patterns || deviceCount < 1 || rateHz <= 0.0)
+	{
+		absl::FPrintF(stderr, "%s\n", absl::ProgramUsageMessage());
+		return 1;
+	}
+	const double malformed = absl::GetFlag(FLAGS_malformed);
+	const int hybridContacts = absl::GetFlag(FLAGS_hybridContacts);
+	const bool verifyLazyFields = absl::GetFlag(FLAGS_verifyLazyFields);
+
+	std::vector<ReportGenerator> generators;
+	std::vector<TouchDevice::FrameBuilder> frameBuilders;
+	// Only used with verifyLazyFields.
+	std::vector<TouchDevice::FrameBuilder> fullFrameBuilders;
+	std::vector<ContactFieldCache> fieldCaches(deviceCount);
+	std::vector<ContactFieldCache> fullFieldCaches(deviceCount);
+	for(ContactFieldCache& cache : fullFieldCaches)
+	{
+		cache.SetDecodeAll(true);
+	}
+	std::vector<std::string> deviceNames;
+	generators.reserve(deviceCount);
+	frameBuilders.reserve(deviceCount);
+	fullFrameBuilders.reserve(deviceCount);
+	for(int i = 0; i < deviceCount; ++i)
+	{
+		ReportGenerator::Options options{
+			rateHz,
+			hybridContacts > 0 && i % 2 == 1 ? static_cast<size_t>(hybridContacts) : kParallelContacts,
+			*patterns,
+			malformed,
+			absl::GetFlag(FLAGS_burstLength),
+		};
+		generators.emplace_back(absl::StrFormat("LoadGen\\Touchpad%d", i), options, absl::GetFlag(FLAGS_seed) + i);
+		frameBuilders.emplace_back(generators.back().device().contactInfo().size(), false);
+		fullFrameBuilders.emplace_back(generators.back().device().contactInfo().size(), false);
+		deviceNames.push_back(std::string(generators.back().device().name()));
+	}
+
+	const Settings settings = Settings::FromFile(std::filesystem::absolute(absl::GetFlag(FLAGS_settings)), deviceNames);
+	const absl::Time epoch = absl::UnixEpoch();
+	VirtualClock clock(epoch);
+	int64_t scrollEvents = 0;
+	ChiralScroll chiralScroll(
+		settings,
+		std::make_unique<CountingScroller>(scrollEvents),
+		std::make_unique<CountingScroller>(scrollEvents),
+		clock);
+	// A burst stands in for WM_INPUT messages queued behind a slow frame, so
+	// frames wait in the mailbox until the whole burst has been assembled.
+	FrameMailbox mailbox(absl::GetFlag(FLAGS_inOrderFrames)
+		? FrameMailbox::Policy::kInOrder
+		: FrameMailbox::Policy::kLatestWins);
+	const auto deliverFrames = [&]() {
+		mailbox.Drain([&](const FrameMailbox::Frame& frame) {
+			chiralScroll.ProcessTouch(*frame.device, frame.contacts, frame.time);
+		});
+	};
+
+	// Each report is timed from handing it to the frame builder to the end
+	// of the gesture code, if it delivered frames.
+	Histogram reportCycles;
+	Histogram expireCycles;
+	int64_t reports = 0;
+	int64_t lazyMismatches = 0;
+	std::vector<TouchDevice::FrameBuilder::Report> batch;
+
+	const absl::Time end = epoch + absl::GetFlag(FLAGS_duration);
+	const absl::Duration progressInterval = absl::GetFlag(FLAGS_progressInterval);
+	absl::Time nextProgress = epoch + progressInterval;
+	size_t baselineWorkingSet = 0;
+	size_t peakWorkingSet = 0;
+	const absl::Time wallStart = absl::Now();
+	const absl::Duration cpuStart = ProcessCpuTime();
+
+	const auto frameCount = [&](auto field) {
+		int64_t total = 0;
+		for(const auto& frameBuilder : frameBuilders)
+		{
+			total += static_cast<int64_t>((frameBuilder.stats().*field).value());
+		}
+		return total;
+	};
+	const auto cpuPerReport = [&]() {
+		return reports == 0 ? 0.0 : absl::ToDoubleMicroseconds(ProcessCpuTime() - cpuStart)/static_cast<double>(reports);
+	};
+
+	absl::PrintF("%d touchpads at %.0fHz for %s of simulated time.\n",
+		deviceCount, rateHz, absl::FormatDuration(end - epoch));
+	while(true)
+	{
+		const auto next = std::min_element(generators.begin(), generators.end(),
+			[](const ReportGenerator& a, const ReportGenerator& b) {
+				return a.nextArrival() < b.nextArrival();
+			});
+		const absl::Time arrival = next->nextArrival();
+
+		while(nextProgress <= arrival && nextProgress <= end)
+		{
+			const size_t workingSet = WorkingSetBytes();
+			if(baselineWorkingSet == 0)
+			{
+				// Everything should have reached its steady size by now.
+				baselineWorkingSet = workingSet;
+			}
+			peakWorkingSet = std::max(peakWorkingSet, workingSet);
+			absl::PrintF("%8s  %10d reports  %6d dropped  p99 %6.1fus  max %7.1fus  %.2fus CPU/report  %.1fMB\n",
+				absl::FormatDuration(nextProgress - epoch),
+				reports,
+				frameCount(&FrameStats::droppedFrames),
+				ToMicroseconds(reportCycles.Percentile(99.0)),
+				ToMicroseconds(reportCycles.max()),
+				cpuPerReport(),
+				ToMegabytes(workingSet));
+			nextProgress += progressInterval;
+		}
+		if(arrival >= end)
+		{
+			break;
+		}
+
+		// Deliver frames that the frame timer would have flushed.
+		for(size_t device = 0; device < frameBuilders.size(); ++device)
+		{
+			const absl::Time deadline = frameBuilders[device].deadline();
+			if(deadline < arrival)
+			{
+				clock.Set(deadline);
+				const uint64_t start = __rdtsc();
+				auto frame = frameBuilders[device].Expire(deadline + absl::Nanoseconds(1));
+				fieldCaches[device].CheckLostFrames(frameBuilders[device].stats());
+				if(verifyLazyFields &&
+				   !SameForGestures(fullFrameBuilders[device].Expire(deadline + absl::Nanoseconds(1)), frame))
+				{
+					++lazyMismatches;
+				}
+				if(frame)
+				{
+					mailbox.Post(generators[device].device(), std::move(frame->contacts), frame->time, deadline);
+					deliverFrames();
+				}
+				expireCycles.Record(__rdtsc() - start);
+			}
+		}
+
+		clock.Set(arrival);
+		const size_t device = static_cast<size_t>(next - generators.begin());
+		next->Next(&batch);
+		for(size_t i = 0; i < batch.size(); ++i)
+		{
+			const TouchDevice::FrameBuilder::Report report = Decode(batch[i], fieldCaches[device]);
+			const uint64_t start = __rdtsc();
+			auto frames = frameBuilders[device].AddReport(report, arrival);
+			fieldCaches[device].CheckLostFrames(frameBuilders[device].stats());
+			if(verifyLazyFields)
+			{
+				const auto fullFrames = fullFrameBuilders[device].AddReport(Decode(batch[i], fullFieldCaches[device]), arrival);
+				if(!SameForGestures(fullFrames.flushed, frames.flushed) ||
+				   !SameForGestures(fullFrames.finished, frames.finished))
+				{
+					++lazyMismatches;
+				}
+			}
+			if(frames.flushed)
+			{
+				mailbox.Post(generators[device].device(), std::move(frames.flushed->contacts), frames.flushed->time, arrival);
+			}
+			if(frames.finished)
+			{
+				mailbox.Post(generators[device].device(), std::move(frames.finished->contacts), frames.finished->time, arrival);
+			}
+			if(i + 1 == batch.size() || mailbox.policy() == FrameMailbox::Policy::kInOrder)
+			{
+				deliverFrames();
+			}
+			reportCycles.Record(__rdtsc() - start);
+			++reports;
+		}
+	}
+
+	const absl::Duration wallTime = absl::Now() - wallStart;
+	const size_t finalWorkingSet = WorkingSetBytes();
+	peakWorkingSet = std::max(peakWorkingSet, finalWorkingSet);
+	if(baselineWorkingSet == 0)
+	{
+		baselineWorkingSet = finalWorkingSet;
+	}
+	int64_t scans = 0;
+	int64_t malformedScans = 0;
+	for(const auto& generator : generators)
+	{
+		scans += generator.scans();
+		malformedScans += generator.malformedScans();
+	}
+	const int64_t lostFrames = frameCount(&FrameStats::partialFrames) + frameCount(&FrameStats::droppedFrames) +
+		frameCount(&FrameStats::strayReports);
+	const double growthMb = ToMegabytes(finalWorkingSet) - ToMegabytes(baselineWorkingSet);
+
+	absl::PrintF("\nScans:        %d, %d corrupted\n", scans, malformedScans);
+	absl::PrintF("Reports:      %d in %.1fs, %.0f per second\n",
+		reports, absl::ToDoubleSeconds(wallTime), static_cast<double>(reports)/absl::ToDoubleSeconds(wallTime));
+	absl::PrintF("Frames:       %d, %d partial, %d dropped, %d merged, %d stray reports\n",
+		frameCount(&FrameStats::frames),
+		frameCount(&FrameStats::partialFrames),
+		frameCount(&FrameStats::droppedFrames),
+		frameCount(&FrameStats::mergedFrames),
+		frameCount(&FrameStats::strayReports));
+	absl::PrintF("Skipped:      %d frames shed, %d stationary\n",
+		GetPipelineStats().shedFrames.value(), GetPipelineStats().stationaryFrames.value());
+	absl::PrintF("Sessions:     %d scrolling, %d scroll events\n", GetPipelineStats().sessionsStarted.value(), scrollEvents);
+	absl::PrintF("CPU:          %.2fus per report\n", cpuPerReport());
+	absl::PrintF("Per report:   p50 %.1fus  p99 %.1fus  p99.9 %.1fus  max %.1fus\n",
+		ToMicroseconds(reportCycles.Percentile(50.0)),
+		ToMicroseconds(reportCycles.Percentile(99.0)),
+		ToMicroseconds(reportCycles.Percentile(99.9)),
+		ToMicroseconds(reportCycles.max()));
+	absl::PrintF("Expiry:       %d checks, p99 %.1fus  max %.1fus\n",
+		expireCycles.count(),
+		ToMicroseconds(expireCycles.Percentile(99.0)),
+		ToMicroseconds(expireCycles.max()));
+	absl::PrintF("Working set:  %.1fMB after warm-up, %.1fMB at the end, %.1fMB peak\n",
+		ToMegabytes(baselineWorkingSet), ToMegabytes(finalWorkingSet), ToMegabytes(peakWorkingSet));
+	if(verifyLazyFields)
+	{
+		absl::PrintF("Lazy fields:  %d frames differ from full decoding\n", lazyMismatches);
+	}
+
+	bool passed = true;
+	if(growthMb > absl::GetFlag(FLAGS_maxGrowthMb))
+	{
+		absl::PrintF("FAIL: working set grew by %.1fMB.\n", growthMb);
+		passed = false;
+	}
+	if(malformed <= 0.0 && lostFrames > 0)
+	{
+		absl::PrintF("FAIL: %d frames were lost without any corrupted input.\n", lostFrames);
+		passed = false;
+	}
+	if(lazyMismatches > 0)
+	{
+		absl::PrintF("FAIL: %d lazily decoded frames differ from full decoding.\n", lazyMismatches);
+		passed = false;
+	}
+	if(passed)
+	{
+		absl::PrintF("PASS\n");
+	}
+	return passed ? 0 : 1;
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int main(int argc, char* argv[])
+{
+	absl::SetProgramUsageMessage("Feeds synthetic touchpad input through the input path and measures it.\n"
+		"Usage: LoadGen [flags]");
+	absl::ParseCommandLine(argc, argv);
+
+	// Corrupted frames are expected and counted, not logged.
+	spdlog::set_level(spdlog::level::err);
+	try
+	{
+		return chiralscroll::Run();
+	}
+	catch(const std::exception& e)
+	{
+		absl::FPrintF(stderr, "Caught exception: %s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,167 @@
+#include "NoiseChecks.h"
+
+#include <cmath>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+
+#include "ContactTracker.h"
+#include "NoiseEstimator.h"
+#include "Touchpad.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr absl::Duration kScanPeriod = absl::Milliseconds(8);
+// Logical height of the touchpad, fine enough that rounding positions to
+// whole units hardly adds to the jitter.
+static constexpr LONG kHeight = 10000;
+static constexpr float kCenter = kHeight/2.0f;
+// Relative difference allowed from the jitter between frames.
+static constexpr float kTolerance = 0.1f;
+
+const std::vector<Touchpad::ContactInfo> kContactInfo = {
+	{1, {0, kHeight, 0, kHeight}, {0, 1000, 0, 1000}},
+};
+
+Touchpad::Contact Touch(ULONG id, float x, float y)
+{
+	return {id, 1, true, true,
+		static_cast<ULONG>(std::lround(x)), static_cast<ULONG>(std::lround(y)), 0, 0};
+}
+
+// Feeds the estimator frames of resting or moving fingers, as the gesture
+// code does.
+class Feed
+{
+public:
+	explicit Feed(float initialNoise = 0.0f)
+		: device_("Noise check device", kContactInfo),
+		  estimator_(initialNoise),
+		  random_(1),
+		  time_(absl::UnixEpoch()) {}
+
+	// Adds the given number of frames, with each finger resting at its
+	// position moved by step every frame, jittered by a normal distribution
+	// with the given deviation on each axis, in logical units.
+	void Add(int frames, int fingers, float deviation, float step = 0.0f, bool scrolling = false)
+	{
+		std::normal_distribution<float> jitter(0.0f, deviation);
+		for(int frame = 0; frame < frames; ++frame)
+		{
+			contacts_.clear();
+			for(int finger = 0; finger < fingers; ++finger)
+			{
+				const float x = kCenter + 1000.0f*finger + step*frame;
+				contacts_.push_back(Touch(finger, x + jitter(random_), kCenter + jitter(random_)));
+			}
+			tracker_.Update(contacts_, time_);
+			estimator_.Update(device_, tracker_, scrolling, time_);
+			time_ += kScanPeriod;
+		}
+	}
+
+	std::optional<float> noise() const
+	{
+		return estimator_.noise();
+	}
+
+private:
+	RecordedTouchpad device_;
+	ContactTracker tracker_;
+	NoiseEstimator estimator_;
+	std::mt19937 random_;
+	absl::Time time_;
+	std::vector<Touchpad::Contact> contacts_;
+};
+
+// The root mean square distance between two positions each jittered by the
+// given deviation on both axes, as a fraction of the touchpad height.
+float ExpectedNoise(float deviation)
+{
+	return 2.0f*deviation/kHeight;
+}
+
+std::string Format(const std::optional<float>& noise)
+{
+	return noise ? absl::StrFormat("%.6f", *noise) : "none";
+}
+
+bool CheckConverges(std::string_view name, const std::optional<float>& noise, float deviation)
+{
+	const float expected = ExpectedNoise(deviation);
+	const bool ok = noise && std::abs(*noise - expected) <= kTolerance*expected;
+	absl::PrintF("  %-5s %s: estimate %s, expected %.6f\n", ok ? "ok" : "FAIL", name, Format(noise), expected);
+	return ok;
+}
+
+bool CheckNoSamples(std::string_view name, const std::optional<float>& noise, const std::optional<float>& expected)
+{
+	const bool ok = noise == expected;
+	absl::PrintF("  %-5s %s: estimate %s, expected %s\n", ok ? "ok" : "FAIL", name, Format(noise), Format(expected));
+	return ok;
+}
+
+}  // namespace
+
+
+bool RunNoiseChecks()
+{
+	// Ten seconds of frames, enough to warm up and settle the weighted mean.
+	const int frames = static_cast<int>(absl::Seconds(10)/kScanPeriod);
+	bool passed = true;
+
+	absl::PrintF("A resting finger jittering by a normal distribution, for %s:\n",
+		absl::FormatDuration(frames*kScanPeriod));
+	for(const float deviation : {2.0f, 4.0f, 8.0f})
+	{
+		Feed feed;
+		feed.Add(frames, 1, deviation);
+		passed &= CheckConverges(absl::StrFormat("deviation %.0f of %d units", deviation, kHeight), feed.noise(), deviation);
+	}
+	{
+		// Twenty seconds on a much noisier surface, then back to a quiet one.
+		Feed feed(ExpectedNoise(8.0f));
+		feed.Add(2*frames, 1, 2.0f);
+		passed &= CheckConverges("from a stale estimate four times as large", feed.noise(), 2.0f);
+	}
+
+	absl::PrintF("Contacts that are not a resting lone finger:\n");
+	{
+		// Slow enough to stay under the noise limit between frames.
+		Feed feed;
+		feed.Add(frames, 1, 2.0f, 10.0f);
+		passed &= CheckNoSamples("slow drag", feed.noise(), std::nullopt);
+	}
+	{
+		Feed feed;
+		feed.Add(frames, 1, 2.0f, 0.0f, true);
+		passed &= CheckNoSamples("scrolling", feed.noise(), std::nullopt);
+	}
+	{
+		Feed feed;
+		feed.Add(frames, 2, 2.0f);
+		passed &= CheckNoSamples("two fingers", feed.noise(), std::nullopt);
+	}
+	{
+		// An estimate already made is left alone.
+		Feed feed;
+		feed.Add(frames, 1, 2.0f);
+		const std::optional<float> before = feed.noise();
+		feed.Add(frames, 1, 8.0f, 10.0f);
+		feed.Add(frames, 2, 8.0f);
+		passed &= CheckNoSamples("slow drag and two fingers after an estimate", feed.noise(), before);
+	}
+	return passed;
+}
+
+}  // namespace chiralscroll
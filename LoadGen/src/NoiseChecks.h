@@ -0,0 +1,13 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Feeds the noise estimator a resting finger with synthetic Gaussian jitter
+// of several sizes, and checks that the estimate converges on the jitter,
+// also from a stale earlier estimate. Checks that a slow drag, a scrolling
+// finger and two resting fingers give no samples. Prints one line per check
+// and returns whether all of them passed.
+bool RunNoiseChecks();
+
+}  // namespace chiralscroll
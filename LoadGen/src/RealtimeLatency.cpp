@@ -0,0 +1,344 @@
+#include "RealtimeLatency.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <intrin.h>
+#include <Windows.h>
+
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+
+#include "ChiralScroll.h"
+#include "ChiralScrollException.h"
+#include "Clock.h"
+#include "FrameMailbox.h"
+#include "Generator.h"
+#include "HidUtils.h"
+#include "Profiler.h"
+#include "Realtime.h"
+#include "Scroller.h"
+#include "Settings.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr char kDeviceName[] = "LoadGen\\RealtimeTouchpad";
+// Same as ChiralScrollDaemon's.
+static constexpr size_t kRealtimeHeadroomBytes = 16*1024*1024;
+// Injections in the first part of each phase are not counted, while the
+// caches and the scheduler settle.
+static constexpr absl::Duration kWarmUp = absl::Seconds(2);
+// Room for the reports of a long stall, so that handing them over does not
+// allocate.
+static constexpr size_t kMaxPendingReports = 4096;
+
+using Report = TouchDevice::FrameBuilder::Report;
+
+// A report, when the generator has it arrive, and the cycle count when it
+// was handed to the input thread.
+struct PendingReport
+{
+	Report report;
+	absl::Time arrival;
+	uint64_t handedOver;
+};
+
+// Records the latency of every injection, from when the report that caused it
+// was handed over.
+class LatencyScroller : public Scroller
+{
+public:
+	LatencyScroller(const uint64_t& handedOver, const bool& measuring, Histogram& latency)
+		: handedOver_(handedOver), measuring_(measuring), latency_(latency) {}
+
+	void StartScrolling() override {}
+
+	void Scroll(int amt) override
+	{
+		if(measuring_)
+		{
+			latency_.Record(__rdtsc() - handedOver_);
+		}
+	}
+
+	void StopScrolling() override {}
+
+private:
+	const uint64_t& handedOver_;
+	const bool& measuring_;
+	Histogram& latency_;
+};
+
+// The process that keeps every core busy, killed with its job when this
+// goes away.
+class BusyLoad
+{
+public:
+	static std::optional<BusyLoad> Start()
+	{
+		std::wstring path(MAX_PATH, '\0');
+		path.resize(GetModuleFileName(nullptr, path.data(), static_cast<DWORD>(path.size())));
+		std::wstring commandLine = L"\"" + path + L"\" --burnCpu";
+
+		const HANDLE job = CreateJobObject(nullptr, nullptr);
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+		limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+		if(!job || !SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits)))
+		{
+			absl::FPrintF(stderr, "Could not create a job for the load: %s\n", GetErrorMessage(GetLastError()));
+			if(job)
+			{
+				CloseHandle(job);
+			}
+			return std::nullopt;
+		}
+
+		STARTUPINFO startupInfo{};
+		startupInfo.cb = sizeof(startupInfo);
+		PROCESS_INFORMATION processInfo{};
+		if(!CreateProcess(path.c_str(), commandLine.data(), nullptr, nullptr, false, CREATE_SUSPENDED,
+			nullptr, nullptr, &startupInfo, &processInfo))
+		{
+			absl::FPrintF(stderr, "Could not start the load: %s\n", GetErrorMessage(GetLastError()));
+			CloseHandle(job);
+			return std::nullopt;
+		}
+		// In the job before it runs, so that it cannot outlive this process.
+		AssignProcessToJobObject(job, processInfo.hProcess);
+		ResumeThread(processInfo.hThread);
+		CloseHandle(processInfo.hThread);
+		CloseHandle(processInfo.hProcess);
+		return BusyLoad(job);
+	}
+
+	BusyLoad(BusyLoad&& other) noexcept : job_(std::exchange(other.job_, nullptr)) {}
+	BusyLoad& operator=(BusyLoad&&) = delete;
+	BusyLoad(const BusyLoad&) = delete;
+	BusyLoad& operator=(const BusyLoad&) = delete;
+
+	~BusyLoad()
+	{
+		if(job_)
+		{
+			CloseHandle(job_);
+		}
+	}
+
+private:
+	explicit BusyLoad(HANDLE job) : job_(job) {}
+
+	HANDLE job_;
+};
+
+struct PhaseResult
+{
+	Histogram latency;
+	int64_t reports = 0;
+	uint64_t pageFaults = 0;
+	// Reports that were handed over while the input thread was still busy
+	// with earlier ones.
+	int64_t backedUp = 0;
+	// Whether real-time mode was asked for and could not be entered.
+	bool realtimeFailed = false;
+};
+
+// Generates the reports of one touchpad scrolling for the given time, hands
+// them to the calling thread as they fall due in real time, and feeds them
+// through frame assembly and the gesture code, which inject into a
+// LatencyScroller.
+PhaseResult MeasurePhase(const Settings& settings, double rateHz, absl::Duration duration, bool realtime)
+{
+	ReportGenerator generator(kDeviceName, {rateHz, 5, {ReportGenerator::Pattern::kScroll}, 0.0, 1}, 1);
+	TouchDevice::FrameBuilder frameBuilder(generator.device().contactInfo().size(), false);
+	const absl::Time epoch = absl::UnixEpoch();
+	VirtualClock clock(epoch);
+	PhaseResult result;
+	uint64_t handedOver = 0;
+	bool measuring = false;
+	ChiralScroll chiralScroll(
+		settings,
+		std::make_unique<LatencyScroller>(handedOver, measuring, result.latency),
+		std::make_unique<LatencyScroller>(handedOver, measuring, result.latency),
+		clock);
+	FrameMailbox mailbox(FrameMailbox::Policy::kLatestWins);
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<PendingReport> pending;
+	std::vector<PendingReport> taken;
+	pending.reserve(kMaxPendingReports);
+	taken.reserve(kMaxPendingReports);
+	bool done = false;
+
+	if(realtime)
+	{
+		// Everything on the input path exists by now.
+		const bool entered = EnterRealtimeMode(kRealtimeHeadroomBytes);
+		result.realtimeFailed = !SetRealtimeThread(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL, -1) || !entered;
+	}
+	PageFaultMonitor pageFaults;
+
+	std::thread producer([&] {
+		// Input is delivered by the kernel, ahead of any user thread.
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+		const HANDLE timer = CreateWaitableTimerEx(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		std::vector<Report> batch;
+		const absl::Time start = absl::Now();
+		while(generator.nextArrival() < epoch + duration)
+		{
+			const absl::Duration wait = start + (generator.nextArrival() - epoch) - absl::Now();
+			if(wait > absl::ZeroDuration())
+			{
+				LARGE_INTEGER dueTime;
+				// Relative, in 100ns units.
+				dueTime.QuadPart = -std::max<int64_t>(1, absl::ToInt64Nanoseconds(wait)/100);
+				if(!timer || !SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, false) ||
+				   WaitForSingleObject(timer, INFINITE) != WAIT_OBJECT_0)
+				{
+					absl::SleepFor(wait);
+				}
+			}
+			const absl::Time arrival = generator.nextArrival();
+			generator.Next(&batch);
+			std::lock_guard<std::mutex> lock(mutex);
+			const uint64_t now = __rdtsc();
+			for(Report& report : batch)
+			{
+				if(pending.size() < kMaxPendingReports)
+				{
+					pending.push_back({std::move(report), arrival, now});
+				}
+			}
+			wake.notify_one();
+		}
+		if(timer)
+		{
+			CloseHandle(timer);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		wake.notify_one();
+	});
+
+	// The input thread.
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return done || !pending.empty(); });
+			if(pending.empty())
+			{
+				break;
+			}
+			std::swap(pending, taken);
+		}
+		for(PendingReport& item : taken)
+		{
+			// The gesture code runs on the generator's times, so that it sees
+			// the same input in both phases however late it runs.
+			clock.Set(item.arrival);
+			handedOver = item.handedOver;
+			measuring = item.arrival >= epoch + kWarmUp;
+			auto frames = frameBuilder.AddReport(item.report, item.arrival);
+			if(frames.flushed)
+			{
+				mailbox.Post(generator.device(), std::move(frames.flushed->contacts), frames.flushed->time, item.arrival);
+			}
+			if(frames.finished)
+			{
+				mailbox.Post(generator.device(), std::move(frames.finished->contacts), frames.finished->time, item.arrival);
+			}
+			mailbox.Drain([&](const FrameMailbox::Frame& frame) {
+				chiralScroll.ProcessTouch(*frame.device, frame.contacts, frame.time);
+			});
+			++result.reports;
+		}
+		result.backedUp += taken.size() > 1 ? static_cast<int64_t>(taken.size() - 1) : 0;
+		taken.clear();
+	}
+	producer.join();
+	result.pageFaults = pageFaults.Check();
+	return result;
+}
+
+void PrintPhase(std::string_view name, const PhaseResult& result)
+{
+	const auto us = [](uint64_t cycles) {
+		return CyclesToNanoseconds(cycles)/1000.0;
+	};
+	absl::PrintF("  %-9s %8d reports %8d injections  p50 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus  %d backed up  %d page faults\n",
+		name,
+		result.reports,
+		result.latency.count(),
+		us(result.latency.Percentile(50.0)),
+		us(result.latency.Percentile(99.0)),
+		us(result.latency.Percentile(99.9)),
+		us(result.latency.max()),
+		result.backedUp,
+		result.pageFaults);
+}
+
+}  // namespace
+
+
+bool RunRealtimeLatency(const std::filesystem::path& settingsPath, double rateHz, absl::Duration phase)
+{
+	const Settings settings = Settings::FromFile(settingsPath, {kDeviceName});
+	// Start calibrating the cycle counter before anything is timed.
+	CyclesToNanoseconds(0);
+
+	std::optional<BusyLoad> load = BusyLoad::Start();
+	if(!load)
+	{
+		return false;
+	}
+	absl::PrintF("Report to injection latency at %.0fHz with %d busy threads, %s per phase:\n",
+		rateHz, std::thread::hardware_concurrency(), absl::FormatDuration(phase));
+	// Real-time mode cannot be left again, so it goes second.
+	const PhaseResult normal = MeasurePhase(settings, rateHz, phase, false);
+	PrintPhase("normal", normal);
+	const PhaseResult realtime = MeasurePhase(settings, rateHz, phase, true);
+	PrintPhase("realtime", realtime);
+	if(realtime.realtimeFailed)
+	{
+		absl::PrintF("FAIL: real-time mode could not be entered fully.\n");
+	}
+	return !realtime.realtimeFailed && normal.latency.count() > 0 && realtime.latency.count() > 0;
+}
+
+void BurnCpu()
+{
+	std::vector<std::thread> threads;
+	for(unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i)
+	{
+		threads.emplace_back([] {
+			volatile uint64_t spin = 0;
+			while(true)
+			{
+				++spin;
+			}
+		});
+	}
+	for(std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	std::abort();
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+
+#include <absl/time/time.h>
+
+namespace chiralscroll
+{
+
+// Measures the time from a touchpad's reports being handed to the input
+// thread to the scroll being injected, while another process keeps every core
+// busy. Reports are generated at rateHz in real time on a separate thread,
+// which stands in for the kernel delivering input. The first phase runs the
+// input thread as the application normally does, the second after
+// EnterRealtimeMode, with the input thread time critical like ChiralScroll
+// --realtime. Prints the latency percentiles and page faults of each phase,
+// and returns false if the load or real-time mode could not be set up.
+bool RunRealtimeLatency(const std::filesystem::path& settingsPath, double rateHz, absl::Duration phase);
+
+// Spins a thread on every core until the process is killed. Run in the
+// process that RunRealtimeLatency starts as its load.
+[[noreturn]] void BurnCpu();
+
+}  // namespace chiralscroll
@@ -0,0 +1,216 @@
+#include "RenderChecks.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+#include <wx/app.h>
+#include <wx/bitmap.h>
+#include <wx/brush.h>
+#include <wx/dcbuffer.h>
+#include <wx/dcmemory.h>
+#include <wx/frame.h>
+#include <wx/image.h>
+#include <wx/init.h>
+#include <wx/pen.h>
+#include <wx/region.h>
+
+#include "TouchpadCtrl.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// The same as TouchpadCtrl's.
+static constexpr int kCornerSize = 13;
+
+struct Case
+{
+	wxSize size;
+	float vScrollZone;
+	float hScrollZone;
+	bool enabled;
+};
+
+// Starts and stops wxWidgets for a console program, so that windows can be
+// created without showing them.
+class WxSession
+{
+public:
+	WxSession()
+	{
+		wxApp::SetInstance(new wxApp());
+		int argc = 0;
+		ok_ = wxEntryStart(argc, static_cast<wxChar**>(nullptr)) && wxTheApp->CallOnInit();
+	}
+
+	~WxSession()
+	{
+		wxEntryCleanup();
+	}
+
+	bool ok() const
+	{
+		return ok_;
+	}
+
+private:
+	bool ok_;
+};
+
+// How TouchpadCtrl drew before it cached its background: clipped to a region
+// rasterized from the outline, with the zones flood filled up to their
+// outlines. Kept as it was, including leaving the pen to the DC's default.
+wxBitmap RenderFloodFilled(const Case& c, const wxColour& background)
+{
+	const wxSize size = c.size;
+	const int width = size.GetWidth();
+	const int height = size.GetHeight();
+
+	wxBitmap mask(size, 1);
+	{
+		wxMemoryDC dc(mask);
+		dc.SetBackground(*wxBLACK_BRUSH);
+		dc.Clear();
+		dc.SetPen(*wxWHITE_PEN);
+		dc.SetBrush(*wxWHITE_BRUSH);
+		dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
+	}
+	const wxRegion clippingRegion(mask, *wxBLACK);
+
+	wxBitmap bitmap(size);
+	wxMemoryDC dc(bitmap);
+	dc.SetBackground(wxBrush(background));
+	dc.Clear();
+
+	wxBrush touchpadBrush = *wxGREY_BRUSH;
+	wxBrush vZoneBrush = *wxGREEN_BRUSH;
+	vZoneBrush.SetStyle(wxBRUSHSTYLE_FDIAGONAL_HATCH);
+	wxBrush hZoneBrush = *wxRED_BRUSH;
+	hZoneBrush.SetStyle(wxBRUSHSTYLE_BDIAGONAL_HATCH);
+
+	dc.SetDeviceClippingRegion(clippingRegion);
+	dc.SetBrush(touchpadBrush);
+	dc.SetPen(wxNullPen);
+	dc.DrawRoundedRectangle(wxPoint{0, 0}, size, kCornerSize);
+	if(!c.enabled)
+	{
+		return bitmap;
+	}
+
+	const int vScrollZone = static_cast<int>(width*(1 - c.vScrollZone));
+	const int hScrollZone = static_cast<int>(height*(1 - c.hScrollZone));
+	const wxPoint vScrollTopLeft{vScrollZone, 0};
+	const wxPoint vScrollBottomRight{width, height};
+	const wxPoint vScrollBottomLeft{vScrollZone, height};
+	const wxPoint hScrollTopLeft{0, hScrollZone};
+	const wxPoint hScrollBottomRight{vScrollZone, height};
+	const wxPoint hScrollTopRight{vScrollZone, hScrollZone};
+	if(c.hScrollZone > 0)
+	{
+		dc.SetPen(*wxRED_PEN);
+		dc.DrawLine(hScrollTopLeft, hScrollTopRight);
+	}
+	if(c.vScrollZone > 0)
+	{
+		dc.SetPen(*wxGREEN_PEN);
+		dc.DrawLine(vScrollTopLeft, vScrollBottomLeft);
+	}
+	if(c.hScrollZone > 0)
+	{
+		dc.SetBrush(hZoneBrush);
+		dc.FloodFill((hScrollTopLeft + hScrollBottomRight)/2, touchpadBrush.GetColour());
+	}
+	if(c.vScrollZone > 0)
+	{
+		dc.SetBrush(vZoneBrush);
+		dc.FloodFill((vScrollTopLeft + vScrollBottomRight)/2, touchpadBrush.GetColour());
+	}
+	return bitmap;
+}
+
+// Draws the control the way OnPaint does, through a back buffer.
+wxBitmap RenderBuffered(TouchpadCtrl& ctrl, wxSize size)
+{
+	wxBitmap bitmap(size);
+	{
+		wxMemoryDC target(bitmap);
+		wxBufferedDC dc(&target, size);
+		ctrl.Render(dc);
+	}
+	return bitmap;
+}
+
+int64_t CountDifferentPixels(const wxBitmap& a, const wxBitmap& b)
+{
+	const wxImage imageA = a.ConvertToImage();
+	const wxImage imageB = b.ConvertToImage();
+	const unsigned char* dataA = imageA.GetData();
+	const unsigned char* dataB = imageB.GetData();
+	const int64_t pixels = static_cast<int64_t>(imageA.GetWidth())*imageA.GetHeight();
+	int64_t different = 0;
+	for(int64_t i = 0; i < pixels; ++i)
+	{
+		if(dataA[3*i] != dataB[3*i] || dataA[3*i + 1] != dataB[3*i + 1] || dataA[3*i + 2] != dataB[3*i + 2])
+		{
+			++different;
+		}
+	}
+	return different;
+}
+
+}  // namespace
+
+
+bool RunRenderChecks()
+{
+	WxSession session;
+	if(!session.ok())
+	{
+		absl::PrintF("  FAIL  could not start wxWidgets\n");
+		return false;
+	}
+
+	const std::vector<Case> cases = {
+		{{200, 120}, 0.1f, 0.1f, true},
+		{{200, 120}, 0.0f, 0.0f, true},
+		{{200, 120}, 0.35f, 0.0f, true},
+		{{200, 120}, 0.0f, 0.5f, true},
+		{{200, 120}, 0.1f, 0.1f, false},
+		{{151, 97}, 0.1f, 0.1f, true},
+		{{151, 97}, 0.02f, 0.9f, true},
+		{{40, 30}, 0.5f, 0.5f, true},
+	};
+
+	bool passed = true;
+	absl::PrintF("TouchpadCtrl rendering against flood filling:\n");
+	wxFrame* frame = new wxFrame(nullptr, wxID_ANY, "RenderChecks");
+	TouchpadCtrl* ctrl = new TouchpadCtrl(frame);
+	for(const Case& c : cases)
+	{
+		ctrl->SetSize(c.size);
+		ctrl->SetValue(c.vScrollZone, c.hScrollZone);
+		ctrl->Enable(c.enabled);
+		const wxBitmap expected = RenderFloodFilled(c, ctrl->GetBackgroundColour());
+		// The second draw reuses the background cached by the first.
+		const int64_t first = CountDifferentPixels(RenderBuffered(*ctrl, c.size), expected);
+		const int64_t cached = CountDifferentPixels(RenderBuffered(*ctrl, c.size), expected);
+		const bool ok = first == 0 && cached == 0;
+		absl::PrintF("  %-4s  %dx%d, zones %.2f and %.2f, %s: %d and %d pixels differ\n",
+			ok ? "ok" : "FAIL",
+			c.size.GetWidth(),
+			c.size.GetHeight(),
+			c.vScrollZone,
+			c.hScrollZone,
+			c.enabled ? "enabled" : "disabled",
+			first,
+			cached);
+		passed &= ok;
+	}
+	frame->Destroy();
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Draws TouchpadCtrl through a back buffer at several sizes, zone widths and
+// enabled states, twice each so the second draw comes from the cached
+// background, and compares the pixels with the flood filled rendering it
+// replaced. Prints one line per case and returns whether all of them matched.
+bool RunRenderChecks();
+
+}  // namespace chiralscroll
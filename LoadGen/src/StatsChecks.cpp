@@ -0,0 +1,153 @@
+#include "StatsChecks.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <Windows.h>
+
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "StatsSegment.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Like the name ChiralScroll publishes under, but unique to this process so
+// that the check does not collide with a running ChiralScroll.
+std::wstring SegmentName(std::wstring_view suffix)
+{
+	return std::wstring(kStatsSegmentName) + L"Check-" + std::to_wstring(GetCurrentProcessId()) + std::wstring(suffix);
+}
+
+std::string DeviceName(size_t index)
+{
+	// The first name is too long for its slot and has to be cut off.
+	return index == 0
+		? std::string(SharedStats::kMaxNameLength + 44, 'x')
+		: absl::StrCat("Check touchpad ", index);
+}
+
+std::string_view SlotName(const std::string& name)
+{
+	return std::string_view(name).substr(0, SharedStats::kMaxNameLength - 1);
+}
+
+}  // namespace
+
+
+bool RunStatsChecks()
+{
+	bool passed = true;
+	const auto report = [&](bool ok, std::string_view what) {
+		absl::PrintF("  %-5s %s\n", ok ? "ok" : "FAIL", what);
+		passed &= ok;
+	};
+
+	const std::wstring name = SegmentName(L"");
+	report(!StatsSegment::Open(name.c_str()), "nothing to open before the segment is created");
+	std::optional<StatsSegment> writer = StatsSegment::Create(name.c_str());
+	report(writer.has_value(), "segment created");
+	if(!writer)
+	{
+		return false;
+	}
+	report(!StatsSegment::Create(name.c_str()), "a second instance cannot create it");
+
+	// Fill in every device slot and some of the statistics, with values that
+	// differ between devices and counters.
+	std::array<FrameStats*, SharedStats::kMaxDevices> frames = {};
+	bool added = true;
+	for(size_t i = 0; i < frames.size(); ++i)
+	{
+		frames[i] = writer->AddDevice(DeviceName(i));
+		added &= frames[i] != nullptr;
+	}
+	report(added && !writer->AddDevice("One touchpad too many"),
+		absl::StrFormat("%d devices added, and one more refused", frames.size()));
+	for(size_t i = 0; added && i < frames.size(); ++i)
+	{
+		frames[i]->reports.Add(1000 + i);
+		frames[i]->frames.Add(500 + i);
+		frames[i]->droppedFrames.Add(i);
+		frames[i]->quarantines.Add(2*i);
+	}
+	PipelineStats& pipeline = writer->stats().pipeline;
+	pipeline.sessionsStarted.Add(7);
+	pipeline.shedFrames.Add(11);
+	pipeline.exceptions.Add(3);
+	Histogram expectedDecode;
+	for(uint64_t cycles = 1000; cycles <= 100000; cycles += 1000)
+	{
+		pipeline.decode.Record(cycles);
+		expectedDecode.Record(cycles);
+	}
+
+	std::optional<StatsSegment> reader = StatsSegment::Open(name.c_str());
+	report(reader.has_value(), "segment opened by a reader");
+	if(!reader)
+	{
+		return false;
+	}
+	const SharedStats& shared = reader->stats();
+	report(&shared != &writer->stats(), "the reader has a view of its own");
+	report(shared.version == SharedStats::kVersion && shared.processId == GetCurrentProcessId(),
+		absl::StrFormat("version %d and process %d", shared.version, shared.processId));
+
+	const uint32_t deviceCount = shared.deviceCount.load(std::memory_order_acquire);
+	bool devicesMatch = deviceCount == SharedStats::kMaxDevices;
+	for(uint32_t i = 0; devicesMatch && i < deviceCount; ++i)
+	{
+		const SharedStats::Device& device = shared.devices[i];
+		devicesMatch &= std::string_view(device.name.data()) == SlotName(DeviceName(i)) &&
+			device.frames.reports.value() == 1000 + i &&
+			device.frames.frames.value() == 500 + i &&
+			device.frames.droppedFrames.value() == i &&
+			device.frames.quarantines.value() == 2*i &&
+			device.frames.partialFrames.value() == 0;
+	}
+	report(devicesMatch, absl::StrFormat("%d device names and counters read back, the long name cut to %d characters",
+		deviceCount, SlotName(DeviceName(0)).size()));
+
+	const PipelineStats& readPipeline = shared.pipeline;
+	report(readPipeline.sessionsStarted.value() == 7 && readPipeline.shedFrames.value() == 11 &&
+		readPipeline.exceptions.value() == 3 && readPipeline.scrollEvents.value() == 0,
+		"pipeline counters read back");
+	bool histogramMatches = readPipeline.decode.count() == expectedDecode.count() &&
+		readPipeline.decode.max() == expectedDecode.max();
+	for(const double percentile : {50.0, 99.0, 99.9})
+	{
+		histogramMatches &= readPipeline.decode.Percentile(percentile) == expectedDecode.Percentile(percentile);
+	}
+	report(histogramMatches, absl::StrFormat("decode histogram of %d samples read back, p50 %d cycles",
+		readPipeline.decode.count(), readPipeline.decode.Percentile(50.0)));
+
+	// Counts made after the reader opened the segment show up as well.
+	frames[1]->reports.Add(5);
+	pipeline.shedFrames.Add(1);
+	report(shared.devices[1].frames.reports.value() == 1006 && readPipeline.shedFrames.value() == 12,
+		"later counts seen by the open reader");
+
+	reader.reset();
+	writer.reset();
+	report(!StatsSegment::Open(name.c_str()), "gone once the writer and reader close it");
+
+	// A segment laid out by another version of ChiralScroll.
+	const std::wstring otherName = SegmentName(L"-other");
+	std::optional<StatsSegment> other = StatsSegment::Create(otherName.c_str());
+	if(other)
+	{
+		other->stats().version = SharedStats::kVersion + 1;
+	}
+	report(other && !StatsSegment::Open(otherName.c_str()), "a segment of another version is refused");
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Creates a statistics segment under a name of its own, fills in devices,
+// counters and histograms through it, and checks that a reader opening the
+// segment separately sees all of them. Checks that a second instance cannot
+// create the segment, that devices past the last slot are refused, and that
+// a reader refuses a segment of another version. Prints one line per check
+// and returns whether all of them passed.
+bool RunStatsChecks();
+
+}  // namespace chiralscroll
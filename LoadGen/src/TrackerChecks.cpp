@@ -0,0 +1,259 @@
+#include "TrackerChecks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/time/time.h>
+
+#include "ContactTracker.h"
+#include "FrameMailbox.h"
+#include "HidUtils.h"
+#include "Touchpad.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+using Type = ContactDelta::Type;
+
+static constexpr absl::Duration kScanPeriod = absl::Milliseconds(8);
+// The moving finger's step per scan, in logical units.
+static constexpr ULONG kStep = 80;
+static constexpr int kScans = 6;
+// Relative difference allowed from the velocity of the finger.
+static constexpr float kTolerance = 0.001f;
+
+Touchpad::Contact Touch(ULONG id, ULONG x)
+{
+	return {id, 1, true, true, x, 100, static_cast<LONG>(x)*10, 1000};
+}
+
+Touchpad::Contact Lift(ULONG id, ULONG x)
+{
+	Touchpad::Contact contact = Touch(id, x);
+	contact.isTouch = false;
+	return contact;
+}
+
+std::string_view TypeName(Type type)
+{
+	switch(type)
+	{
+	case Type::kDown:
+		return "down";
+	case Type::kMove:
+		return "move";
+	case Type::kUnchanged:
+		return "unchanged";
+	case Type::kUp:
+		return "up";
+	}
+	return "?";
+}
+
+struct Step
+{
+	std::string_view name;
+	std::vector<Touchpad::Contact> contacts;
+	std::vector<Type> types;
+	bool stationary;
+};
+
+bool CheckDeltas()
+{
+	const std::vector<Step> steps = {
+		{"touch down", {Touch(0, 100)}, {Type::kDown}, false},
+		{"same position", {Touch(0, 100)}, {Type::kUnchanged}, true},
+		{"move", {Touch(0, 180)}, {Type::kMove}, false},
+		{"second finger down", {Touch(0, 180), Touch(1, 500)}, {Type::kUnchanged, Type::kDown}, false},
+		{"both still", {Touch(0, 180), Touch(1, 500)}, {Type::kUnchanged, Type::kUnchanged}, true},
+		{"second finger missing", {Touch(0, 180)}, {Type::kUnchanged}, false},
+		{"one finger still", {Touch(0, 180)}, {Type::kUnchanged}, true},
+		{"lift", {Lift(0, 180)}, {Type::kUp}, false},
+		{"nothing touching", {}, {}, true},
+		{"touch down again", {Touch(0, 300)}, {Type::kDown}, false},
+	};
+
+	bool passed = true;
+	ContactTracker tracker;
+	absl::Time time = absl::UnixEpoch();
+	for(const Step& step : steps)
+	{
+		tracker.Update(step.contacts, time);
+		time += kScanPeriod;
+		std::vector<Type> types;
+		for(const ContactDelta& delta : tracker.deltas())
+		{
+			types.push_back(delta.type);
+		}
+		const auto format = [](const std::vector<Type>& types, bool stationary) {
+			return absl::StrFormat("[%s]%s",
+				absl::StrJoin(types, " ", [](std::string* out, Type type) { out->append(TypeName(type)); }),
+				stationary ? " stationary" : "");
+		};
+		bool ok = types == step.types && tracker.stationary() == step.stationary;
+		// A contact the frame has is found by its ID, one it lacks is not.
+		for(const Touchpad::Contact& contact : step.contacts)
+		{
+			const ContactDelta* delta = tracker.Find(contact.id);
+			ok &= delta != nullptr && delta->contact.logicalX == contact.logicalX;
+		}
+		ok &= tracker.Find(7) == nullptr;
+		if(ok)
+		{
+			absl::PrintF("  ok    %s: %s\n", step.name, format(types, tracker.stationary()));
+		}
+		else
+		{
+			absl::PrintF("  FAIL  %s: got %s, expected %s\n",
+				step.name, format(types, tracker.stationary()), format(step.types, step.stationary));
+		}
+		passed &= ok;
+	}
+	return passed;
+}
+
+// A finger moving kStep to the right every scan, through frame assembly,
+// the mailbox and the tracker, the way the input pipeline passes frames.
+class Pipeline
+{
+public:
+	Pipeline(size_t contactsPerReport, FrameMailbox::Policy policy)
+		: device_("Tracker check device", {}),
+		  builder_(contactsPerReport, false),
+		  mailbox_(policy) {}
+
+	// Adds a report of the given scan with the finger in it, arriving at the
+	// given time.
+	void Add(int scan, ULONG contactCount, absl::Time arrival)
+	{
+		// Scan time is in 100us units.
+		const ULONG scanTime = static_cast<ULONG>(absl::ToInt64Microseconds(scan*kScanPeriod)/100);
+		TouchDevice::FrameBuilder::Frames frames =
+			builder_.AddReport({contactCount, scanTime, {Touch(0, 100 + kStep*scan)}}, arrival);
+		Post(std::move(frames.flushed), arrival);
+		Post(std::move(frames.finished), arrival);
+	}
+
+	// Hands the waiting frames to the tracker.
+	void Deliver()
+	{
+		mailbox_.Drain([this](const FrameMailbox::Frame& frame) {
+			tracker_.Update(frame.contacts, frame.time);
+			for(const ContactDelta& delta : tracker_.deltas())
+			{
+				if(delta.type == Type::kMove)
+				{
+					velocities_.push_back(delta.velocity.x());
+				}
+			}
+		});
+	}
+
+	// The velocity of every move, in logical units per second.
+	const std::vector<float>& velocities() const
+	{
+		return velocities_;
+	}
+
+private:
+	void Post(std::optional<TouchDevice::FrameBuilder::Frame> frame, absl::Time now)
+	{
+		if(frame)
+		{
+			mailbox_.Post(device_, std::move(frame->contacts), frame->time, now);
+		}
+	}
+
+	RecordedTouchpad device_;
+	TouchDevice::FrameBuilder builder_;
+	FrameMailbox mailbox_;
+	ContactTracker tracker_;
+	std::vector<float> velocities_;
+};
+
+bool CheckVelocities(std::string_view name, const Pipeline& pipeline, size_t expectedMoves)
+{
+	const float expected = kStep/static_cast<float>(absl::ToDoubleSeconds(kScanPeriod));
+	const std::vector<float>& velocities = pipeline.velocities();
+	const bool ok = velocities.size() == expectedMoves &&
+		std::all_of(velocities.begin(), velocities.end(), [&](float velocity) {
+			return std::abs(velocity - expected) <= kTolerance*expected;
+		});
+	const auto [low, high] = velocities.empty()
+		? std::pair(0.0f, 0.0f)
+		: std::pair(*std::min_element(velocities.begin(), velocities.end()),
+		            *std::max_element(velocities.begin(), velocities.end()));
+	absl::PrintF("  %-5s %s: %d moves at %.0f to %.0f units/s, expected %d at %.0f\n",
+		ok ? "ok" : "FAIL", name, velocities.size(), low, high, expectedMoves, expected);
+	return ok;
+}
+
+}  // namespace
+
+
+bool RunTrackerChecks()
+{
+	bool passed = true;
+	absl::PrintF("Contact deltas and stationary frames:\n");
+	passed &= CheckDeltas();
+
+	absl::PrintF("Velocity of a finger moving %d units every %s, by how frames are delivered:\n",
+		kStep, absl::FormatDuration(kScanPeriod));
+	const absl::Time epoch = absl::UnixEpoch();
+	{
+		Pipeline pipeline(1, FrameMailbox::Policy::kInOrder);
+		for(int scan = 0; scan < kScans; ++scan)
+		{
+			pipeline.Add(scan, 1, epoch + scan*kScanPeriod);
+			pipeline.Deliver();
+		}
+		passed &= CheckVelocities("one frame per call", pipeline, kScans - 1);
+	}
+	{
+		// Every scan arrives at once, as when input backs up.
+		Pipeline pipeline(1, FrameMailbox::Policy::kInOrder);
+		for(int scan = 0; scan < kScans; ++scan)
+		{
+			pipeline.Add(scan, 1, epoch + kScans*kScanPeriod);
+		}
+		pipeline.Deliver();
+		passed &= CheckVelocities("every frame in one call", pipeline, kScans - 1);
+	}
+	{
+		// The moves between the first and the last frame are shed, and the
+		// last one is measured over the whole interval.
+		Pipeline pipeline(1, FrameMailbox::Policy::kLatestWins);
+		for(int scan = 0; scan < kScans; ++scan)
+		{
+			pipeline.Add(scan, 1, epoch + kScans*kScanPeriod);
+		}
+		pipeline.Deliver();
+		passed &= CheckVelocities("every frame in one call, latest wins", pipeline, 1);
+	}
+	{
+		// Every other scan claims a second contact whose report is lost, so
+		// the next scan flushes it and both frames are delivered together.
+		// The last scan is still waiting for its second report.
+		Pipeline pipeline(1, FrameMailbox::Policy::kInOrder);
+		for(int scan = 0; scan < kScans; ++scan)
+		{
+			pipeline.Add(scan, scan % 2 == 1 ? 2 : 1, epoch + scan*kScanPeriod);
+			pipeline.Deliver();
+		}
+		passed &= CheckVelocities("flushed with the next frame", pipeline, kScans - 2);
+	}
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Feeds scripted frames to the contact tracker and checks the type of each
+// delta and whether the frame counts as stationary. Then runs a finger
+// moving at a constant speed through frame assembly, the mailbox and the
+// tracker, delivering frames one at a time, in bursts, and flushed together
+// with the frame after them, and checks that every delivery measures the same
+// velocity. Prints one line per check and returns whether all of them
+// passed.
+bool RunTrackerChecks();
+
+}  // namespace chiralscroll
@@ -0,0 +1,185 @@
+#include "TripleBufferChecks.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <intrin.h>
+
+#include <absl/strings/str_format.h>
+
+#include "Profiler.h"
+#include "TripleBuffer.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr std::chrono::seconds kHammerTime{2};
+static constexpr std::chrono::milliseconds kHoldTime{200};
+// Publishes the writer has to get through while the reader holds a value. A
+// writer that waited for the reader would manage none.
+static constexpr uint64_t kMinPublishesWhileHeld = 1000;
+
+// Large enough that copying it is not atomic, with every word set to the
+// sequence number so that a torn value shows.
+struct Value
+{
+	std::array<uint64_t, 32> words;
+};
+
+bool Intact(const Value& value)
+{
+	return std::all_of(value.words.begin(), value.words.end(),
+		[&](uint64_t word) { return word == value.words[0]; });
+}
+
+bool Expect(std::string_view name, bool passed, const std::string& detail)
+{
+	absl::PrintF("  %-5s %s: %s\n", passed ? "ok" : "FAIL", name, detail);
+	return passed;
+}
+
+// Publishes increasing sequence numbers as fast as it can until stopped,
+// and records the longest publish.
+class Writer
+{
+public:
+	explicit Writer(TripleBuffer<Value>& buffer) : buffer_(buffer), thread_([this] { Run(); }) {}
+
+	~Writer()
+	{
+		Stop();
+	}
+
+	void Stop()
+	{
+		stop_.store(true, std::memory_order_relaxed);
+		if(thread_.joinable())
+		{
+			thread_.join();
+		}
+	}
+
+	uint64_t published() const
+	{
+		return published_.load(std::memory_order_relaxed);
+	}
+
+	// Only valid after Stop.
+	uint64_t maxPublishCycles() const
+	{
+		return maxPublishCycles_;
+	}
+
+private:
+	void Run()
+	{
+		uint64_t sequence = 0;
+		while(!stop_.load(std::memory_order_relaxed))
+		{
+			++sequence;
+			const uint64_t start = __rdtsc();
+			buffer_.back().words.fill(sequence);
+			buffer_.Publish();
+			maxPublishCycles_ = std::max<uint64_t>(maxPublishCycles_, __rdtsc() - start);
+			published_.store(sequence, std::memory_order_relaxed);
+		}
+	}
+
+	TripleBuffer<Value>& buffer_;
+	std::atomic<bool> stop_{false};
+	std::atomic<uint64_t> published_{0};
+	uint64_t maxPublishCycles_ = 0;
+	std::thread thread_;
+};
+
+}  // namespace
+
+
+bool RunTripleBufferChecks()
+{
+	bool passed = true;
+	absl::PrintF("Touch snapshot triple buffer from two threads:\n");
+
+	{
+		TripleBuffer<Value> buffer;
+		for(uint64_t sequence = 1; sequence <= 3; ++sequence)
+		{
+			buffer.back().words.fill(sequence);
+			buffer.Publish();
+		}
+		const bool taken = buffer.Update();
+		const uint64_t front = buffer.front().words[0];
+		passed &= Expect("latest wins", taken && front == 3 && !buffer.Update(),
+			absl::StrFormat("took %d, expected 3 once", front));
+	}
+
+	{
+		// The reader takes values as fast as it can while the writer
+		// publishes.
+		TripleBuffer<Value> buffer;
+		uint64_t reads = 0;
+		uint64_t torn = 0;
+		uint64_t stale = 0;
+		uint64_t last = 0;
+		Writer writer(buffer);
+		const auto end = std::chrono::steady_clock::now() + kHammerTime;
+		while(std::chrono::steady_clock::now() < end)
+		{
+			if(!buffer.Update())
+			{
+				continue;
+			}
+			const Value& value = buffer.front();
+			++reads;
+			torn += Intact(value) ? 0 : 1;
+			stale += value.words[0] > last ? 0 : 1;
+			last = value.words[0];
+		}
+		writer.Stop();
+		passed &= Expect("no torn reads", reads > 0 && torn == 0,
+			absl::StrFormat("%d of %d reads torn, %d values published", torn, reads, writer.published()));
+		passed &= Expect("never older", stale == 0, absl::StrFormat("%d reads went backwards", stale));
+
+		// Once the writer stops, the reader gets its last value.
+		buffer.Update();
+		passed &= Expect("last value", buffer.front().words[0] == writer.published(),
+			absl::StrFormat("took %d, expected %d", buffer.front().words[0], writer.published()));
+	}
+
+	{
+		// The reader holds one value for a long time, the way a slow repaint
+		// would, and checks that it is left alone.
+		TripleBuffer<Value> buffer;
+		Writer writer(buffer);
+		while(!buffer.Update())
+		{
+			std::this_thread::yield();
+		}
+		const Value& held = buffer.front();
+		const uint64_t sequence = held.words[0];
+		const uint64_t publishedBefore = writer.published();
+		bool intact = true;
+		const auto end = std::chrono::steady_clock::now() + kHoldTime;
+		while(std::chrono::steady_clock::now() < end)
+		{
+			intact &= Intact(held) && held.words[0] == sequence;
+		}
+		const uint64_t publishedWhileHeld = writer.published() - publishedBefore;
+		writer.Stop();
+		passed &= Expect("held value untouched", intact, absl::StrFormat("held %d", sequence));
+		passed &= Expect("writer runs while held", publishedWhileHeld >= kMinPublishesWhileHeld,
+			absl::StrFormat("%d published, expected at least %d, longest publish %.1fus",
+				publishedWhileHeld, kMinPublishesWhileHeld, CyclesToNanoseconds(writer.maxPublishCycles())/1000.0));
+	}
+	return passed;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace chiralscroll
+{
+
+// Hammers the TripleBuffer that passes touch snapshots to the settings window
+// from a writer and a reader thread, and checks that the reader never sees a
+// torn or older value, and that the writer keeps publishing while the reader
+// holds on to a value. Prints one line per check and returns whether all of
+// them passed.
+bool RunTripleBufferChecks();
+
+}  // namespace chiralscroll
@@ -0,0 +1,129 @@
+// Prints the statistics that a running ChiralScroll publishes in shared
+// memory. Reading them has no effect on ChiralScroll, so this is safe to use
+// on any machine.
+//
+// Usage: StatsReader [--interval=1s]
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+
+#include "PipelineStats.h"
+#include "Profiler.h"
+#include "StatsSegment.h"
+
+ABSL_FLAG(absl::Duration, interval, absl::ZeroDuration(),
+	"Print the statistics again after each interval until interrupted. Prints once if zero.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+std::string FormatHistogram(std::string_view name, const Histogram& histogram)
+{
+	const auto us = [](uint64_t cycles) {
+		return CyclesToNanoseconds(cycles)/1000.0;
+	};
+	return absl::StrFormat("%-12s %10d %10.1f %10.1f %10.1f %10.1f\n",
+		name,
+		histogram.count(),
+		us(histogram.Percentile(50.0)),
+		us(histogram.Percentile(99.0)),
+		us(histogram.Percentile(99.9)),
+		us(histogram.max()));
+}
+
+std::string FormatStats(const SharedStats& stats)
+{
+	const PipelineStats& pipeline = stats.pipeline;
+	std::string result = absl::StrFormat("ChiralScroll process %d at %s\n\n",
+		stats.processId, absl::FormatTime(absl::Now()));
+
+	absl::StrAppendFormat(&result, "%-12s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+		"Device", "reports", "frames", "partial", "dropped", "merged", "stray", "errors", "quarantine");
+	const uint32_t deviceCount = stats.deviceCount.load(std::memory_order_acquire);
+	for(uint32_t i = 0; i < deviceCount; ++i)
+	{
+		const SharedStats::Device& device = stats.devices[i];
+		absl::StrAppendFormat(&result, "%-12d %10d %10d %10d %10d %10d %10d %10d %10d  %s\n",
+			i,
+			device.frames.reports.value(),
+			device.frames.frames.value(),
+			device.frames.partialFrames.value(),
+			device.frames.droppedFrames.value(),
+			device.frames.mergedFrames.value(),
+			device.frames.strayReports.value(),
+			device.frames.decodeErrors.value(),
+			device.frames.quarantines.value(),
+			device.name.data());
+	}
+
+	absl::StrAppendFormat(&result, "\n%-12s %10s %10s %10s %10s %10s\n",
+		"Step (us)", "count", "p50", "p99", "p99.9", "max");
+	result += FormatHistogram("decode", pipeline.decode);
+	result += FormatHistogram("gesture", pipeline.gesture);
+	result += FormatHistogram("injection", pipeline.injection);
+	result += FormatHistogram("stalls", pipeline.injectionStalls);
+
+	absl::StrAppendFormat(&result, "\nSessions started: %d\nShed frames: %d\nStationary frames: %d\nScroll events: %d\nEmpty scrolls: %d\n"
+		"Fallback scrolls: %d\nDropped scrolls: %d\nExceptions: %d\n",
+		pipeline.sessionsStarted.value(),
+		pipeline.shedFrames.value(),
+		pipeline.stationaryFrames.value(),
+		pipeline.scrollEvents.value(),
+		pipeline.emptyScrolls.value(),
+		pipeline.fallbackScrolls.value(),
+		pipeline.droppedScrolls.value(),
+		pipeline.exceptions.value());
+	return result;
+}
+
+int Run()
+{
+	const std::optional<StatsSegment> segment = StatsSegment::Open();
+	if(!segment)
+	{
+		absl::FPrintF(stderr, "ChiralScroll is not running, or is a different version.\n");
+		return 1;
+	}
+
+	// The histograms count TSC cycles, which run at the same rate in every
+	// process. Converting them needs a short calibration against the clock.
+	CyclesToNanoseconds(0);
+	absl::SleepFor(absl::Milliseconds(100));
+
+	const absl::Duration interval = absl::GetFlag(FLAGS_interval);
+	while(true)
+	{
+		absl::PrintF("%s", FormatStats(segment->stats()));
+		if(interval <= absl::ZeroDuration())
+		{
+			return 0;
+		}
+		absl::PrintF("\n");
+		std::fflush(stdout);
+		absl::SleepFor(interval);
+	}
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int main(int argc, char* argv[])
+{
+	absl::SetProgramUsageMessage("Prints the statistics published by a running ChiralScroll.");
+	absl::ParseCommandLine(argc, argv);
+	return chiralscroll::Run();
+}
@@ -0,0 +1,245 @@
+#include "Analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+#include <absl/time/time.h>
+
+#include "Replay.h"
+#include "Vector.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Longer intervals between frames are pauses in the input, not jitter.
+static constexpr absl::Duration kIdleGap = absl::Milliseconds(100);
+
+using ScrollEvent = ReplayResult::ScrollEvent;
+
+// Mean and variance in one pass.
+class RunningStats
+{
+public:
+	void Add(double value)
+	{
+		++count_;
+		const double delta = value - mean_;
+		mean_ += delta/count_;
+		m2_ += delta*(value - mean_);
+		max_ = std::max(max_, value);
+	}
+
+	uint64_t count() const
+	{
+		return count_;
+	}
+
+	double mean() const
+	{
+		return mean_;
+	}
+
+	double stddev() const
+	{
+		return count_ > 1 ? std::sqrt(m2_/(count_ - 1)) : 0.0;
+	}
+
+	double max() const
+	{
+		return max_;
+	}
+
+private:
+	uint64_t count_ = 0;
+	double mean_ = 0.0;
+	double m2_ = 0.0;
+	double max_ = 0.0;
+};
+
+struct Touch
+{
+	absl::Duration start;
+	absl::Duration end;
+	// Distance travelled in logical units.
+	double pathLength;
+	Vector<float> position;
+};
+
+void AnalyzeReports(const Trace& trace, std::vector<DeviceAnalysis>* analyses)
+{
+	std::vector<std::optional<absl::Duration>> lastFrameStart(trace.devices.size());
+	std::vector<RunningStats> intervals(trace.devices.size());
+	for(const auto& record : trace.records)
+	{
+		++(*analyses)[record.device].reports;
+		// Continuation reports arrive in a burst after the first report of
+		// their frame.
+		if(record.report.contactCount == 0)
+		{
+			continue;
+		}
+		std::optional<absl::Duration>& last = lastFrameStart[record.device];
+		if(last && record.time - *last < kIdleGap)
+		{
+			intervals[record.device].Add(absl::ToDoubleMilliseconds(record.time - *last));
+		}
+		last = record.time;
+	}
+
+	for(size_t i = 0; i < analyses->size(); ++i)
+	{
+		DeviceAnalysis& analysis = (*analyses)[i];
+		analysis.meanIntervalMs = intervals[i].mean();
+		analysis.jitterMs = intervals[i].stddev();
+		analysis.maxIntervalMs = intervals[i].max();
+		analysis.reportRateHz = intervals[i].count() > 0 ? 1000.0/intervals[i].mean() : 0.0;
+	}
+}
+
+void AnalyzeFrames(const Trace& trace, const ReplayResult& replay, std::vector<DeviceAnalysis>* analyses)
+{
+	std::vector<RunningStats> contacts(trace.devices.size());
+	for(const auto& frame : replay.frames)
+	{
+		contacts[frame.device].Add(static_cast<double>(std::count_if(frame.contacts.begin(), frame.contacts.end(),
+			[](const auto& contact) { return contact.isTouch; })));
+	}
+
+	for(size_t i = 0; i < analyses->size(); ++i)
+	{
+		DeviceAnalysis& analysis = (*analyses)[i];
+		const TouchDevice::FrameBuilder::Stats& stats = replay.frameStats[i];
+		analysis.frames = stats.frames.value();
+		analysis.partialFrames = stats.partialFrames.value();
+		analysis.droppedFrames = stats.droppedFrames.value();
+		const uint64_t attempted = analysis.frames + analysis.droppedFrames;
+		analysis.completeness = attempted > 0
+			? static_cast<double>(analysis.frames - analysis.partialFrames)/attempted
+			: 1.0;
+		analysis.meanContacts = contacts[i].mean();
+		analysis.maxContacts = static_cast<uint64_t>(contacts[i].max());
+	}
+}
+
+// Finds the single finger touches on each device, the same way ChiralScroll
+// decides whether to start a session.
+std::vector<std::vector<Touch>> FindTouches(const Trace& trace, const ReplayResult& replay)
+{
+	std::vector<std::optional<Touch>> open(trace.devices.size());
+	std::vector<std::vector<Touch>> touches(trace.devices.size());
+	for(const auto& frame : replay.frames)
+	{
+		std::optional<Touch>& current = open[frame.device];
+		const auto contact = std::find_if(frame.contacts.begin(), frame.contacts.end(),
+			[](const auto& contact) { return contact.id == 0; });
+		if(current)
+		{
+			current->end = frame.time;
+			if(contact == frame.contacts.end() || !contact->isTouch)
+			{
+				touches[frame.device].push_back(*current);
+				current.reset();
+				continue;
+			}
+			const Vector<float> position(static_cast<float>(contact->logicalX), static_cast<float>(contact->logicalY));
+			current->pathLength += (position - current->position).Norm();
+			current->position = position;
+		}
+		else if(frame.contacts.size() == 1 && contact != frame.contacts.end() && contact->isTouch)
+		{
+			current = Touch{frame.time, frame.time, 0.0,
+				Vector<float>(static_cast<float>(contact->logicalX), static_cast<float>(contact->logicalY))};
+		}
+	}
+
+	// The replay ends any session still in progress at the end of the trace.
+	for(size_t i = 0; i < open.size(); ++i)
+	{
+		if(open[i])
+		{
+			touches[i].push_back(*open[i]);
+		}
+	}
+	return touches;
+}
+
+// ChiralScroll runs one session at a time, so the scrolls during a touch
+// belong to it unless touches on several devices overlap. Takes the settings
+// by value since looking up a device adds it.
+void AnalyzeSessions(
+	const Trace& trace,
+	const ReplayResult& replay,
+	Settings settings,
+	std::vector<DeviceAnalysis>* analyses)
+{
+	const float factor = settings.GetGlobalSettings().sensScalingFactor;
+	const std::vector<std::vector<Touch>> touches = FindTouches(trace, replay);
+
+	for(size_t i = 0; i < analyses->size(); ++i)
+	{
+		DeviceAnalysis& analysis = (*analyses)[i];
+		const Settings::DeviceSettings& sens = settings.GetDeviceSettings(trace.devices[i].name());
+		RunningStats duration;
+		RunningStats timeToFirstScroll;
+		for(const Touch& touch : touches[i])
+		{
+			++analysis.touches;
+			const auto first = std::lower_bound(replay.scrolls.begin(), replay.scrolls.end(), touch.start,
+				[](const ScrollEvent& event, absl::Duration time) { return event.time < time; });
+			const auto last = std::upper_bound(first, replay.scrolls.end(), touch.end,
+				[](absl::Duration time, const ScrollEvent& event) { return time < event.time; });
+			const auto start = std::find_if(first, last,
+				[](const ScrollEvent& event) { return event.type == ScrollEvent::Type::kStart; });
+			if(start == last)
+			{
+				continue;
+			}
+
+			++analysis.sessions;
+			duration.Add(absl::ToDoubleMilliseconds(touch.end - touch.start));
+			const auto scroll = std::find_if(start, last,
+				[](const ScrollEvent& event) { return event.type == ScrollEvent::Type::kScroll; });
+			if(scroll != last)
+			{
+				timeToFirstScroll.Add(absl::ToDoubleMilliseconds(scroll->time - touch.start));
+			}
+			for(auto event = start; event != last; ++event)
+			{
+				analysis.emittedScroll += std::abs(event->amount);
+			}
+			// ScrollSession divides the movement by the contact area height
+			// and multiplies the scroll by it again, so the scroll per
+			// logical unit is just the sensitivity.
+			const float gain = start->axis == ReplayResult::Axis::kVertical ? sens.vSens : sens.hSens;
+			analysis.intendedScroll += touch.pathLength*std::abs(gain)*factor;
+		}
+		analysis.meanSessionMs = duration.mean();
+		analysis.meanTimeToFirstScrollMs = timeToFirstScroll.mean();
+		analysis.maxTimeToFirstScrollMs = timeToFirstScroll.max();
+	}
+}
+
+}  // namespace
+
+
+std::vector<DeviceAnalysis> AnalyzeTrace(const Trace& trace, std::string_view traceName, const Settings& settings)
+{
+	std::vector<DeviceAnalysis> analyses(trace.devices.size());
+	for(size_t i = 0; i < analyses.size(); ++i)
+	{
+		analyses[i].trace = traceName;
+		analyses[i].device = trace.devices[i].name();
+	}
+
+	const ReplayResult replay = ReplayTrace(trace, settings, true);
+	AnalyzeReports(trace, &analyses);
+	AnalyzeFrames(trace, replay, &analyses);
+	AnalyzeSessions(trace, replay, settings, &analyses);
+	return analyses;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Settings.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+// Statistics for one touchpad in one trace.
+struct DeviceAnalysis
+{
+	std::string trace;
+	std::string device;
+
+	// Timing of the first report of each frame, leaving out the gaps while
+	// nothing touches the touchpad.
+	uint64_t reports = 0;
+	double reportRateHz = 0.0;
+	double meanIntervalMs = 0.0;
+	// Standard deviation of the interval.
+	double jitterMs = 0.0;
+	double maxIntervalMs = 0.0;
+
+	uint64_t frames = 0;
+	uint64_t partialFrames = 0;
+	uint64_t droppedFrames = 0;
+	// Fraction of frames that were delivered complete.
+	double completeness = 0.0;
+	// Contacts touching the touchpad, per frame.
+	double meanContacts = 0.0;
+	uint64_t maxContacts = 0;
+
+	// Single finger touches which could start a scrolling session, and those
+	// which did.
+	int touches = 0;
+	int sessions = 0;
+	// From touch down to lift, for touches which scrolled.
+	double meanSessionMs = 0.0;
+	// From touch down to the first scroll.
+	double meanTimeToFirstScrollMs = 0.0;
+	double maxTimeToFirstScrollMs = 0.0;
+	// Total scrolled during sessions, and the total the finger movement would
+	// have scrolled with no deadzones or rounding.
+	double emittedScroll = 0.0;
+	double intendedScroll = 0.0;
+};
+
+// Replays the trace through the frame builder and gesture code with the given
+// settings, and measures the input and the scrolls for every touchpad.
+std::vector<DeviceAnalysis> AnalyzeTrace(const Trace& trace, std::string_view traceName, const Settings& settings);
+
+}  // namespace chiralscroll
@@ -0,0 +1,212 @@
+// Measures the input and scrolling in a set of recorded traces.
+//
+// Replays every trace recorded with --recordTrace through the frame builder
+// and gesture code, in parallel, and writes one row per touchpad per trace
+// with the report rate and jitter, frame completeness, contact counts,
+// session durations, time to first scroll, and how far it scrolled compared
+// with how far the finger moved.
+//
+// Usage: TraceStats [flags] <trace or directory>...
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_replace.h>
+#include <spdlog/spdlog.h>
+
+#include "Analysis.h"
+#include "Settings.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+
+ABSL_FLAG(int, threads, 0, "Number of worker threads, or 0 for one per core.");
+ABSL_FLAG(std::string, settings, "settings.ini", "Settings file to replay with. Missing settings take the built-in defaults.");
+ABSL_FLAG(std::string, format, "csv", "Output format, csv or json.");
+ABSL_FLAG(std::string, output, "", "File to write to. Defaults to standard output.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr char kTraceExtension[] = ".cstrace";
+
+std::vector<std::filesystem::path> FindTraces(const std::vector<char*>& args)
+{
+	std::vector<std::filesystem::path> paths;
+	for(const char* arg : args)
+	{
+		const std::filesystem::path path(arg);
+		if(!std::filesystem::is_directory(path))
+		{
+			paths.push_back(path);
+			continue;
+		}
+		for(const auto& entry : std::filesystem::recursive_directory_iterator(path))
+		{
+			if(entry.is_regular_file() && entry.path().extension() == kTraceExtension)
+			{
+				paths.push_back(entry.path());
+			}
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+std::string CsvField(const std::string& value)
+{
+	return absl::StrCat("\"", absl::StrReplaceAll(value, {{"\"", "\"\""}}), "\"");
+}
+
+std::string JsonString(const std::string& value)
+{
+	return absl::StrCat("\"", absl::StrReplaceAll(value, {{"\\", "\\\\"}, {"\"", "\\\""}}), "\"");
+}
+
+std::string FormatCsv(const std::vector<DeviceAnalysis>& analyses)
+{
+	std::string result =
+		"trace,device,reports,reportRateHz,meanIntervalMs,jitterMs,maxIntervalMs,"
+		"frames,partialFrames,droppedFrames,completeness,meanContacts,maxContacts,"
+		"touches,sessions,meanSessionMs,meanTimeToFirstScrollMs,maxTimeToFirstScrollMs,"
+		"emittedScroll,intendedScroll\n";
+	for(const DeviceAnalysis& a : analyses)
+	{
+		absl::StrAppendFormat(&result, "%s,%s,%d,%.2f,%.3f,%.3f,%.3f,%d,%d,%d,%.4f,%.3f,%d,%d,%d,%.1f,%.1f,%.1f,%.0f,%.0f\n",
+			CsvField(a.trace), CsvField(a.device),
+			a.reports, a.reportRateHz, a.meanIntervalMs, a.jitterMs, a.maxIntervalMs,
+			a.frames, a.partialFrames, a.droppedFrames, a.completeness, a.meanContacts, a.maxContacts,
+			a.touches, a.sessions, a.meanSessionMs, a.meanTimeToFirstScrollMs, a.maxTimeToFirstScrollMs,
+			a.emittedScroll, a.intendedScroll);
+	}
+	return result;
+}
+
+std::string FormatJson(const std::vector<DeviceAnalysis>& analyses)
+{
+	std::string result = "[\n";
+	for(size_t i = 0; i < analyses.size(); ++i)
+	{
+		const DeviceAnalysis& a = analyses[i];
+		absl::StrAppendFormat(&result,
+			"  {\"trace\": %s, \"device\": %s, "
+			"\"reports\": %d, \"reportRateHz\": %.2f, \"meanIntervalMs\": %.3f, \"jitterMs\": %.3f, \"maxIntervalMs\": %.3f, "
+			"\"frames\": %d, \"partialFrames\": %d, \"droppedFrames\": %d, \"completeness\": %.4f, "
+			"\"meanContacts\": %.3f, \"maxContacts\": %d, "
+			"\"touches\": %d, \"sessions\": %d, \"meanSessionMs\": %.1f, "
+			"\"meanTimeToFirstScrollMs\": %.1f, \"maxTimeToFirstScrollMs\": %.1f, "
+			"\"emittedScroll\": %.0f, \"intendedScroll\": %.0f}%s\n",
+			JsonString(a.trace), JsonString(a.device),
+			a.reports, a.reportRateHz, a.meanIntervalMs, a.jitterMs, a.maxIntervalMs,
+			a.frames, a.partialFrames, a.droppedFrames, a.completeness,
+			a.meanContacts, a.maxContacts,
+			a.touches, a.sessions, a.meanSessionMs,
+			a.meanTimeToFirstScrollMs, a.maxTimeToFirstScrollMs,
+			a.emittedScroll, a.intendedScroll,
+			i + 1 < analyses.size() ? "," : "");
+	}
+	result += "]\n";
+	return result;
+}
+
+int Run(const std::vector<char*>& args)
+{
+	const std::string format = absl::GetFlag(FLAGS_format);
+	if(format != "csv" && format != "json")
+	{
+		absl::FPrintF(stderr, "Unknown format %s.\n", format);
+		return 1;
+	}
+	const std::vector<std::filesystem::path> paths = FindTraces(args);
+	if(paths.empty())
+	{
+		absl::FPrintF(stderr, "No traces found.\n");
+		return 1;
+	}
+
+	const std::filesystem::path settingsPath = std::filesystem::absolute(absl::GetFlag(FLAGS_settings));
+
+	// Each task maps, replays and discards one trace, so only one trace per
+	// thread is in memory at a time.
+	WorkStealingPool pool(static_cast<size_t>(std::max(0, absl::GetFlag(FLAGS_threads))));
+	std::vector<std::vector<DeviceAnalysis>> results(paths.size());
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		pool.Submit([&, i] {
+			const Trace trace = Trace::FromFile(paths[i]);
+			std::vector<std::string> deviceNames;
+			for(const auto& device : trace.devices)
+			{
+				deviceNames.push_back(std::string(device.name()));
+			}
+			const Settings settings = Settings::FromFile(settingsPath, deviceNames);
+			results[i] = AnalyzeTrace(trace, paths[i].string(), settings);
+		});
+	}
+	pool.Wait();
+
+	std::vector<DeviceAnalysis> analyses;
+	for(auto& result : results)
+	{
+		std::move(result.begin(), result.end(), std::back_inserter(analyses));
+	}
+	const std::string text = format == "json" ? FormatJson(analyses) : FormatCsv(analyses);
+
+	const std::string outputPath = absl::GetFlag(FLAGS_output);
+	if(outputPath.empty())
+	{
+		std::cout << text;
+		return 0;
+	}
+	std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+	if(!out.is_open() || !(out << text))
+	{
+		absl::FPrintF(stderr, "Could not write %s.\n", outputPath);
+		return 1;
+	}
+	absl::FPrintF(stderr, "Wrote %d rows from %d traces to %s.\n", analyses.size(), paths.size(), outputPath);
+	return 0;
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int main(int argc, char* argv[])
+{
+	absl::SetProgramUsageMessage("Measures the input and scrolling in recorded traces.\n"
+		"Usage: TraceStats [flags] <trace or directory>...");
+	std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+	if(args.size() < 2)
+	{
+		absl::FPrintF(stderr, "%s\n", absl::ProgramUsageMessage());
+		return 1;
+	}
+	args.erase(args.begin());
+
+	// Malformed frames in the traces are expected and counted, not logged.
+	spdlog::set_level(spdlog::level::err);
+	try
+	{
+		return chiralscroll::Run(args);
+	}
+	catch(const std::exception& e)
+	{
+		absl::FPrintF(stderr, "Caught exception: %s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,277 @@
+// Offline tuner for the gesture settings.
+//
+// Loads a corpus of traces recorded with --recordTrace, replays every trace
+// through the gesture code with thousands of candidate settings, and writes
+// the best settings for each touchpad model.
+//
+// Usage: Tuner [flags] <corpus directory>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <absl/container/btree_map.h>
+#include <absl/flags/flag.h>
+#include <absl/flags/parse.h>
+#include <absl/flags/usage.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
+#include <spdlog/spdlog.h>
+
+#include "Replay.h"
+#include "Score.h"
+#include "Settings.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+
+ABSL_FLAG(int, candidates, 4000, "Number of parameter sets to try per touchpad model.");
+ABSL_FLAG(int, threads, 0, "Number of worker threads, or 0 for one per core.");
+ABSL_FLAG(uint32_t, seed, 1, "Seed for generating the parameter sets.");
+ABSL_FLAG(std::string, baseSettings, "",
+	"Settings file to start from. Defaults to settings.ini in the corpus directory, or the built-in defaults.");
+ABSL_FLAG(std::string, output, ".", "Directory to write the tuned settings files to.");
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+static constexpr char kTraceExtension[] = ".cstrace";
+
+struct LoadedTrace
+{
+	Trace trace;
+	std::vector<Gesture> gestures;
+	std::vector<Gain> baselineGain;
+};
+
+// Touchpads with the same vendor and product ID are the same model.
+std::string DeviceModel(const std::string& name)
+{
+	static const std::regex kVidPid("VID_([0-9A-Fa-f]{4}).*PID_([0-9A-Fa-f]{4})");
+	std::smatch match;
+	if(std::regex_search(name, match, kVidPid))
+	{
+		return absl::StrCat("VID_", match[1].str(), "&PID_", match[2].str());
+	}
+	return absl::StrCat("unknown-", std::hash<std::string>()(name));
+}
+
+// Samples candidates around the baseline. The distances are scaled
+// logarithmically since they only matter relative to sensor noise. The
+// sensitivity is left alone: the motion error is measured against the
+// baseline's gain, so it can only ever favor the baseline's sensitivity.
+std::vector<Settings::GlobalSettings> MakeCandidates(const Settings::GlobalSettings& baseline, int count, uint32_t seed)
+{
+	static constexpr float kPi = 3.14159f;
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> logScale(std::log(0.25f), std::log(4.0f));
+	std::uniform_real_distribution<float> startAngle(kPi/8.0f, kPi/1.5f);
+	std::uniform_real_distribution<float> reverseAngle(kPi/4.0f, kPi);
+
+	std::vector<Settings::GlobalSettings> candidates;
+	candidates.reserve(count);
+	candidates.push_back(baseline);
+	while(static_cast<int>(candidates.size()) < count)
+	{
+		Settings::GlobalSettings candidate = baseline;
+		candidate.startDeadzone = baseline.startDeadzone*std::exp(logScale(rng));
+		candidate.startDeadzoneAngle = startAngle(rng);
+		candidate.moveDeadzone = baseline.moveDeadzone*std::exp(logScale(rng));
+		candidate.reverseDeadzone = baseline.reverseDeadzone*std::exp(logScale(rng));
+		candidate.reverseDeadzoneAngle = reverseAngle(rng);
+		candidates.push_back(candidate);
+	}
+	return candidates;
+}
+
+std::vector<std::filesystem::path> FindTraces(const std::filesystem::path& corpus)
+{
+	std::vector<std::filesystem::path> paths;
+	for(const auto& entry : std::filesystem::recursive_directory_iterator(corpus))
+	{
+		if(entry.is_regular_file() && entry.path().extension() == kTraceExtension)
+		{
+			paths.push_back(entry.path());
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+int Run(const std::filesystem::path& corpus)
+{
+	const std::vector<std::filesystem::path> paths = FindTraces(corpus);
+	if(paths.empty())
+	{
+		absl::FPrintF(stderr, "No %s files found in %s.\n", kTraceExtension, corpus.string());
+		return 1;
+	}
+
+	WorkStealingPool pool(static_cast<size_t>(std::max(0, absl::GetFlag(FLAGS_threads))));
+
+	std::vector<LoadedTrace> traces(paths.size());
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		pool.Submit([&, i] { traces[i].trace = Trace::FromFile(paths[i]); });
+	}
+	pool.Wait();
+
+	std::vector<std::string> deviceNames;
+	for(const auto& loaded : traces)
+	{
+		for(const auto& device : loaded.trace.devices)
+		{
+			deviceNames.push_back(std::string(device.name()));
+		}
+	}
+	std::filesystem::path baseSettingsPath = absl::GetFlag(FLAGS_baseSettings);
+	if(baseSettingsPath.empty())
+	{
+		baseSettingsPath = corpus / "settings.ini";
+	}
+	Settings baseSettings = Settings::FromFile(std::filesystem::absolute(baseSettingsPath), deviceNames);
+
+	// The frames and gestures do not depend on the settings, so they are found
+	// once with the baseline. The gestures are labeled from the finger paths,
+	// not from what the baseline scrolled.
+	for(auto& loaded : traces)
+	{
+		for(const auto& device : loaded.trace.devices)
+		{
+			const Settings::DeviceSettings& deviceSettings = baseSettings.GetDeviceSettings(device.name());
+			const float factor = baseSettings.GetGlobalSettings().sensScalingFactor;
+			loaded.baselineGain.push_back({std::abs(deviceSettings.vSens)*factor, std::abs(deviceSettings.hSens)*factor});
+		}
+	}
+	for(size_t i = 0; i < traces.size(); ++i)
+	{
+		pool.Submit([&, i] {
+			const ReplayResult replay = ReplayTrace(traces[i].trace, baseSettings, true);
+			traces[i].gestures = FindGestures(traces[i].trace, replay);
+		});
+	}
+	pool.Wait();
+
+	// Which devices in each trace belong to each model.
+	absl::btree_map<std::string, std::vector<std::vector<bool>>> models;
+	for(size_t i = 0; i < traces.size(); ++i)
+	{
+		for(size_t j = 0; j < traces[i].trace.devices.size(); ++j)
+		{
+			auto& masks = models[DeviceModel(std::string(traces[i].trace.devices[j].name()))];
+			masks.resize(traces.size());
+			masks[i].resize(traces[i].trace.devices.size());
+			masks[i][j] = true;
+		}
+	}
+
+	const std::vector<Settings::GlobalSettings> candidates = MakeCandidates(
+		baseSettings.GetGlobalSettings(), std::max(1, absl::GetFlag(FLAGS_candidates)), absl::GetFlag(FLAGS_seed));
+	absl::PrintF("Replaying %d traces with %d candidates for %d models on %d threads.\n",
+		traces.size(), candidates.size(), models.size(), pool.threadCount());
+
+	const std::filesystem::path outputDir = std::filesystem::absolute(absl::GetFlag(FLAGS_output));
+	std::filesystem::create_directories(outputDir);
+
+	for(const auto& pair : models)
+	{
+		const std::string& model = pair.first;
+		const std::vector<std::vector<bool>>& masks = pair.second;
+		const auto scoreSettings = [&](const Settings& settings) {
+			Score score;
+			for(size_t i = 0; i < traces.size(); ++i)
+			{
+				if(masks[i].empty())
+				{
+					continue;
+				}
+				const ReplayResult replay = ReplayTrace(traces[i].trace, settings, false);
+				score += ScoreReplay(traces[i].gestures, masks[i], traces[i].baselineGain, replay);
+			}
+			return score;
+		};
+		std::vector<Score> scores(candidates.size());
+		for(size_t c = 0; c < candidates.size(); ++c)
+		{
+			pool.Submit([&, c] {
+				Settings settings = baseSettings;
+				settings.GetGlobalSettings() = candidates[c];
+				scores[c] = scoreSettings(settings);
+			});
+		}
+		// The baseline with the configured deadzones and with the deadzones
+		// scaled to each device's noise, whatever the base settings say, to
+		// show what adaptive deadzones gain.
+		Score fixed;
+		Score adaptive;
+		const auto scoreDeadzones = [&](bool adaptiveDeadzones, Score* score) {
+			pool.Submit([&, adaptiveDeadzones, score] {
+				Settings settings = baseSettings;
+				settings.GetGlobalSettings().adaptiveDeadzones = adaptiveDeadzones;
+				*score = scoreSettings(settings);
+			});
+		};
+		scoreDeadzones(false, &fixed);
+		scoreDeadzones(true, &adaptive);
+		pool.Wait();
+
+		const size_t best = std::min_element(scores.begin(), scores.end(),
+			[](const Score& a, const Score& b) { return a.Total() < b.Total(); }) - scores.begin();
+		const auto print = [](std::string_view label, const Score& score) {
+			absl::PrintF("  %-9s score=%8.2f latency=%7.2fms falseReversals=%.3f motionError=%.3f falseStarts=%.3f\n",
+				label, score.Total(), score.startLatencyMs, score.falseReversals, score.motionError, score.falseStarts);
+		};
+		absl::PrintF("%s (%d gestures, %d meant to scroll)\n", model, scores[0].gestures, scores[0].intendedGestures);
+		print("fixed", fixed);
+		print("adaptive", adaptive);
+		print("baseline", scores[0]);
+		print("best", scores[best]);
+
+		// Write the winning settings, with only this model's devices.
+		Settings tuned = baseSettings;
+		tuned.GetGlobalSettings() = candidates[best];
+		auto& deviceSettings = tuned.GetDeviceSettings();
+		absl::erase_if(deviceSettings, [&model](const auto& pair) { return DeviceModel(pair.first) != model; });
+		const std::filesystem::path path = outputDir / absl::StrCat(model, ".ini");
+		std::filesystem::remove(path);
+		tuned.ToFile(path);
+		absl::PrintF("  wrote %s\n", path.string());
+	}
+	return 0;
+}
+
+}  // namespace
+
+}  // namespace chiralscroll
+
+int main(int argc, char* argv[])
+{
+	absl::SetProgramUsageMessage("Tunes the gesture settings against recorded traces.\n"
+		"Usage: Tuner [flags] <corpus directory>");
+	std::vector<char*> args = absl::ParseCommandLine(argc, argv);
+	if(args.size() != 2)
+	{
+		absl::FPrintF(stderr, "%s\n", absl::ProgramUsageMessage());
+		return 1;
+	}
+
+	// Malformed frames in the traces are expected and counted, not logged.
+	spdlog::set_level(spdlog::level::err);
+	try
+	{
+		return chiralscroll::Run(args[1]);
+	}
+	catch(const std::exception& e)
+	{
+		absl::FPrintF(stderr, "Caught exception: %s\n", e.what());
+		return 1;
+	}
+}
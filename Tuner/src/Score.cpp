@@ -0,0 +1,195 @@
+#include "Score.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+#include "Vector.h"
+
+namespace chiralscroll
+{
+
+namespace
+{
+
+// Weights for Score::Total(). One false reversal per gesture is about as bad
+// as 200ms of extra start latency.
+static constexpr double kStartLatencyWeight = 1.0;
+static constexpr double kFalseReversalWeight = 200.0;
+static constexpr double kMotionErrorWeight = 100.0;
+static constexpr double kFalseStartWeight = 200.0;
+
+// A gesture is meant to scroll if the finger ends up at least this far from
+// where it touched down along one axis, in units of the touchpad height...
+static constexpr float kMinIntendedTravel = 0.1f;
+// ...and that is most of the distance it travelled.
+static constexpr float kMinStraightness = 0.8f;
+
+using ScrollEvent = ReplayResult::ScrollEvent;
+
+// Returns the scroll events within [start, end].
+std::pair<std::vector<ScrollEvent>::const_iterator, std::vector<ScrollEvent>::const_iterator>
+EventsBetween(const std::vector<ScrollEvent>& events, absl::Duration start, absl::Duration end)
+{
+	const auto first = std::lower_bound(events.begin(), events.end(), start,
+		[](const ScrollEvent& event, absl::Duration time) { return event.time < time; });
+	const auto last = std::upper_bound(first, events.end(), end,
+		[](absl::Duration time, const ScrollEvent& event) { return time < event.time; });
+	return {first, last};
+}
+
+}  // namespace
+
+
+double Score::Total() const
+{
+	return kStartLatencyWeight*startLatencyMs +
+		kFalseReversalWeight*falseReversals +
+		kMotionErrorWeight*motionError +
+		kFalseStartWeight*falseStarts;
+}
+
+Score& Score::operator+=(const Score& other)
+{
+	const auto mean = [](double a, int n, double b, int m) {
+		return n + m == 0 ? 0.0 : (a*n + b*m)/(n + m);
+	};
+	startLatencyMs = mean(startLatencyMs, intendedGestures, other.startLatencyMs, other.intendedGestures);
+	falseReversals = mean(falseReversals, intendedGestures, other.falseReversals, other.intendedGestures);
+	motionError = mean(motionError, intendedGestures, other.motionError, other.intendedGestures);
+	falseStarts = mean(falseStarts, gestures, other.falseStarts, other.gestures);
+	gestures += other.gestures;
+	intendedGestures += other.intendedGestures;
+	return *this;
+}
+
+std::vector<Gesture> FindGestures(const Trace& trace, const ReplayResult& replay)
+{
+	struct Open
+	{
+		Gesture gesture;
+		Vector<float> start;
+		Vector<float> position;
+	};
+	// At most one open gesture per device.
+	std::vector<std::optional<Open>> open(trace.devices.size());
+	std::vector<Gesture> gestures;
+
+	for(const auto& frame : replay.frames)
+	{
+		std::optional<Open>& current = open[frame.device];
+		const auto contact = std::find_if(frame.contacts.begin(), frame.contacts.end(),
+			[](const auto& contact) { return contact.id == 0; });
+
+		if(current)
+		{
+			if(contact == frame.contacts.end() || !contact->isTouch)
+			{
+				Gesture& gesture = current->gesture;
+				gesture.end = frame.time;
+				const Vector<float> travel = current->position - current->start;
+				const bool vertical = std::abs(travel.y()) >= std::abs(travel.x());
+				const float distance = std::abs(vertical ? travel.y() : travel.x());
+				gesture.intended = distance >= kMinIntendedTravel && distance >= kMinStraightness*gesture.pathLength;
+				gesture.axis = vertical ? ReplayResult::Axis::kVertical : ReplayResult::Axis::kHorizontal;
+				gestures.push_back(gesture);
+				current.reset();
+				continue;
+			}
+			const Vector<float> position =
+				Vector<LONG>(contact->logicalX, contact->logicalY)/static_cast<float>(current->gesture.height);
+			current->gesture.pathLength += (position - current->position).Norm();
+			current->position = position;
+		}
+		else if(frame.contacts.size() == 1 && contact != frame.contacts.end() && contact->isTouch)
+		{
+			const Touchpad::ContactInfo& info = trace.devices[frame.device].GetContactInfo(contact->contactInfoLink);
+			const LONG height = info.logicalArea.bottom - info.logicalArea.top;
+			const Vector<float> position = Vector<LONG>(contact->logicalX, contact->logicalY)/static_cast<float>(height);
+			current = Open{
+				{frame.device, frame.time, frame.time, 0.0, height, false, ReplayResult::Axis::kVertical},
+				position,
+				position};
+		}
+	}
+	return gestures;
+}
+
+Score ScoreReplay(
+	const std::vector<Gesture>& gestures,
+	const std::vector<bool>& devices,
+	const std::vector<Gain>& baselineGain,
+	const ReplayResult& replay)
+{
+	Score score;
+	for(const auto& gesture : gestures)
+	{
+		if(!devices[gesture.device])
+		{
+			continue;
+		}
+		const auto [first, last] = EventsBetween(replay.scrolls, gesture.start, gesture.end);
+
+		std::vector<int> amounts;
+		absl::Duration firstScroll = absl::InfiniteDuration();
+		for(auto it = first; it != last; ++it)
+		{
+			if(it->type == ScrollEvent::Type::kScroll)
+			{
+				firstScroll = std::min(firstScroll, it->time);
+				amounts.push_back(it->amount);
+			}
+		}
+
+		++score.gestures;
+		if(!gesture.intended)
+		{
+			score.falseStarts += amounts.empty() ? 0.0 : 1.0;
+			continue;
+		}
+		++score.intendedGestures;
+
+		const absl::Duration latency =
+			amounts.empty() ? gesture.end - gesture.start : firstScroll - gesture.start;
+		score.startLatencyMs += absl::ToDoubleMilliseconds(latency);
+
+		for(size_t i = 1; i + 1 < amounts.size(); ++i)
+		{
+			const bool reversed = (amounts[i] > 0) != (amounts[i - 1] > 0);
+			const bool undone = (amounts[i + 1] > 0) == (amounts[i - 1] > 0);
+			if(reversed && undone)
+			{
+				score.falseReversals += 1.0;
+			}
+		}
+
+		double emitted = 0.0;
+		for(int amount : amounts)
+		{
+			emitted += std::abs(amount);
+		}
+		const Gain& gain = baselineGain[gesture.device];
+		const double intended = gesture.pathLength*gesture.height*
+			(gesture.axis == ReplayResult::Axis::kVertical ? gain.vertical : gain.horizontal);
+		// Scrolling too far is as bad as scrolling too little.
+		if(intended > 0.0)
+		{
+			score.motionError += std::min(std::abs(1.0 - emitted/intended), 1.0);
+		}
+	}
+
+	if(score.intendedGestures > 0)
+	{
+		score.startLatencyMs /= score.intendedGestures;
+		score.falseReversals /= score.intendedGestures;
+		score.motionError /= score.intendedGestures;
+	}
+	if(score.gestures > 0)
+	{
+		score.falseStarts /= score.gestures;
+	}
+	return score;
+}
+
+}  // namespace chiralscroll
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <absl/time/time.h>
+
+#include "Replay.h"
+#include "Settings.h"
+#include "Trace.h"
+
+namespace chiralscroll
+{
+
+// A single finger touch which could start a scrolling session.
+struct Gesture
+{
+	uint32_t device;
+	absl::Duration start;
+	absl::Duration end;
+	// Distance travelled, in units of the touchpad height.
+	double pathLength;
+	// Logical height of the touchpad.
+	LONG height;
+	// Whether the finger moved far and straight enough along one axis to be a
+	// scroll, and along which. Found from the path alone, so that no settings
+	// are favored.
+	bool intended;
+	ReplayResult::Axis axis;
+};
+
+// Scroll amount per unit of finger movement, for each direction, with the
+// baseline settings. Movement is measured in logical units.
+struct Gain
+{
+	float vertical;
+	float horizontal;
+};
+
+struct Score
+{
+	// Gestures which were scored.
+	int gestures = 0;
+	// Of those, gestures which were meant to scroll. The latency, reversals
+	// and motion error are means over these.
+	int intendedGestures = 0;
+	// Mean time from touch down to the first scroll. A missed scroll counts
+	// as the whole gesture.
+	double startLatencyMs = 0.0;
+	// Reversals undone by the following scroll, per intended gesture.
+	double falseReversals = 0.0;
+	// How far the scrolled distance is from the finger movement, as a
+	// fraction of the finger movement, in either direction and at most 1.
+	double motionError = 0.0;
+	// Scrolling sessions started by gestures that were not meant to scroll,
+	// per gesture.
+	double falseStarts = 0.0;
+
+	// Weighted total, lower is better.
+	double Total() const;
+
+	// Combines the scores of disjoint sets of gestures.
+	Score& operator+=(const Score& other);
+};
+
+// Finds the gestures in the frames of a replay, and labels them from the
+// path of the finger. Frame assembly does not depend on the gesture settings,
+// so any replay of the trace gives the same gestures.
+std::vector<Gesture> FindGestures(const Trace& trace, const ReplayResult& replay);
+
+// Scores the scrolls of a replay for the gestures on the given devices. The
+// devices and gains are indexed like Trace::devices.
+Score ScoreReplay(
+	const std::vector<Gesture>& gestures,
+	const std::vector<bool>& devices,
+	const std::vector<Gain>& baselineGain,
+	const ReplayResult& replay);
+
+}  // namespace chiralscroll